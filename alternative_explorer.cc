@@ -0,0 +1,904 @@
+#include "alternative_explorer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+void
+alternative_outcomes::clear()
+{
+	nodes_.clear();
+	min_scores_.clear();
+	leaves_.clear();
+	decisions_.clear();
+	root_ = 0;
+}
+
+int
+alternative_outcomes::min_score(node_id id) const
+{
+	return min_scores_[id];
+}
+
+int
+alternative_outcomes::score(const std::vector<std::size_t> & alternatives) const
+{
+	node_id id = root_;
+	while (!nodes_[id].is_leaf()) {
+		std::size_t pair = nodes_[id].pair;
+		std::size_t option = pair < alternatives.size() ? alternatives[pair] : 0;
+		id = nodes_[id].child[option];
+	}
+	return nodes_[id].score;
+}
+
+void
+alternative_outcomes::lowest_assignment(std::vector<std::size_t> & alternatives) const
+{
+	int best_score = min_score(root_);
+	node_id id = root_;
+	while (!nodes_[id].is_leaf()) {
+		const node & n = nodes_[id];
+		bool option0 = min_score(n.child[0]) == best_score;
+		bool option1 = min_score(n.child[1]) == best_score;
+		if (!(option0 && option1)) {
+			alternatives[n.pair] = option1 ? 1 : 0;
+		}
+		id = n.child[alternatives[n.pair]];
+	}
+}
+
+std::vector<std::vector<std::size_t>>
+alternative_outcomes::path_assignments(std::size_t num_pairs) const
+{
+	std::vector<std::vector<std::size_t>> result;
+	std::vector<std::size_t> alternatives(num_pairs, 0);
+	if (nodes_.empty()) {
+		result.push_back(alternatives);
+	} else {
+		add_paths(root_, alternatives, result);
+	}
+	return result;
+}
+
+void
+alternative_outcomes::add_paths(
+	node_id id,
+	std::vector<std::size_t> & alternatives,
+	std::vector<std::vector<std::size_t>> & result) const
+{
+	const node & n = nodes_[id];
+	if (n.is_leaf()) {
+		result.push_back(alternatives);
+		return;
+	}
+	for (std::size_t option = 0; option < 2; ++option) {
+		alternatives[n.pair] = option;
+		add_paths(n.child[option], alternatives, result);
+	}
+	alternatives[n.pair] = 0;
+}
+
+alternative_outcomes::node_id
+alternative_outcomes::make_leaf(int score)
+{
+	auto i = leaves_.find(score);
+	if (i != leaves_.end()) {
+		return i->second;
+	}
+
+	node_id id = nodes_.size();
+	nodes_.push_back({-1, {0, 0}, score});
+	min_scores_.push_back(score);
+	leaves_.emplace(score, id);
+	return id;
+}
+
+alternative_outcomes::node_id
+alternative_outcomes::make_node(int pair, node_id option0, node_id option1)
+{
+	if (option0 == option1) {
+		return option0;
+	}
+
+	auto key = std::make_tuple(pair, option0, option1);
+	auto i = decisions_.find(key);
+	if (i != decisions_.end()) {
+		return i->second;
+	}
+
+	node_id id = nodes_.size();
+	nodes_.push_back({pair, {option0, option1}, 0});
+	min_scores_.push_back(std::min(min_scores_[option0], min_scores_[option1]));
+	decisions_.emplace(key, id);
+	return id;
+}
+
+namespace {
+
+using segment = alternative_exploration::segment;
+using checkpoint = alternative_exploration::checkpoint;
+
+static constexpr std::size_t no_segment = std::size_t(-1);
+
+/* initial number of steps between checkpoints, and number
+ * of checkpoints per segment before they are thinned out */
+static constexpr int checkpoint_interval = 16;
+static constexpr std::size_t max_checkpoints = 32;
+
+class alternative_explorer {
+public:
+	alternative_explorer(
+		const puzzle & puz,
+		const command_program & program,
+		alternative_outcomes & outcomes);
+
+	/* Record runs as segments into given vector. */
+	inline void
+	record(std::vector<segment> * segments) noexcept { segments_ = segments; }
+
+	void
+	run();
+
+	/* Explore by resuming runs recorded for a previous
+	 * program that agrees with the current one on all
+	 * instructions before first_changed. */
+	void
+	replay(std::vector<segment> & old_segments, std::size_t first_changed);
+
+	/* Stop runs once given flag becomes set. */
+	inline void
+	set_cancel(const std::atomic<bool> * cancel) noexcept { cancel_ = cancel; }
+
+	inline void
+	set_stop_hopeless(bool stop) noexcept { stop_hopeless_ = stop; }
+
+	inline void
+	set_max_steps(int max_steps) noexcept { max_steps_ = max_steps; }
+
+	/* Add steps taken by every instruction, each counted
+	 * for all assignments the run stands for, into given
+	 * array indexed by program counter. */
+	inline void
+	set_profile(double * steps) noexcept { profile_ = steps; }
+
+	inline bool
+	cancelled() const noexcept { return cancelled_; }
+
+	inline std::size_t
+	simulated_steps() const noexcept { return simulated_steps_; }
+
+private:
+	/* Alternative tile, and the pair that decides whether
+	 * it is present. With overlapping pairs, this is the
+	 * last pair placing or removing a tile at this
+	 * position. */
+	struct alternative_cell {
+		grid_pos_t pos;
+		std::size_t pair;
+		bool present[2];
+	};
+
+	/* Alternative tile that is not blank initially. Its
+	 * contents depend on all pairs touching it, as removing
+	 * the tile also removes any obstacle on it. */
+	struct early_cell {
+		grid_pos_t pos;
+		bool exists;
+		run_step_state::tile_t initial;
+		/* placements and removals, in order */
+		std::vector<alternative_cell> ops;
+	};
+
+	alternative_outcomes::node_id
+	explore(run_step_state & state, int nsteps, std::size_t seg);
+
+	alternative_outcomes::node_id
+	fork(run_step_state & state, int nsteps, std::size_t pair, std::size_t seg);
+
+	bool
+	check_cancel(std::size_t seg);
+
+	alternative_outcomes::node_id
+	resume(std::vector<segment> & old_segments, std::size_t old_seg, std::size_t first_changed);
+
+	void
+	decide(run_step_state & state, std::size_t pair, std::size_t option) const;
+
+	std::size_t
+	begin_segment(const run_step_state & state, int nsteps);
+
+	void
+	add_checkpoint(const run_step_state & state, int nsteps, std::size_t seg);
+
+	void
+	note_advance(const run_step_state & state, int nsteps, std::size_t seg);
+
+	const puzzle & puz_;
+	const command_program & program_;
+	alternative_outcomes & outcomes_;
+
+	std::vector<alternative_cell> cells_;
+	grid_pos_t cells_min_, cells_max_;
+	/* cells that are not blank might be modified before
+	 * being inspected; the pairs touching them are decided
+	 * before running */
+	std::vector<early_cell> early_cells_;
+	std::vector<std::size_t> early_pairs_;
+
+	/* decisions on current path, -1 for undecided */
+	std::vector<int> choices_;
+
+	std::vector<segment> * segments_ = nullptr;
+	const std::atomic<bool> * cancel_ = nullptr;
+	bool cancelled_ = false;
+	bool stop_hopeless_ = false;
+	int max_steps_ = std::numeric_limits<int>::max();
+	std::size_t simulated_steps_ = 0;
+
+	double * profile_ = nullptr;
+	/* assignments the current run stands for: all of
+	 * the pairs not decided on its path */
+	double weight_;
+};
+
+alternative_explorer::alternative_explorer(
+	const puzzle & puz,
+	const command_program & program,
+	alternative_outcomes & outcomes)
+	: puz_(puz), program_(program), outcomes_(outcomes), choices_(puz.alternative_tiles.size(), -1)
+	, weight_(std::ldexp(1., puz.alternative_tiles.size()))
+{
+	/* all placements and removals, in order of pairs */
+	std::vector<alternative_cell> ops;
+	for (std::size_t k = 0; k < puz.alternative_tiles.size(); ++k) {
+		ops.push_back({puz.alternative_tiles[k].first, k, {true, false}});
+		ops.push_back({puz.alternative_tiles[k].second, k, {false, true}});
+	}
+
+	for (std::size_t n = 0; n < ops.size(); ++n) {
+		const grid_pos_t & pos = ops[n].pos;
+		bool seen = false;
+		for (std::size_t k = 0; k < n; ++k) {
+			seen = seen || ops[k].pos == pos;
+		}
+		if (seen) {
+			continue;
+		}
+
+		early_cell early;
+		early.pos = pos;
+		const auto * tile = puz.grid.get(pos.x, pos.y);
+		early.exists = tile && tile->trigger_id >= 0;
+		early.initial.has_floor = early.exists;
+		for (std::size_t index = 0; index < puz.obstacles.size(); ++index) {
+			if (puz.obstacles[index] == pos) {
+				early.exists = true;
+				early.initial.obstacle = index;
+			}
+		}
+
+		if (tile || early.exists) {
+			for (std::size_t k = n; k < ops.size(); ++k) {
+				if (ops[k].pos == pos) {
+					early.ops.push_back(ops[k]);
+					early_pairs_.push_back(ops[k].pair);
+				}
+			}
+			early_cells_.push_back(std::move(early));
+		} else {
+			/* blank: only the last pair touching it matters */
+			alternative_cell cell = ops[n];
+			for (std::size_t k = n; k < ops.size(); ++k) {
+				if (ops[k].pos == pos) {
+					cell = ops[k];
+				}
+			}
+			cells_.push_back(cell);
+		}
+	}
+
+	cells_min_ = grid_pos_t{std::numeric_limits<int>::max(), std::numeric_limits<int>::max()};
+	cells_max_ = grid_pos_t{std::numeric_limits<int>::min(), std::numeric_limits<int>::min()};
+	for (const auto & cell : cells_) {
+		cells_min_.x = std::min(cells_min_.x, cell.pos.x);
+		cells_min_.y = std::min(cells_min_.y, cell.pos.y);
+		cells_max_.x = std::max(cells_max_.x, cell.pos.x);
+		cells_max_.y = std::max(cells_max_.y, cell.pos.y);
+	}
+}
+
+void
+alternative_explorer::run()
+{
+	outcomes_.clear();
+
+	run_step_state state;
+	state.initialize(puz_, &program_);
+	if (!state.enter_program()) {
+		outcomes_.set_root(outcomes_.make_leaf(1));
+		return;
+	}
+
+	std::size_t seg = begin_segment(state, 1);
+	outcomes_.set_root(explore(state, 1, seg));
+}
+
+void
+alternative_explorer::replay(std::vector<segment> & old_segments, std::size_t first_changed)
+{
+	if (old_segments.empty() || old_segments[0].checkpoints[0].state.furthest_pc() >= first_changed) {
+		run();
+		return;
+	}
+
+	outcomes_.clear();
+	outcomes_.set_root(resume(old_segments, 0, first_changed));
+}
+
+alternative_outcomes::node_id
+alternative_explorer::explore(run_step_state & state, int nsteps, std::size_t seg)
+{
+	if (check_cancel(seg)) {
+		return outcomes_.make_leaf(0);
+	}
+
+	for (std::size_t pair : early_pairs_) {
+		if (choices_[pair] < 0) {
+			return fork(state, nsteps, pair, seg);
+		}
+	}
+
+	for (;;) {
+		grid_pos_t reads[2];
+		std::size_t num_reads = state.next_step_reads(reads);
+		for (std::size_t n = 0; n < num_reads; ++n) {
+			const grid_pos_t & pos = reads[n];
+			if (pos.x < cells_min_.x || pos.x > cells_max_.x || pos.y < cells_min_.y || pos.y > cells_max_.y) {
+				continue;
+			}
+			for (const auto & cell : cells_) {
+				if (cell.pos == pos && choices_[cell.pair] < 0) {
+					return fork(state, nsteps, cell.pair, seg);
+				}
+			}
+		}
+
+		if (seg != no_segment) {
+			add_checkpoint(state, nsteps, seg);
+		}
+		if (check_cancel(seg)) {
+			return outcomes_.make_leaf(0);
+		}
+
+		state.begin_step();
+		++nsteps;
+		++simulated_steps_;
+		std::size_t pc = state.pc();
+		if (profile_) {
+			profile_[pc] += weight_;
+		}
+		run_step_state::step_result_t result = state.finish_step();
+		if (seg != no_segment) {
+			note_advance(state, nsteps, seg);
+		}
+		simulation_result::outcome_t outcome = simulation_result::outcome_t::program_end;
+		switch (result) {
+			case run_step_state::step_result_t::running: {
+				if (stop_hopeless_ && puz_.distances.hopeless(state)) {
+					/* fails whatever the program does next */
+					outcome = simulation_result::outcome_t::hopeless;
+				} else if (nsteps >= max_steps_) {
+					outcome = simulation_result::outcome_t::step_limit;
+				} else {
+					continue;
+				}
+				break;
+			}
+			case run_step_state::step_result_t::reached_goal: {
+				outcome = simulation_result::outcome_t::reached_goal;
+				break;
+			}
+			case run_step_state::step_result_t::dropped: {
+				outcome = simulation_result::outcome_t::dropped;
+				break;
+			}
+			case run_step_state::step_result_t::program_end: {
+				break;
+			}
+		}
+
+		int score = result == run_step_state::step_result_t::reached_goal ? std::numeric_limits<int>::max() : nsteps;
+		if (seg != no_segment) {
+			segment & s = (*segments_)[seg];
+			s.end_pc = state.furthest_pc();
+			s.pair = -1;
+			s.score = score;
+			s.outcome = outcome;
+			s.end_state = result == run_step_state::step_result_t::reached_goal ? 0 : state.board_hash();
+			s.end_steps = nsteps;
+			s.fail_pos = result == run_step_state::step_result_t::dropped ?
+				state.current_step().robot_target.pos : state.robot.pos;
+			s.fail_pc = pc;
+		}
+		return outcomes_.make_leaf(score);
+	}
+}
+
+alternative_outcomes::node_id
+alternative_explorer::fork(run_step_state & state, int nsteps, std::size_t pair, std::size_t seg)
+{
+	if (seg != no_segment) {
+		segment & s = (*segments_)[seg];
+		s.end_pc = state.furthest_pc();
+		s.pair = pair;
+	}
+
+	run_step_state other(state);
+	weight_ *= .5;
+
+	choices_[pair] = 0;
+	decide(other, pair, 0);
+	std::size_t seg0 = begin_segment(other, nsteps);
+	alternative_outcomes::node_id option0 = explore(other, nsteps, seg0);
+
+	choices_[pair] = 1;
+	decide(state, pair, 1);
+	std::size_t seg1 = begin_segment(state, nsteps);
+	alternative_outcomes::node_id option1 = explore(state, nsteps, seg1);
+
+	choices_[pair] = -1;
+	weight_ *= 2.;
+
+	if (seg != no_segment) {
+		segment & s = (*segments_)[seg];
+		s.child[0] = seg0;
+		s.child[1] = seg1;
+	}
+
+	return outcomes_.make_node(pair, option0, option1);
+}
+
+bool
+alternative_explorer::check_cancel(std::size_t seg)
+{
+	if (!cancelled_) {
+		cancelled_ = cancel_ && cancel_->load(std::memory_order_relaxed);
+		if (!cancelled_) {
+			return false;
+		}
+	}
+
+	/* leave segment open, so that the next update
+	 * continues from its last checkpoint */
+	if (seg != no_segment) {
+		segment & s = (*segments_)[seg];
+		s.end_pc = std::numeric_limits<std::size_t>::max();
+		s.pair = -1;
+		s.score = 0;
+		s.outcome = simulation_result::outcome_t::program_end;
+		s.end_state = 0;
+		s.end_steps = 0;
+		s.fail_pos = grid_pos_t{0, 0};
+		s.fail_pc = 0;
+	}
+	return true;
+}
+
+alternative_outcomes::node_id
+alternative_explorer::resume(std::vector<segment> & old_segments, std::size_t old_seg, std::size_t first_changed)
+{
+	segment & old = old_segments[old_seg];
+	std::size_t seg = segments_->size();
+
+	if (old.end_pc < first_changed) {
+		/* whole segment unaffected, carry it over */
+		int pair = old.pair;
+		int score = old.score;
+		std::size_t old_child0 = old.child[0];
+		std::size_t old_child1 = old.child[1];
+		segments_->push_back(std::move(old));
+
+		if (pair < 0) {
+			return outcomes_.make_leaf(score);
+		}
+
+		choices_[pair] = 0;
+		std::size_t seg0 = segments_->size();
+		alternative_outcomes::node_id option0 = resume(old_segments, old_child0, first_changed);
+		choices_[pair] = 1;
+		std::size_t seg1 = segments_->size();
+		alternative_outcomes::node_id option1 = resume(old_segments, old_child1, first_changed);
+		choices_[pair] = -1;
+
+		segment & s = (*segments_)[seg];
+		s.child[0] = seg0;
+		s.child[1] = seg1;
+
+		return outcomes_.make_node(pair, option0, option1);
+	}
+
+	/* Resume from the last checkpoint before the run
+	 * examined any changed instruction; the first
+	 * checkpoint is always valid, as the segment starts
+	 * where its (unaffected) parent ended. */
+	std::size_t keep = 1;
+	while (keep < old.checkpoints.size() && old.checkpoints[keep].state.furthest_pc() < first_changed) {
+		++keep;
+	}
+
+	segments_->push_back(segment());
+	segment & s = segments_->back();
+	s.interval = old.interval;
+	s.start_to_goal = old.start_to_goal;
+	s.checkpoints.assign(
+		std::make_move_iterator(old.checkpoints.begin()),
+		std::make_move_iterator(old.checkpoints.begin() + keep));
+	for (const auto & advance : old.advances) {
+		if (advance.nsteps <= s.checkpoints.back().nsteps) {
+			s.advances.push_back(advance);
+		}
+	}
+
+	/* loops added or removed by the change are all at or
+	 * after the first changed instruction, and not yet
+	 * entered */
+	run_step_state state(s.checkpoints.back().state);
+	state.change_program(&program_);
+	return explore(state, s.checkpoints.back().nsteps, seg);
+}
+
+void
+alternative_explorer::decide(run_step_state & state, std::size_t pair, std::size_t option) const
+{
+	for (const auto & cell : cells_) {
+		if (cell.pair != pair) {
+			continue;
+		}
+		if (cell.present[option]) {
+			state.set_floor(cell.pos);
+		} else {
+			state.erase(cell.pos);
+		}
+	}
+
+	/* replay placements and removals of pairs decided so
+	 * far; complete once all early pairs are decided */
+	for (const auto & early : early_cells_) {
+		bool touched = false;
+		for (const auto & op : early.ops) {
+			touched = touched || op.pair == pair;
+		}
+		if (!touched) {
+			continue;
+		}
+
+		bool exists = early.exists;
+		run_step_state::tile_t tile = early.initial;
+		for (const auto & op : early.ops) {
+			int choice = choices_[op.pair];
+			if (choice < 0) {
+				continue;
+			}
+			if (!op.present[choice]) {
+				exists = false;
+			} else if (!exists) {
+				exists = true;
+				tile = run_step_state::tile_t();
+				tile.has_floor = true;
+			} else {
+				tile.has_floor = true;
+			}
+		}
+		if (exists) {
+			state.set_tile(early.pos, tile);
+		} else {
+			state.erase(early.pos);
+		}
+	}
+}
+
+std::size_t
+alternative_explorer::begin_segment(const run_step_state & state, int nsteps)
+{
+	if (!segments_) {
+		return no_segment;
+	}
+
+	segments_->push_back(segment());
+	segment & s = segments_->back();
+	s.checkpoints.push_back({state, nsteps});
+	s.interval = checkpoint_interval;
+	s.start_to_goal = puz_.distances.steps(state);
+	return segments_->size() - 1;
+}
+
+void
+alternative_explorer::add_checkpoint(const run_step_state & state, int nsteps, std::size_t seg)
+{
+	segment & s = (*segments_)[seg];
+	if (nsteps - s.checkpoints.back().nsteps < s.interval) {
+		return;
+	}
+
+	if (s.checkpoints.size() >= max_checkpoints) {
+		/* keep every other checkpoint, so long runs use
+		 * bounded memory */
+		std::size_t count = 0;
+		for (std::size_t n = 0; n < s.checkpoints.size(); n += 2) {
+			s.checkpoints[count++] = std::move(s.checkpoints[n]);
+		}
+		s.checkpoints.resize(count);
+		s.interval *= 2;
+		if (nsteps - s.checkpoints.back().nsteps < s.interval) {
+			return;
+		}
+	}
+
+	s.checkpoints.push_back({state, nsteps});
+}
+
+void
+alternative_explorer::note_advance(const run_step_state & state, int nsteps, std::size_t seg)
+{
+	segment & s = (*segments_)[seg];
+	std::size_t furthest = s.advances.empty() ? s.checkpoints.front().state.furthest_pc() : s.advances.back().furthest_pc;
+	if (state.furthest_pc() > furthest) {
+		s.advances.push_back({state.furthest_pc(), nsteps, puz_.distances.steps(state)});
+	}
+}
+
+/* Steps of a run that has taken nsteps and not ended yet,
+ * to_goal from the goal. */
+int
+final_steps_bound(int nsteps, int to_goal)
+{
+	if (to_goal == goal_distance::unreachable) {
+		return std::numeric_limits<int>::max();
+	}
+	return nsteps + std::max(1, to_goal);
+}
+
+int
+worst_steps_bound(const std::vector<segment> & segments, std::size_t seg, std::size_t pc)
+{
+	const segment & s = segments[seg];
+	if (s.checkpoints.front().state.furthest_pc() >= pc) {
+		return final_steps_bound(s.checkpoints.front().nsteps, s.start_to_goal);
+	}
+	for (const auto & advance : s.advances) {
+		if (advance.furthest_pc >= pc) {
+			return final_steps_bound(advance.nsteps, advance.to_goal);
+		}
+	}
+	if (s.pair < 0) {
+		return s.end_steps;
+	}
+	return std::max(
+		worst_steps_bound(segments, s.child[0], pc),
+		worst_steps_bound(segments, s.child[1], pc));
+}
+
+}
+
+void
+alternative_exploration::reset()
+{
+	segments_.clear();
+	outcomes_.clear();
+	program_ = command_program();
+	simulated_steps_ = 0;
+}
+
+void
+alternative_exploration::update(const puzzle & puz, const command_sequence & commands)
+{
+	command_program program;
+	program.compile(commands);
+	update(puz, std::move(program));
+}
+
+bool
+alternative_exploration::update(
+	const puzzle & puz,
+	command_program program,
+	const std::atomic<bool> * cancel)
+{
+	std::size_t first_changed = program.first_difference(program_);
+	program_ = std::move(program);
+
+	std::vector<segment> old_segments;
+	old_segments.swap(segments_);
+
+	alternative_explorer explorer(puz, program_, outcomes_);
+	explorer.record(&segments_);
+	explorer.set_cancel(cancel);
+	explorer.set_stop_hopeless(stop_hopeless_);
+	explorer.set_max_steps(max_steps_);
+	explorer.replay(old_segments, first_changed);
+	simulated_steps_ = explorer.simulated_steps();
+
+	return !explorer.cancelled();
+}
+
+std::size_t
+alternative_exploration::failure_pc() const noexcept
+{
+	std::size_t pc = std::numeric_limits<std::size_t>::max();
+	for (const auto & s : segments_) {
+		if (s.pair < 0 && s.score != std::numeric_limits<int>::max()) {
+			pc = std::min(pc, s.end_pc);
+		}
+	}
+	return pc;
+}
+
+std::uint64_t
+alternative_exploration::end_state(const std::vector<std::size_t> & alternatives) const
+{
+	if (segments_.empty()) {
+		return 0;
+	}
+
+	std::size_t seg = 0;
+	while (segments_[seg].pair >= 0) {
+		std::size_t pair = segments_[seg].pair;
+		seg = segments_[seg].child[pair < alternatives.size() ? alternatives[pair] : 0];
+	}
+	return segments_[seg].end_state;
+}
+
+int
+alternative_exploration::end_steps(const std::vector<std::size_t> & alternatives) const
+{
+	if (segments_.empty()) {
+		return 1;
+	}
+
+	std::size_t seg = 0;
+	while (segments_[seg].pair >= 0) {
+		std::size_t pair = segments_[seg].pair;
+		seg = segments_[seg].child[pair < alternatives.size() ? alternatives[pair] : 0];
+	}
+	return segments_[seg].end_steps;
+}
+
+bool
+alternative_exploration::failure_point(
+	const puzzle & puz,
+	const std::vector<std::size_t> & alternatives,
+	grid_pos_t & pos,
+	std::size_t & pc) const
+{
+	if (segments_.empty()) {
+		/* empty program fails right at the start */
+		pos = puz.start.pos;
+		pc = 0;
+		return true;
+	}
+
+	std::size_t seg = 0;
+	while (segments_[seg].pair >= 0) {
+		std::size_t pair = segments_[seg].pair;
+		seg = segments_[seg].child[pair < alternatives.size() ? alternatives[pair] : 0];
+	}
+	const segment & s = segments_[seg];
+	if (s.score == std::numeric_limits<int>::max()) {
+		return false;
+	}
+	pos = s.fail_pos;
+	pc = s.fail_pc;
+	return true;
+}
+
+void
+alternative_exploration::collect_failures(const puzzle & puz, failure_heatmap & heatmap) const
+{
+	std::size_t num_pairs = puz.alternative_tiles.size();
+	heatmap = failure_heatmap();
+	heatmap.assignments = std::ldexp(1., num_pairs);
+
+	if (segments_.empty()) {
+		heatmap.failures = heatmap.assignments;
+		heatmap.cells(puz.start.pos.x, puz.start.pos.y) = heatmap.assignments;
+		return;
+	}
+
+	/* A run ending after forking on some pairs stands for
+	 * all assignments of the others. Forks only lead to
+	 * segments recorded after them, so walking segments in
+	 * order visits every parent before its children. */
+	std::vector<std::size_t> decided(segments_.size(), 0);
+	std::vector<double> instructions(program_.size(), 0.);
+	for (std::size_t seg = 0; seg < segments_.size(); ++seg) {
+		const segment & s = segments_[seg];
+		if (s.pair >= 0) {
+			decided[s.child[0]] = decided[seg] + 1;
+			decided[s.child[1]] = decided[seg] + 1;
+			continue;
+		}
+		if (s.score == std::numeric_limits<int>::max()) {
+			continue;
+		}
+		double count = std::ldexp(1., num_pairs - decided[seg]);
+		heatmap.failures += count;
+		heatmap.cells(s.fail_pos.x, s.fail_pos.y) += count;
+		instructions[s.fail_pc] += count;
+	}
+
+	for (std::size_t pc = 0; pc < instructions.size(); ++pc) {
+		const command_point * cpt = program_.point(pc);
+		if (!instructions[pc] || !cpt) {
+			continue;
+		}
+		if (!heatmap.commands.empty() && heatmap.commands.back().first == cpt) {
+			heatmap.commands.back().second += instructions[pc];
+		} else {
+			heatmap.commands.emplace_back(cpt, instructions[pc]);
+		}
+	}
+}
+
+int
+alternative_exploration::worst_steps() const noexcept
+{
+	int steps = 1;
+	for (const auto & s : segments_) {
+		if (s.pair < 0) {
+			steps = std::max(steps, s.end_steps);
+		}
+	}
+	return steps;
+}
+
+int
+alternative_exploration::worst_steps_bound(std::size_t pc) const
+{
+	if (segments_.empty()) {
+		/* empty program: anything else takes a step */
+		return 2;
+	}
+	return ::worst_steps_bound(segments_, 0, pc);
+}
+
+void
+explore_alternatives(
+	const puzzle & puz,
+	const command_program & program,
+	alternative_outcomes & outcomes,
+	int max_steps)
+{
+	alternative_explorer explorer(puz, program, outcomes);
+	explorer.set_max_steps(max_steps);
+	explorer.run();
+}
+
+bool
+profile_alternatives(
+	const puzzle & puz,
+	const command_program & program,
+	execution_profile & profile,
+	const std::atomic<bool> * cancel,
+	int max_steps)
+{
+	profile = execution_profile();
+	profile.assignments = std::ldexp(1., puz.alternative_tiles.size());
+	profile.steps.assign(program.size(), 0.);
+
+	alternative_outcomes outcomes;
+	alternative_explorer explorer(puz, program, outcomes);
+	explorer.set_profile(profile.steps.data());
+	explorer.set_cancel(cancel);
+	explorer.set_max_steps(max_steps);
+	explorer.run();
+
+	for (std::size_t pc = 0; pc < program.size(); ++pc) {
+		if (program[pc].is_step()) {
+			profile.total_steps += profile.steps[pc];
+			profile.commands.emplace_back(program.point(pc), profile.steps[pc]);
+		}
+	}
+
+	return !explorer.cancelled();
+}
@@ -0,0 +1,340 @@
+#ifndef ALTERNATIVE_EXPLORER_H
+#define ALTERNATIVE_EXPLORER_H
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "command_program.h"
+#include "puzzle.h"
+#include "run_engine.h"
+
+/* Outcome of a program under all floor alternative
+ * assignments, as a decision diagram over alternative
+ * pairs. Every path from the root decides some pairs and
+ * ends in a leaf holding the score (see
+ * simulate_execution) of all assignments that agree with
+ * the decisions on the path; pairs not decided on the
+ * path do not influence the outcome. Identical subtrees
+ * are shared, and decisions that do not change the
+ * outcome are left out. */
+class alternative_outcomes {
+public:
+	using node_id = std::uint32_t;
+
+	struct node {
+		/* pair decided by this node, or -1 for leaf */
+		int pair;
+		/* successor if pair takes option 0 / 1 */
+		node_id child[2];
+		/* score of leaf */
+		int score;
+
+		inline bool is_leaf() const noexcept { return pair < 0; }
+	};
+
+	void
+	clear();
+
+	inline node_id root() const noexcept { return root_; }
+
+	inline const node &
+	operator[](node_id id) const noexcept { return nodes_[id]; }
+
+	inline std::size_t size() const noexcept { return nodes_.size(); }
+
+	/* Lowest score below given node. */
+	int
+	min_score(node_id id) const;
+
+	/* Score for given (complete) assignment. */
+	int
+	score(const std::vector<std::size_t> & alternatives) const;
+
+	/* Change given assignment to one with lowest score, by
+	 * following decisions towards it from the root. Where
+	 * both options lead there, and for pairs not decided on
+	 * the path, entries are left as they are. */
+	void
+	lowest_assignment(std::vector<std::size_t> & alternatives) const;
+
+	/* One assignment of num_pairs pairs for every path from
+	 * the root to a leaf, taking the decisions on the path
+	 * and option 0 for all other pairs. Runs under them end
+	 * in every way runs of the program can, and there are
+	 * no more of them than runs explored. */
+	std::vector<std::vector<std::size_t>>
+	path_assignments(std::size_t num_pairs) const;
+
+	node_id
+	make_leaf(int score);
+
+	node_id
+	make_node(int pair, node_id option0, node_id option1);
+
+	inline void set_root(node_id root) noexcept { root_ = root; }
+
+private:
+	/* path_assignments below node id, with alternatives
+	 * holding the decisions on the path to it */
+	void
+	add_paths(
+		node_id id,
+		std::vector<std::size_t> & alternatives,
+		std::vector<std::vector<std::size_t>> & result) const;
+
+	std::vector<node> nodes_;
+	std::vector<int> min_scores_;
+	std::map<int, node_id> leaves_;
+	std::map<std::tuple<int, node_id, node_id>, node_id> decisions_;
+	node_id root_ = 0;
+};
+
+/* Where runs of a program fail, over all floor alternative
+ * assignments: every failing assignment is counted once for
+ * the cell where its run failed, and once for the command
+ * that took the last step (see
+ * alternative_exploration::failure_point). Counts are
+ * floating point, as puzzles may have more pairs than an
+ * integer could count the assignments of; they are exact
+ * up to 2^53. */
+struct failure_heatmap {
+	/* assignments in total, and those failing */
+	double assignments = 0.;
+	double failures = 0.;
+
+	/* failing assignments per cell */
+	grid_tpl<double> cells;
+
+	/* failing assignments per command, in program order;
+	 * points only identify commands, and are not owned */
+	std::vector<std::pair<const command_point *, double>> commands;
+};
+
+/* Simulates execution under all floor alternative
+ * assignments of the puzzle. A single run is carried out
+ * until it inspects the floor of an alternative tile for
+ * the first time, and only then forks into both options
+ * of the pair the tile belongs to. Cost thus depends on
+ * the number of pairs a program actually observes, not on
+ * the total number of pairs. Runs fail after max_steps
+ * steps, as in run_simulation; programs looping forever
+ * (rep0) need that. */
+void
+explore_alternatives(
+	const puzzle & puz,
+	const command_program & program,
+	alternative_outcomes & outcomes,
+	int max_steps = std::numeric_limits<int>::max());
+
+/* Steps taken by every command of a program, summed over
+ * runs under all floor alternative assignments: commands
+ * inside loops take many, commands never reached none. A
+ * fwd2 or fwd3 takes a step per field moved. Counts are
+ * floating point, as in failure_heatmap. */
+struct execution_profile {
+	/* assignments in total, and steps of all their runs
+	 * (not counting setup of alternatives) */
+	double assignments = 0.;
+	double total_steps = 0.;
+
+	/* steps per instruction, indexed by program counter;
+	 * only step instructions (see command_instruction::
+	 * is_step) take any */
+	std::vector<double> steps;
+
+	/* step instructions in program order, each with the
+	 * command compiled into it and its steps; points only
+	 * identify commands, and are not owned */
+	std::vector<std::pair<const command_point *, double>> commands;
+};
+
+/* Profile program under all floor alternatives. Runs fork
+ * only where they observe alternatives, and end after
+ * max_steps, as in explore_alternatives; counting a step is
+ * a single addition to a flat array. Stops early if cancel
+ * becomes set, and returns false; the profile is incomplete
+ * then. */
+bool
+profile_alternatives(
+	const puzzle & puz,
+	const command_program & program,
+	execution_profile & profile,
+	const std::atomic<bool> * cancel = nullptr,
+	int max_steps = std::numeric_limits<int>::max());
+
+/* Exploration of all floor alternatives that can be
+ * repeated cheaply after the program has been edited. Runs
+ * are recorded as segments between forks, with state
+ * checkpoints taken periodically along each segment. On
+ * update, every run resumes from its last checkpoint that
+ * only depends on instructions before the first changed
+ * one, so an edit near the end of a long program only
+ * re-simulates the steps after it. */
+class alternative_exploration {
+public:
+	/* State at some point of a recorded run. */
+	struct checkpoint {
+		run_step_state state;
+		int nsteps;
+	};
+
+	/* Point where furthest_pc (see run_step_state) of a run
+	 * grew: steps taken so far, and fewest steps from there
+	 * to the goal (see goal_distance). */
+	struct advance {
+		std::size_t furthest_pc;
+		int nsteps;
+		int to_goal;
+	};
+
+	/* Part of a run up to a fork or the end of the run. */
+	struct segment {
+		/* first checkpoint is the start of the segment */
+		std::vector<checkpoint> checkpoints;
+		/* steps between checkpoints */
+		int interval;
+		/* furthest instruction examined until end of
+		 * segment; maximum value if run was cancelled
+		 * before its end */
+		std::size_t end_pc;
+		/* pair forked at end, -1 if run ended */
+		int pair;
+		/* score, and how it ended, if run ended */
+		int score;
+		simulation_result::outcome_t outcome;
+		/* board_hash of final state if run ended */
+		std::uint64_t end_state;
+		/* steps taken (counted as in score) at the end of
+		 * the run, if it ended */
+		int end_steps;
+		/* if the run ended without reaching the goal: cell
+		 * the robot ended on (or dropped onto), and
+		 * instruction of the last step taken */
+		grid_pos_t fail_pos;
+		std::size_t fail_pc;
+		/* fewest steps from first checkpoint to the goal */
+		int start_to_goal;
+		/* whenever furthest_pc grew beyond its value at the
+		 * first checkpoint */
+		std::vector<advance> advances;
+		/* segments continuing after fork */
+		std::size_t child[2];
+	};
+
+	alternative_exploration() = default;
+	alternative_exploration(const alternative_exploration &) = delete;
+	alternative_exploration & operator=(const alternative_exploration &) = delete;
+
+	/* Drop all recorded runs, needs to be called when
+	 * puzzle changes. */
+	void
+	reset();
+
+	/* End runs as failed once the robot cannot reach the
+	 * goal any more, see simulate_execution. Scores and
+	 * end states of such runs change, failure_pc is still
+	 * valid. Applies to runs simulated from then on. */
+	inline void
+	set_stop_hopeless(bool stop) noexcept { stop_hopeless_ = stop; }
+
+	/* End runs as failed after given number of steps, see
+	 * explore_alternatives. Applies to runs simulated from
+	 * then on. */
+	inline void
+	set_max_steps(int max_steps) noexcept { max_steps_ = max_steps; }
+
+	/* Explore given program, reusing recorded runs of
+	 * the previous program as far as they are unaffected
+	 * by differences. */
+	void
+	update(const puzzle & puz, const command_sequence & commands);
+
+	/* As above, for a program compiled elsewhere. Stops
+	 * early if cancel becomes set, and returns false; the
+	 * outcomes are meaningless then, but runs recorded so
+	 * far are kept and continued by the next update. */
+	bool
+	update(
+		const puzzle & puz,
+		command_program program,
+		const std::atomic<bool> * cancel = nullptr);
+
+	inline const alternative_outcomes &
+	outcomes() const noexcept { return outcomes_; }
+
+	/* Program last explored. */
+	inline const command_program &
+	program() const noexcept { return program_; }
+
+	/* Runs recorded, see segment. */
+	inline const std::vector<segment> &
+	segments() const noexcept { return segments_; }
+
+	/* Lowest furthest_pc (see run_step_state) of all runs
+	 * that fail, maximum value if none does. Any program
+	 * that agrees with the explored one on all instructions
+	 * up to this one fails as well. */
+	std::size_t
+	failure_pc() const noexcept;
+
+	/* Where the run under given assignment ended: board
+	 * and robot (see run_step_state::board_hash), or a
+	 * fixed value if it reached the goal. */
+	std::uint64_t
+	end_state(const std::vector<std::size_t> & alternatives) const;
+
+	/* Steps taken by the run under given assignment,
+	 * counted as in its score. */
+	int
+	end_steps(const std::vector<std::size_t> & alternatives) const;
+
+	/* Where the run under given assignment failed: cell the
+	 * robot ended on (or dropped onto), and instruction of
+	 * the last step taken, or the end of the program if it
+	 * is empty. Returns false if the run reached the goal. */
+	bool
+	failure_point(
+		const puzzle & puz,
+		const std::vector<std::size_t> & alternatives,
+		grid_pos_t & pos,
+		std::size_t & pc) const;
+
+	/* Failures of all runs, see failure_heatmap. Takes time
+	 * in the number of recorded runs, not of assignments. */
+	void
+	collect_failures(const puzzle & puz, failure_heatmap & heatmap) const;
+
+	/* Largest number of steps taken by any run. */
+	int
+	worst_steps() const noexcept;
+
+	/* Lower bound on worst_steps of any program that
+	 * agrees with the explored one on all instructions up
+	 * to pc and reaches the goal under all assignments:
+	 * runs are the same until they first examine an
+	 * instruction at or after pc, and need at least one
+	 * more step from there, or as many as the goal is away
+	 * (see puzzle::distances). */
+	int
+	worst_steps_bound(std::size_t pc) const;
+
+	/* Number of steps simulated by last update. */
+	inline std::size_t
+	simulated_steps() const noexcept { return simulated_steps_; }
+
+private:
+	command_program program_;
+	alternative_outcomes outcomes_;
+	/* run from start of program is first segment; none
+	 * if program is empty */
+	std::vector<segment> segments_;
+	std::size_t simulated_steps_ = 0;
+	bool stop_hopeless_ = false;
+	int max_steps_ = std::numeric_limits<int>::max();
+};
+
+#endif
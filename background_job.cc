@@ -0,0 +1,56 @@
+#include "background_job.h"
+
+background_job::~background_job()
+{
+	{
+		std::unique_lock<std::mutex> guard(mutex_);
+		exit_ = true;
+	}
+	cancel_.store(true, std::memory_order_relaxed);
+	wake_.notify_one();
+	if (thread_.joinable()) {
+		thread_.join();
+	}
+}
+
+background_job::background_job()
+	: cancel_(false)
+{
+}
+
+void
+background_job::start(std::function<void()> fn)
+{
+	thread_ = std::thread(std::move(fn));
+}
+
+std::uint64_t
+background_job::post()
+{
+	have_request_ = true;
+	++generation_;
+	cancel_.store(true, std::memory_order_relaxed);
+	wake_.notify_one();
+	return generation_;
+}
+
+void
+background_job::drop()
+{
+	have_request_ = false;
+	++generation_;
+	cancel_.store(true, std::memory_order_relaxed);
+}
+
+bool
+background_job::wait(std::unique_lock<std::mutex> & guard, std::uint64_t & generation)
+{
+	wake_.wait(guard, [this](){ return exit_ || have_request_; });
+	if (exit_) {
+		return false;
+	}
+	have_request_ = false;
+	generation = generation_;
+	cancel_.store(false, std::memory_order_relaxed);
+	return true;
+}
@@ -0,0 +1,87 @@
+#ifndef BACKGROUND_JOB_H
+#define BACKGROUND_JOB_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/* Dedicated thread working on requests of a caller, where
+ * only the latest request matters. Every request gets a
+ * new generation and cancels work in progress; work of an
+ * earlier generation must not post its result.
+ *
+ * The mutex guards the request data of the owner as well,
+ * which the thread takes with it held, see wait. Destroying
+ * the job stops and joins the thread, so it should be the
+ * last member of its owner. */
+class background_job {
+public:
+	~background_job();
+
+	background_job();
+
+	background_job(const background_job & other) = delete;
+	background_job & operator=(const background_job & other) = delete;
+
+	/* Runs fn on the thread; it must return once wait
+	 * does. */
+	void
+	start(std::function<void()> fn);
+
+	/* Guards data shared between caller / thread. */
+	inline std::mutex & mutex() const noexcept { return mutex_; }
+
+	/* The following require the mutex to be held. */
+
+	/* Announce a request, returns its generation. */
+	std::uint64_t
+	post();
+
+	/* Drop any request in progress. */
+	void
+	drop();
+
+	inline std::uint64_t generation() const noexcept { return generation_; }
+
+	/* Whether no request came after given generation. */
+	inline bool
+	current(std::uint64_t generation) const noexcept { return generation == generation_; }
+
+	/* Called by the thread with guard locked: waits for a
+	 * request, which the caller takes with the mutex still
+	 * held, and sets its generation. Returns false once the
+	 * job is being destroyed. */
+	bool
+	wait(std::unique_lock<std::mutex> & guard, std::uint64_t & generation);
+
+	/* Called by the thread once it has posted a result,
+	 * wakes callers of await. */
+	inline void posted() noexcept { posted_.notify_all(); }
+
+	/* Called by the caller with guard locked: waits until
+	 * done() holds, checking whenever a result is posted. */
+	template<typename predicate_t>
+	inline void
+	await(std::unique_lock<std::mutex> & guard, predicate_t done) const { posted_.wait(guard, done); }
+
+	/* Set while the request worked on is outdated, for
+	 * work to poll. */
+	inline const std::atomic<bool> * cancelled() const noexcept { return &cancel_; }
+
+private:
+	mutable std::mutex mutex_;
+	std::condition_variable wake_;
+	mutable std::condition_variable posted_;
+	bool have_request_ = false;
+	/* incremented by every request */
+	std::uint64_t generation_ = 0;
+	bool exit_ = false;
+
+	std::atomic<bool> cancel_;
+	std::thread thread_;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#include "batch_simulation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace {
+
+/* Jobs taken by a worker at once. Single jobs take around a
+ * microsecond, so taking them one by one would make the
+ * shared counter the bottleneck; chunks are kept small
+ * enough that workers still finish at about the same time. */
+constexpr std::size_t chunk_size = 64;
+
+}
+
+batch_simulation_result
+simulate_batch(const std::vector<simulation_job> & jobs, worker_pool * pool)
+{
+	if (!pool) {
+		pool = &worker_pool::shared();
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	batch_simulation_result result;
+	result.results.resize(jobs.size());
+
+	/* one run state per worker, allocated up front: it is
+	 * too large to live on a worker's stack comfortably,
+	 * and initialize() resets all of it anyway */
+	std::vector<std::unique_ptr<run_step_state>> states(pool->size());
+	for (auto & state : states) {
+		state.reset(new run_step_state());
+	}
+	std::vector<std::uint64_t> steps(pool->size(), 0);
+
+	std::atomic<std::size_t> next_job{0};
+	pool->run([&](std::size_t worker)
+	{
+		run_step_state & state = *states[worker];
+		std::uint64_t worker_steps = 0;
+		for (;;) {
+			std::size_t begin = next_job.fetch_add(chunk_size, std::memory_order_relaxed);
+			if (begin >= jobs.size()) {
+				break;
+			}
+			std::size_t end = std::min(begin + chunk_size, jobs.size());
+			for (std::size_t n = begin; n < end; ++n) {
+				const simulation_job & job = jobs[n];
+				state.initialize(*job.puz, job.program);
+				simulation_result & outcome = result.results[n];
+				outcome = run_simulation(*job.puz, state, job.alternatives, job.stop_hopeless, job.max_steps);
+				worker_steps += outcome.steps;
+			}
+		}
+		steps[worker] = worker_steps;
+	});
+
+	for (std::uint64_t worker_steps : steps) {
+		result.simulated_steps += worker_steps;
+	}
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	result.jobs_per_second = result.seconds > 0. ? jobs.size() / result.seconds : 0.;
+
+	return result;
+}
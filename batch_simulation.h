@@ -0,0 +1,45 @@
+#ifndef BATCH_SIMULATION_H
+#define BATCH_SIMULATION_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "command_program.h"
+#include "puzzle.h"
+#include "run_engine.h"
+#include "worker_pool.h"
+
+/* A single simulation of a batch: program run on puzzle
+ * under one alternative assignment (see run_simulation).
+ * Puzzle and program are not owned; many jobs may share
+ * them, and they must stay unchanged until simulate_batch
+ * returns. */
+struct simulation_job {
+	const puzzle * puz = nullptr;
+	const command_program * program = nullptr;
+	std::vector<std::size_t> alternatives;
+	bool stop_hopeless = false;
+	int max_steps = std::numeric_limits<int>::max();
+};
+
+struct batch_simulation_result {
+	/* one per job, in the order of the jobs */
+	std::vector<simulation_result> results;
+
+	/* total steps of all simulations */
+	std::uint64_t simulated_steps = 0;
+	/* wall clock time taken, and throughput */
+	double seconds = 0.;
+	double jobs_per_second = 0.;
+};
+
+/* Runs all jobs, spread across the workers of pool (the
+ * shared one if null). Jobs are handed out in chunks, and
+ * every worker reuses a single run state for all jobs it
+ * takes, so nothing is allocated per job. Must not be
+ * called from within a job of pool. */
+batch_simulation_result
+simulate_batch(const std::vector<simulation_job> & jobs, worker_pool * pool = nullptr);
+
+#endif
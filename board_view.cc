@@ -18,6 +18,19 @@ board_view::clear_floor(int x, int y)
 	grid_.erase(x, y);
 }
 
+void
+board_view::set_ghost_path(std::vector<grid_pos_t> path, bool reaches_goal)
+{
+	ghost_path_ = std::move(path);
+	ghost_reaches_goal_ = reaches_goal;
+}
+
+void
+board_view::set_failure_heatmap(std::vector<std::pair<grid_pos_t, double>> cells)
+{
+	failure_heatmap_ = std::move(cells);
+}
+
 void
 board_view::set_robot_pos(double x, double y, double z, double angle, double tilt, double wheel_rot)
 {
@@ -264,6 +277,79 @@ board_view::draw_board(double global_phase) const
 	});
 }
 
+void
+board_view::draw_ghost_path(double global_phase) const
+{
+	if (ghost_path_.empty()) {
+		return;
+	}
+
+	static const double width = .08;
+	static const double scene_z = .01;
+
+	glDisable(GL_LIGHTING);
+	double a = sin(global_phase * 4) * .15 + .45;
+	glColor4f(.3, .8, 1., a);
+
+	for (std::size_t n = 1; n < ghost_path_.size(); ++n) {
+		double x1 = ghost_path_[n - 1].x;
+		double y1 = ghost_path_[n - 1].y;
+		double x2 = ghost_path_[n].x;
+		double y2 = ghost_path_[n].y;
+		/* perpendicular to the step, moves are axis-parallel */
+		double dx = (y2 - y1) * width;
+		double dy = (x1 - x2) * width;
+		texture_generator::make_tex_quad(texid_solid,
+			x1 - dx, y1 - dy, scene_z,
+			x2 - dx, y2 - dy, scene_z,
+			x2 + dx, y2 + dy, scene_z,
+			x1 + dx, y1 + dy, scene_z,
+			0, 0, +1);
+	}
+
+	/* mark where the run ends */
+	const grid_pos_t & end = ghost_path_.back();
+	if (ghost_reaches_goal_) {
+		glColor4f(.2, 1., .2, a);
+	} else {
+		glColor4f(1., .2, .2, a);
+	}
+	texture_generator::make_tex_quad(texid_solid,
+		end.x - 2 * width, end.y - 2 * width, scene_z,
+		end.x - 2 * width, end.y + 2 * width, scene_z,
+		end.x + 2 * width, end.y + 2 * width, scene_z,
+		end.x + 2 * width, end.y - 2 * width, scene_z,
+		0, 0, +1);
+
+	glEnable(GL_LIGHTING);
+}
+
+void
+board_view::draw_failure_heatmap() const
+{
+	if (failure_heatmap_.empty()) {
+		return;
+	}
+
+	/* below the ghost path */
+	static const double scene_z = .005;
+	static const double size = .45;
+
+	glDisable(GL_LIGHTING);
+	for (const auto & cell : failure_heatmap_) {
+		double x = cell.first.x;
+		double y = cell.first.y;
+		glColor4f(1., .2, .2, .15 + .5 * cell.second);
+		texture_generator::make_tex_quad(texid_solid,
+			x - size, y - size, scene_z,
+			x - size, y + size, scene_z,
+			x + size, y + size, scene_z,
+			x + size, y - size, scene_z,
+			0, 0, +1);
+	}
+	glEnable(GL_LIGHTING);
+}
+
 void
 board_view::draw(std::size_t width, std::size_t height, double global_phase) const
 {
@@ -332,6 +418,8 @@ board_view::draw(
 	glEnable(GL_NORMALIZE);
 
 	draw_board(global_phase);
+	draw_failure_heatmap();
+	draw_ghost_path(global_phase);
 	for (const auto & obstacle : obstacle_pos_) {
 		draw_obstacle(obstacle.second);
 	}
@@ -344,6 +432,8 @@ board_view::reset(const puzzle & puz)
 {
 	grid_.clear();
 	obstacle_pos_.clear();
+	ghost_path_.clear();
+	failure_heatmap_.clear();
 	puz.grid.iterate([this](int x, int y, floor_tile_t tile) {
 		auto & floor = grid_(x, y);
 
@@ -1,6 +1,9 @@
 #ifndef BOARD_VIEW_H
 #define BOARD_VIEW_H
 
+#include <utility>
+#include <vector>
+
 #include "puzzle.h"
 #include "grid.h"
 
@@ -64,6 +67,17 @@ public:
 	void
 	clear_floor(int x, int y);
 
+	/* Predicted path of robot, drawn as a ghost trail;
+	 * empty to hide. */
+	void
+	set_ghost_path(std::vector<grid_pos_t> path, bool reaches_goal);
+
+	/* Cells where runs fail, each with the share of failing
+	 * runs that fail there, drawn as a red overlay; empty
+	 * to hide. */
+	void
+	set_failure_heatmap(std::vector<std::pair<grid_pos_t, double>> cells);
+
 	void
 	draw(std::size_t width, std::size_t height, double global_phase) const;
 
@@ -90,6 +104,12 @@ private:
 	void
 	draw_board(double global_phase) const;
 
+	void
+	draw_ghost_path(double global_phase) const;
+
+	void
+	draw_failure_heatmap() const;
+
 	view_coord_t robot_pos_ = {
 		1., 0., 0., 0., 0.
 	};
@@ -99,6 +119,11 @@ private:
 	std::map<int, view_coord_t> obstacle_pos_;
 
 	grid_t grid_;
+
+	std::vector<grid_pos_t> ghost_path_;
+	bool ghost_reaches_goal_ = false;
+
+	std::vector<std::pair<grid_pos_t, double>> failure_heatmap_;
 };
 
 #endif
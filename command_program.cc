@@ -0,0 +1,150 @@
+#include "command_program.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+constexpr std::size_t command_program::max_loops;
+
+void
+command_program::compile(const command_sequence & seq)
+{
+	instructions_.clear();
+	points_.clear();
+	num_loops_ = 0;
+
+	compile_sequence(seq, nullptr);
+	emit({command_instruction::opcode_t::end, 0, 0, 0, 0}, nullptr);
+}
+
+void
+command_program::compile(
+	const command_sequence & seq,
+	const command_sequence_path & path,
+	command_point & inserted)
+{
+	instructions_.clear();
+	points_.clear();
+	num_loops_ = 0;
+
+	inserted_ = &inserted;
+	compile_sequence(seq, &path);
+	inserted_ = nullptr;
+	emit({command_instruction::opcode_t::end, 0, 0, 0, 0}, nullptr);
+}
+
+std::size_t
+command_program::first_difference(const command_program & other) const
+{
+	std::size_t difference = std::min(size(), other.size());
+	for (std::size_t pc = 0; pc < difference; ++pc) {
+		const command_instruction & a = instructions_[pc];
+		const command_instruction & b = other.instructions_[pc];
+		if (a.op != b.op || a.count != b.count || a.loop != b.loop) {
+			return pc;
+		}
+		if (a.target != b.target) {
+			/* a run only takes a forward jump by examining
+			 * its target */
+			std::size_t target = std::min(a.target, b.target);
+			difference = std::min(difference, target > pc ? target : pc);
+		}
+		/* nested_loops_end only changes along with loops
+		 * further on, whose counters are still unused by
+		 * runs that have not got there */
+	}
+	return difference;
+}
+
+void
+command_program::compile_sequence(const command_sequence & seq, const command_sequence_path * insertion)
+{
+	/* same placement rules as command_sequence::insert */
+	for (std::size_t n = 0; n < seq.size(); ++n) {
+		command_point & cpt = *seq[n];
+		const command_branch_path * branch_insertion = nullptr;
+		if (insertion && insertion->index == n) {
+			if (insertion->branch && insertion->branch->branch < cpt.num_branches()) {
+				branch_insertion = insertion->branch.get();
+			} else {
+				compile_point(*inserted_, nullptr);
+			}
+		}
+		compile_point(cpt, branch_insertion);
+	}
+	if (insertion && insertion->index >= seq.size()) {
+		compile_point(*inserted_, nullptr);
+	}
+}
+
+void
+command_program::compile_point(command_point & cpt, const command_branch_path * insertion)
+{
+	auto branch_insertion = [insertion](std::size_t branch) -> const command_sequence_path *
+	{
+		return insertion && insertion->branch == branch ? &insertion->seq : nullptr;
+	};
+
+	using opcode_t = command_instruction::opcode_t;
+
+	switch (cpt.tile().kind()) {
+		case command_tile::kind_t::left: {
+			emit({opcode_t::left, 1, 0, 0, 0}, &cpt);
+			break;
+		}
+		case command_tile::kind_t::right: {
+			emit({opcode_t::right, 1, 0, 0, 0}, &cpt);
+			break;
+		}
+		case command_tile::kind_t::fwd1: {
+			emit({opcode_t::forward, 1, 0, 0, 0}, &cpt);
+			break;
+		}
+		case command_tile::kind_t::fwd2: {
+			emit({opcode_t::forward, 2, 0, 0, 0}, &cpt);
+			break;
+		}
+		case command_tile::kind_t::fwd3: {
+			emit({opcode_t::forward, 3, 0, 0, 0}, &cpt);
+			break;
+		}
+		case command_tile::kind_t::conditional: {
+			/* conditional falls through into first branch, or
+			 * jumps to second branch; first branch jumps over
+			 * second branch when done */
+			bool has_second = !cpt.branch(1).empty() || branch_insertion(1);
+			std::uint32_t cond = emit({opcode_t::conditional, 0, 0, 0, 0}, &cpt);
+			compile_sequence(cpt.branch(0), branch_insertion(0));
+			std::uint32_t jump = instructions_.size();
+			if (has_second) {
+				emit({opcode_t::jump, 0, 0, 0, 0}, nullptr);
+			}
+			instructions_[cond].target = instructions_.size();
+			compile_sequence(cpt.branch(1), branch_insertion(1));
+			if (has_second) {
+				instructions_[jump].target = instructions_.size();
+			}
+			break;
+		}
+		default: {
+			/* repetitions */
+			if (num_loops_ == max_loops) {
+				throw std::length_error("program has more repeats than a run can count");
+			}
+			std::uint32_t loop = num_loops_++;
+			std::uint32_t rep = emit({opcode_t::repeat, cpt.tile().num_repetitions(), 0, loop, 0}, &cpt);
+			compile_sequence(cpt.branch(0), branch_insertion(0));
+			instructions_[rep].nested_loops_end = num_loops_;
+			emit({opcode_t::loop_end, 0, rep, loop, 0}, nullptr);
+			break;
+		}
+	}
+}
+
+std::uint32_t
+command_program::emit(command_instruction instr, command_point * cpt)
+{
+	std::uint32_t pc = instructions_.size();
+	instructions_.push_back(instr);
+	points_.push_back(cpt);
+	return pc;
+}
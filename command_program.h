@@ -0,0 +1,116 @@
+#ifndef COMMAND_PROGRAM_H
+#define COMMAND_PROGRAM_H
+
+#include <cstdint>
+#include <vector>
+
+#include "tiles.h"
+
+/* Single instruction of a compiled program. */
+struct command_instruction {
+	enum class opcode_t : uint8_t {
+		/* end of program */
+		end = 0,
+		left = 1,
+		right = 2,
+		forward = 3,
+		conditional = 4,
+		repeat = 5,
+		/* end of repeat body: go back to repeat if
+		 * repetitions are left */
+		loop_end = 6,
+		/* unconditional jump */
+		jump = 7
+	};
+
+	opcode_t op;
+
+	/* forward: number of sub-steps
+	 * repeat: number of repetitions */
+	int count;
+
+	/* conditional: start of second branch
+	 * loop_end: corresponding repeat instruction
+	 * jump: destination */
+	std::uint32_t target;
+
+	/* repeat, loop_end: index of loop counter */
+	std::uint32_t loop;
+
+	/* repeat: one past the last loop counter index of all
+	 * loops nested within the repeat body; nested loops
+	 * are numbered consecutively after the enclosing loop */
+	std::uint32_t nested_loops_end;
+
+	/* whether executing the instruction takes a step */
+	inline bool
+	is_step() const noexcept
+	{
+		return op != opcode_t::end && op != opcode_t::loop_end && op != opcode_t::jump;
+	}
+};
+
+/* Linear form of a command_sequence, executed by program
+ * counter instead of walking the command tree. Every step
+ * instruction maps back to the command_point it was
+ * compiled from. */
+class command_program {
+public:
+	/* Loop counters a run has room for (see run_step_state),
+	 * one per repeat tile. */
+	static constexpr std::size_t max_loops = 32;
+
+	/* Lower given tree into instructions, replacing any
+	 * previous contents. Throws std::length_error if it has
+	 * more than max_loops repeats. */
+	void
+	compile(const command_sequence & seq);
+
+	/* As above, for the program that results from inserting
+	 * given point at path (see command_sequence::insert),
+	 * without modifying the tree. */
+	void
+	compile(
+		const command_sequence & seq,
+		const command_sequence_path & path,
+		command_point & inserted);
+
+	inline std::size_t size() const noexcept { return instructions_.size(); }
+
+	inline const command_instruction &
+	operator[](std::size_t pc) const noexcept { return instructions_[pc]; }
+
+	/* Command point an instruction was compiled from,
+	 * nullptr for control flow instructions. */
+	inline command_point *
+	point(std::size_t pc) const noexcept { return points_[pc]; }
+
+	inline std::size_t num_loops() const noexcept { return num_loops_; }
+
+	/* Index of first instruction from which on the programs
+	 * may differ: a run that has only examined instructions
+	 * before it (see run_step_state::furthest_pc) proceeds
+	 * identically under both. Returns size() if programs
+	 * are identical. */
+	std::size_t
+	first_difference(const command_program & other) const;
+
+private:
+	/* insertion: where to insert inserted_ within this
+	 * sequence, nullptr for nowhere */
+	void
+	compile_sequence(const command_sequence & seq, const command_sequence_path * insertion);
+
+	void
+	compile_point(command_point & cpt, const command_branch_path * insertion);
+
+	std::uint32_t
+	emit(command_instruction instr, command_point * cpt);
+
+	std::vector<command_instruction> instructions_;
+	std::vector<command_point *> points_;
+	std::size_t num_loops_ = 0;
+	command_point * inserted_ = nullptr;
+};
+
+#endif
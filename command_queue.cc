@@ -6,6 +6,30 @@
 
 #include "texgen.h"
 
+namespace {
+
+using tint_list = std::vector<std::pair<const command_point *, tile_tint_t>>;
+
+void
+set_point_tints(const command_point & cpt, const tint_list & tints)
+{
+	tile_tint_t tint;
+	for (const auto & entry : tints) {
+		if (entry.first == &cpt) {
+			tint = entry.second;
+			break;
+		}
+	}
+	cpt.tile().set_tint(tint);
+	for (std::size_t n = 0; n < cpt.num_branches(); ++n) {
+		for (const auto & inner : cpt.branch(n)) {
+			set_point_tints(*inner, tints);
+		}
+	}
+}
+
+}
+
 class command_queue_drag final : public command_tile_drag {
 public:
 	virtual
@@ -100,14 +124,16 @@ void
 command_queue::rearrange()
 {
 	seq_.compute_layout({}, layout_);
-	seq_.apply_layout(layout_, x_origin(), y_origin(), tile_display_args_.command_point_size, false);
+	apply_idle_layout(false);
 }
 
 void
 command_queue::reset()
 {
 	seq_.clear();
+	++revision_;
 	layout_.clear();
+	hint_.reset();
 	locked_ = false;
 }
 
@@ -124,6 +150,10 @@ command_queue::drag_begin(double x, double y)
 	if (!cpt) {
 		return {};
 	}
+	++revision_;
+	hint_.reset();
+	/* tints belong to the program, not to tiles taken out */
+	set_point_tints(*cpt, {});
 	std::unique_ptr<command_tile_drag> drag(new command_queue_drag(this, std::move(cpt), std::move(path), tile_display_args_));
 	seq_.compute_layout({}, layout_);
 	seq_.apply_layout(layout_, x_origin(), y_origin(), tile_display_args_.command_point_size, false);
@@ -144,6 +174,7 @@ command_queue::drag_hover_enter(double x, double y, command_tile_drag * drag)
 	command_sequence_path new_path = seq_.compute_path(layout_, x - x_origin(), y - y_origin(), tile_display_args_.command_point_size);
 	bool changed_insertion_position = new_hover || (new_path != hover_->path);
 	if (changed_insertion_position) {
+		++hover_revision_;
 		hover_->path = std::move(new_path);
 		seq_.compute_layout({&hover_->path, &hover_->item_extents}, hover_->layout);
 		seq_.apply_layout(hover_->layout, x_origin(), y_origin(), tile_display_args_.command_point_size, false);
@@ -155,7 +186,8 @@ command_queue::drag_hover_leave(command_tile_drag * drag)
 {
 	if (hover_) {
 		hover_.reset();
-		seq_.apply_layout(layout_, x_origin(), y_origin(), tile_display_args_.command_point_size, false);
+		++hover_revision_;
+		apply_idle_layout(false);
 	}
 }
 
@@ -163,6 +195,7 @@ void
 command_queue::drag_finish(double x, double y, std::unique_ptr<command_tile_drag> drag)
 {
 	hover_.reset();
+	++hover_revision_;
 	command_sequence_path path = seq_.compute_path(layout_, x - x_origin(), y - y_origin(), tile_display_args_.command_point_size);
 	insert_at(path, drag->consume());
 }
@@ -192,6 +225,9 @@ command_queue::redraw(double global_phase)
 	}
 	seq_.draw_flows(global_phase, tile_display_args_);
 	seq_.draw(global_phase, tile_display_args_);
+	if (hint_ && !hover_) {
+		hint_->item->draw(global_phase, tile_display_args_);
+	}
 }
 
 void
@@ -205,7 +241,7 @@ command_queue::set_bounds(double x1, double y1, double x2, double y2)
 	if (hover_) {
 		seq_.apply_layout(hover_->layout, x_origin(), y_origin(), tile_display_args_.command_point_size, true);
 	} else {
-		seq_.apply_layout(layout_, x_origin(), y_origin(), tile_display_args_.command_point_size, true);
+		apply_idle_layout(true);
 	}
 }
 
@@ -228,6 +264,17 @@ command_queue::animate(double now)
 	seq_.animate(now);
 }
 
+bool
+command_queue::compile_hover(command_program & program) const
+{
+	if (!hover_) {
+		return false;
+	}
+
+	program.compile(seq_, hover_->path, *hover_->item);
+	return true;
+}
+
 command_sequence_path
 command_queue::compute_position(double x, double y) const
 {
@@ -240,6 +287,62 @@ command_queue::insert_at(
 	std::unique_ptr<command_point> cpt)
 {
 	seq_.insert(path, std::move(cpt));
+	++revision_;
+	hint_.reset();
 	seq_.compute_layout({}, layout_);
 	seq_.apply_layout(layout_, x_origin(), y_origin(), tile_display_args_.command_point_size, false);
 }
+
+void
+command_queue::set_hint(command_tile::kind_t kind, command_sequence_path path)
+{
+	std::unique_ptr<command_point> cpt(new command_point(
+		std::unique_ptr<command_tile>(new command_tile(kind, 0.))));
+	cpt->tile().set_state(command_tile::state_t::flashing);
+
+	hint_.reset(new hint_state);
+	hint_->item = cpt.get();
+	hint_->ghost = seq_;
+	hint_->ghost.insert(path, std::move(cpt));
+	hint_->path = std::move(path);
+	if (!hover_) {
+		apply_idle_layout(false);
+	}
+}
+
+void
+command_queue::clear_hint()
+{
+	if (hint_) {
+		hint_.reset();
+		if (!hover_) {
+			apply_idle_layout(false);
+		}
+	}
+}
+
+void
+command_queue::set_tints(const tint_list & tints)
+{
+	for (const auto & cpt : seq_) {
+		set_point_tints(*cpt, tints);
+	}
+}
+
+void
+command_queue::apply_idle_layout(bool warp)
+{
+	if (!hint_) {
+		seq_.apply_layout(layout_, x_origin(), y_origin(), tile_display_args_.command_point_size, warp);
+		return;
+	}
+
+	commands_layout ghost_layout;
+	hint_->ghost.compute_layout({}, ghost_layout);
+	hint_->ghost.apply_layout(ghost_layout, x_origin(), y_origin(), tile_display_args_.command_point_size, true);
+
+	commands_layout item_layout;
+	layout_extents item_extents = hint_->item->compute_layout({}, item_layout);
+	seq_.compute_layout({&hint_->path, &item_extents}, hint_->layout);
+	seq_.apply_layout(hint_->layout, x_origin(), y_origin(), tile_display_args_.command_point_size, warp);
+}
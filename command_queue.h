@@ -1,6 +1,11 @@
 #ifndef COMMAND_QUEUE_H
 #define COMMAND_QUEUE_H
 
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "command_program.h"
 #include "command_tile_owner.h"
 
 class command_queue final : public command_tile_owner {
@@ -52,6 +57,36 @@ public:
 	inline const command_sequence &
 	commands() const noexcept;
 
+	/* Changes whenever the program is modified. */
+	inline std::uint64_t
+	revision() const noexcept;
+
+	/* Changes whenever a hovering tile moves to another
+	 * insertion position, or stops hovering. */
+	inline std::uint64_t
+	hover_revision() const noexcept;
+
+	/* Compile the program that dropping the hovering tile
+	 * would result in; returns false if no tile hovers. */
+	bool
+	compile_hover(command_program & program) const;
+
+	/* Show a tile of given kind at path, which must be an
+	 * insertion position, as a suggestion: room is made for
+	 * it while no tile hovers. Any change of the program
+	 * drops it. */
+	void
+	set_hint(command_tile::kind_t kind, command_sequence_path path);
+
+	void
+	clear_hint();
+
+	/* Tint tiles of the program: tiles of listed points get
+	 * the tint listed with them, all others none. Points
+	 * only identify tiles, and may be stale. */
+	void
+	set_tints(const std::vector<std::pair<const command_point *, tile_tint_t>> & tints);
+
 private:
 	struct hover_state {
 		command_point * item;
@@ -60,6 +95,21 @@ private:
 		commands_layout layout;
 	};
 
+	struct hint_state {
+		command_sequence_path path;
+		/* program with the tile inserted, laid out so that
+		 * the tile is where it would go; only the tile is
+		 * drawn */
+		command_sequence ghost;
+		command_point * item;
+		commands_layout layout;
+	};
+
+	/* Lay out program with room for hint, or without if
+	 * there is none. */
+	void
+	apply_idle_layout(bool warp);
+
 	inline double x_origin() const noexcept
 	{
 		return bounds_.x1 + 80;
@@ -73,8 +123,11 @@ private:
 	bounds_t bounds_;
 
 	command_sequence seq_;
+	std::uint64_t revision_ = 0;
 	commands_layout layout_;
 	std::unique_ptr<hover_state> hover_;
+	std::uint64_t hover_revision_ = 0;
+	std::unique_ptr<hint_state> hint_;
 
 	bool locked_ = false;
 
@@ -93,5 +146,17 @@ command_queue::commands() const noexcept
 	return seq_;
 }
 
+inline std::uint64_t
+command_queue::revision() const noexcept
+{
+	return revision_;
+}
+
+inline std::uint64_t
+command_queue::hover_revision() const noexcept
+{
+	return hover_revision_;
+}
+
 
 #endif
@@ -0,0 +1,1607 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "alternative_explorer.h"
+#include "batch_simulation.h"
+#include "program_solver.h"
+#include "puzzle.h"
+#include "run_engine.h"
+#include "worker_pool.h"
+
+/* Differential fuzzer for the run engine. Random puzzles
+ * (floor, obstacles, trap doors with triggers, alternative
+ * pairs) and random programs are run through every path
+ * that executes programs, and the results are compared with
+ * a plain step by step run, as recorded for the animation
+ * (see run_trace::record):
+ *
+ * - that run must end as and after as many steps as in
+ *   tree_interpreter, which follows the rules on its own;
+ * - every step of that run must begin where the steps shown
+ *   before it left the robot, and leave robot and obstacles
+ *   where the engine has them afterwards, and it must not
+ *   reach the goal once goal_distance finds it hopeless;
+ * - run_simulation and simulate_execution, with and without
+ *   stop_hopeless or a step limit, and simulate_batch;
+ * - explore_alternatives, with and without a step limit,
+ *   and alternative_exploration both fresh and updated from
+ *   a different program (resuming from checkpoints),
+ *   including where its runs fail and the failure heatmap
+ *   collected from them;
+ * - profile_alternatives, against steps taken by every
+ *   instruction.
+ *
+ * With -S, puzzles provide a few random tiles instead, and
+ * solve_puzzle is checked against running every program
+ * that can be built from them (see solver_checker).
+ *
+ * Cases are checked in parallel; the lowest numbered case
+ * found to diverge is then minimized (tiles, obstacles,
+ * traps, alternatives and floor are taken away as long as
+ * the same path still diverges) and printed: divergence,
+ * program, and puzzle in the text format of the built-in
+ * ones (see puzzle.cc). Exits with status 1 then. Which
+ * case is reported only depends on the seed. Progress goes
+ * to stderr. Programs never contain rep0, which would loop
+ * forever outside the animation. */
+
+namespace {
+
+/* splitmix64, so that neighbouring case numbers give
+ * unrelated seeds */
+std::uint64_t
+case_seed(std::uint64_t seed, std::uint64_t n)
+{
+	std::uint64_t x = seed + (n + 1) * 0x9e3779b97f4a7c15ull;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+const char *
+tile_name(command_tile::kind_t kind)
+{
+	switch (kind) {
+		case command_tile::kind_t::left: return "left";
+		case command_tile::kind_t::right: return "right";
+		case command_tile::kind_t::fwd1: return "fwd1";
+		case command_tile::kind_t::fwd2: return "fwd2";
+		case command_tile::kind_t::fwd3: return "fwd3";
+		case command_tile::kind_t::conditional: return "conditional";
+		case command_tile::kind_t::rep0: return "rep0";
+		case command_tile::kind_t::rep1: return "rep1";
+		case command_tile::kind_t::rep2: return "rep2";
+		case command_tile::kind_t::rep3: return "rep3";
+		case command_tile::kind_t::rep4: return "rep4";
+		case command_tile::kind_t::rep5: return "rep5";
+		default: return "?";
+	}
+}
+
+/* Tile names in program order, branches in parentheses,
+ * e.g. "fwd1 rep2(left fwd2) conditional(fwd1)()". */
+std::string
+describe(const command_sequence & seq)
+{
+	std::string result;
+	for (const auto & cpt : seq) {
+		if (!result.empty()) {
+			result += ' ';
+		}
+		result += tile_name(cpt->tile().kind());
+		for (std::size_t n = 0; n < cpt->num_branches(); ++n) {
+			result += '(' + describe(cpt->branch(n)) + ')';
+		}
+	}
+	return result;
+}
+
+void
+count_tiles(const command_sequence & seq, std::map<command_tile::kind_t, std::size_t> & tiles)
+{
+	for (const auto & cpt : seq) {
+		++tiles[cpt->tile().kind()];
+		for (std::size_t n = 0; n < cpt->num_branches(); ++n) {
+			count_tiles(cpt->branch(n), tiles);
+		}
+	}
+}
+
+std::unique_ptr<command_point>
+make_point(command_tile::kind_t kind)
+{
+	return std::unique_ptr<command_point>(new command_point(
+		std::unique_ptr<command_tile>(new command_tile(kind, 0.))));
+}
+
+struct fuzz_options {
+	/* largest width and height of the floor */
+	int max_size = 6;
+	std::size_t max_obstacles = 3;
+	std::size_t max_traps = 2;
+	/* every assignment is checked, so this must stay
+	 * small */
+	std::size_t max_alternatives = 4;
+	std::size_t max_tiles = 10;
+};
+
+class case_generator {
+public:
+	case_generator(std::uint64_t seed, const fuzz_options & options)
+		: random_(seed), options_(options)
+	{
+	}
+
+	/* Random puzzle, as read back from its text so that it
+	 * can be reproduced from what is printed. Start, goal and
+	 * obstacles are on plain floor, and alternative tiles
+	 * off the floor, as the text format has them. */
+	puzzle
+	make_puzzle()
+	{
+		puzzle puz;
+		int width = pick(2, options_.max_size);
+		int height = pick(2, options_.max_size);
+
+		std::vector<grid_pos_t> floor, holes;
+		for (int x = 0; x < width; ++x) {
+			for (int y = 0; y < height; ++y) {
+				if (pick(0, 9) < 7) {
+					puz.grid(x, y).trigger_id = 0;
+					floor.push_back(grid_pos_t{x, y});
+				} else {
+					holes.push_back(grid_pos_t{x, y});
+				}
+			}
+		}
+		for (int x = -1; x <= width; ++x) {
+			holes.push_back(grid_pos_t{x, -1});
+			holes.push_back(grid_pos_t{x, height});
+		}
+		for (int y = 0; y < height; ++y) {
+			holes.push_back(grid_pos_t{-1, y});
+			holes.push_back(grid_pos_t{width, y});
+		}
+		while (floor.size() < 2) {
+			grid_pos_t pos = take(holes);
+			puz.grid(pos.x, pos.y).trigger_id = 0;
+			floor.push_back(pos);
+		}
+
+		puz.start.pos = take(floor);
+		puz.start.dir = static_cast<grid_dir_t::value_t>(pick(0, 3));
+		puz.end = take(floor);
+
+		std::size_t num_traps = pick(0, options_.max_traps);
+		for (std::size_t n = 0; n < num_traps && floor.size() >= 2; ++n) {
+			grid_pos_t trigger = take(floor);
+			grid_pos_t trap = take(floor);
+			puz.grid(trigger.x, trigger.y).trigger_id = n + 1;
+			puz.grid(trap.x, trap.y).trigger_id = -int(n + 1);
+		}
+
+		std::size_t num_obstacles = pick(0, options_.max_obstacles);
+		for (std::size_t n = 0; n < num_obstacles && !floor.empty(); ++n) {
+			puz.obstacles.push_back(take(floor));
+		}
+
+		std::size_t num_alternatives = pick(0, options_.max_alternatives);
+		for (std::size_t n = 0; n < num_alternatives && holes.size() >= 2; ++n) {
+			grid_pos_t first = take(holes);
+			grid_pos_t second = take(holes);
+			puz.alternative_tiles.emplace_back(first, second);
+		}
+
+		puzzle parsed = parse_puzzles(format_puzzle(puz)).front();
+		parsed.distances.compute(parsed);
+		return parsed;
+	}
+
+	void
+	make_program(command_sequence & seq)
+	{
+		std::size_t budget = pick(1, options_.max_tiles);
+		add_commands(seq, 0, budget);
+	}
+
+	/* Random tiles for the puzzle to provide, at most
+	 * max_tiles of them, none of which is rep0. */
+	void
+	make_tiles(puzzle & puz)
+	{
+		puz.tiles.clear();
+		int count = pick(1, int(options_.max_tiles));
+		for (int n = 0; n < count; ++n) {
+			int kind = pick(int(command_tile::kind_t::left), int(command_tile::kind_t::rep5));
+			if (kind == int(command_tile::kind_t::rep0)) {
+				kind = int(command_tile::kind_t::rep1);
+			}
+			++puz.tiles[static_cast<command_tile::kind_t>(kind)];
+		}
+	}
+
+	/* Program that agrees with given one up to a random
+	 * point only, to update an exploration from. */
+	void
+	make_variant(const command_sequence & seq, command_sequence & variant)
+	{
+		variant = seq;
+		if (!variant.empty()) {
+			variant.erase(variant.begin() + pick(0, int(variant.size()) - 1));
+		}
+		std::size_t budget = pick(0, 2);
+		add_commands(variant, 1, budget);
+	}
+
+private:
+	int
+	pick(int min, int max)
+	{
+		return std::uniform_int_distribution<int>(min, max)(random_);
+	}
+
+	grid_pos_t
+	take(std::vector<grid_pos_t> & positions)
+	{
+		std::size_t n = pick(0, int(positions.size()) - 1);
+		grid_pos_t pos = positions[n];
+		positions[n] = positions.back();
+		positions.pop_back();
+		return pos;
+	}
+
+	void
+	add_commands(command_sequence & seq, int depth, std::size_t & budget)
+	{
+		int count = pick(1, 5);
+		for (int n = 0; n < count && budget > 0; ++n) {
+			--budget;
+			/* no branching commands below depth 3 */
+			int last = depth < 3 ? int(command_tile::kind_t::rep5) : int(command_tile::kind_t::fwd3);
+			int kind = pick(int(command_tile::kind_t::left), last);
+			if (kind == int(command_tile::kind_t::rep0)) {
+				kind = int(command_tile::kind_t::rep1);
+			}
+			std::unique_ptr<command_point> cpt = make_point(static_cast<command_tile::kind_t>(kind));
+			for (std::size_t b = 0; b < cpt->num_branches(); ++b) {
+				if (pick(0, 3)) {
+					add_commands(cpt->branch(b), depth + 1, budget);
+				}
+			}
+			seq.append(std::move(cpt));
+		}
+	}
+
+	std::mt19937_64 random_;
+	const fuzz_options & options_;
+};
+
+/* First difference found, and where. */
+struct divergence {
+	/* path that differs from the step by step run, empty
+	 * if none does */
+	std::string path;
+	std::string detail;
+
+	inline bool found() const noexcept { return !path.empty(); }
+};
+
+/* Outcome of the step by step run under one assignment. */
+struct reference_run {
+	simulation_result result;
+	/* steps after which a run with stop_hopeless ends, 0 if
+	 * the robot never stands where the goal is out of reach */
+	int hopeless_steps = 0;
+	std::size_t furthest_pc = 0;
+	/* if failed: cell the robot ended on or dropped onto,
+	 * and instruction of the last step */
+	grid_pos_t fail_pos = {0, 0};
+	std::size_t fail_pc = 0;
+
+	inline int
+	score() const noexcept
+	{
+		return result.succeeded() ? std::numeric_limits<int>::max() : result.steps;
+	}
+
+	inline int
+	hopeless_score() const noexcept
+	{
+		return hopeless_steps ? hopeless_steps : score();
+	}
+};
+
+std::string
+assignment_name(const std::vector<std::size_t> & alternatives)
+{
+	std::string name = "assignment ";
+	for (std::size_t option : alternatives) {
+		name += char('0' + option);
+	}
+	return alternatives.empty() ? "no alternatives" : name;
+}
+
+/* Count of assignments or steps, which are whole numbers
+ * kept as floating point (see failure_heatmap). */
+std::string
+count_name(double count)
+{
+	return std::to_string(static_cast<unsigned long long>(count));
+}
+
+std::string
+position_name(grid_pos_t pos)
+{
+	return '(' + std::to_string(pos.x) + ", " + std::to_string(pos.y) + ')';
+}
+
+/* Runs the program one step at a time, as run_trace does,
+ * and keeps robot and obstacles as a view following the
+ * steps would show them. Steps taken by every instruction
+ * are added to profile, indexed by program counter. */
+divergence
+run_step_by_step(
+	const puzzle & puz,
+	const command_program & program,
+	const std::vector<std::size_t> & alternatives,
+	run_step_state & state,
+	reference_run & run,
+	double * profile)
+{
+	divergence found;
+	auto diverge = [&](const std::string & detail)
+	{
+		found.path = "step by step";
+		found.detail = assignment_name(alternatives) + ", step " + std::to_string(run.result.steps) + ": " + detail;
+	};
+
+	state.initialize(puz, &program);
+	state.apply_alternatives(puz, alternatives);
+	run = reference_run();
+	run.result.steps = 1;
+
+	grid_coord_t robot = state.robot;
+	std::vector<grid_pos_t> obstacles = puz.obstacles;
+	std::vector<bool> dropped(obstacles.size(), false);
+
+	if (state.start_program()) {
+		for (;;) {
+			run_step_info info = state.current_step();
+			if (info.robot_origin.pos != robot.pos || info.robot_origin.dir != robot.dir) {
+				diverge("begins with robot at " + position_name(info.robot_origin.pos) +
+					", shown at " + position_name(robot.pos));
+				return found;
+			}
+			if (info.move_obstacle >= 0) {
+				if (std::size_t(info.move_obstacle) >= obstacles.size() || dropped[info.move_obstacle] ||
+					obstacles[info.move_obstacle] != info.obstacle_origin) {
+					diverge("moves obstacle " + std::to_string(info.move_obstacle) +
+						" from " + position_name(info.obstacle_origin) + ", where it is not shown");
+					return found;
+				}
+				if (info.obstacle_will_drop) {
+					dropped[info.move_obstacle] = true;
+				} else {
+					obstacles[info.move_obstacle] = info.obstacle_target;
+				}
+			}
+			robot = info.robot_target;
+
+			++run.result.steps;
+			run.fail_pc = state.pc();
+			++profile[run.fail_pc];
+			run_step_state::step_result_t result = state.complete_step();
+			if ((result == run_step_state::step_result_t::dropped) != info.will_drop) {
+				diverge(info.will_drop ? "robot was to drop, but did not" : "robot dropped unexpectedly");
+				return found;
+			}
+			if (result != run_step_state::step_result_t::dropped &&
+				(state.robot.pos != robot.pos || state.robot.dir != robot.dir)) {
+				diverge("robot ends at " + position_name(state.robot.pos) +
+					", shown at " + position_name(robot.pos));
+				return found;
+			}
+			for (std::size_t n = 0; n < obstacles.size(); ++n) {
+				if (!dropped[n] && state.tile(obstacles[n]).obstacle != int(n)) {
+					diverge("obstacle " + std::to_string(n) + " shown at " +
+						position_name(obstacles[n]) + ", but not there");
+					return found;
+				}
+			}
+
+			if (result == run_step_state::step_result_t::running) {
+				if (!run.hopeless_steps && puz.distances.hopeless(state)) {
+					run.hopeless_steps = run.result.steps;
+				}
+				continue;
+			}
+			run.result.outcome =
+				result == run_step_state::step_result_t::reached_goal ? simulation_result::outcome_t::reached_goal :
+				result == run_step_state::step_result_t::dropped ? simulation_result::outcome_t::dropped :
+				simulation_result::outcome_t::program_end;
+			run.fail_pos = result == run_step_state::step_result_t::dropped ? info.robot_target.pos : state.robot.pos;
+			break;
+		}
+		if (run.hopeless_steps && run.result.succeeded()) {
+			diverge("reaches the goal, but was hopeless after step " + std::to_string(run.hopeless_steps));
+			return found;
+		}
+	}
+
+	run.furthest_pc = state.furthest_pc();
+	if (!program.point(0)) {
+		run.fail_pos = state.robot.pos;
+	}
+	return found;
+}
+
+/* Independent reference for the rules: a port of the tree
+ * walking interpreter the run engine replaced. It follows
+ * the command tree by path, keeps repetitions left by tile
+ * and the board in a grid, and shares no code with the run
+ * engine, so that both can only agree by following the same
+ * rules. */
+class tree_interpreter {
+public:
+	simulation_result
+	run(const puzzle & puz, const command_sequence & seq, const std::vector<std::size_t> & alternatives)
+	{
+		initialize(puz, seq);
+
+		/* setting up alternatives counts as first step */
+		simulation_result result;
+		result.steps = 1;
+		for (std::size_t n = 0; n < puz.alternative_tiles.size(); ++n) {
+			std::size_t option = n >= alternatives.size() ? 0 : alternatives[n];
+			set_floor(puz.alternative_tiles[n].first, option == 0);
+			set_floor(puz.alternative_tiles[n].second, option == 1);
+		}
+		if (seq_->empty()) {
+			result.outcome = simulation_result::outcome_t::program_end;
+			return result;
+		}
+		current_path_ = command_sequence_path(0);
+		current_command_ = seq_->lookup(current_path_);
+		begin_step(0);
+
+		for (;;) {
+			++result.steps;
+			if (will_drop_) {
+				result.outcome = simulation_result::outcome_t::dropped;
+				return result;
+			}
+
+			robot_ = robot_target_;
+			if (move_obstacle_ != -1) {
+				if (!obstacle_will_drop_) {
+					set_obstacle(move_obstacle_, obstacle_target_);
+				} else {
+					clear_obstacle(move_obstacle_);
+				}
+			}
+			if (closes_trap_) {
+				grid_(closed_trap_.x, closed_trap_.y).has_floor = true;
+			}
+
+			if (robot_.pos == goal_) {
+				result.outcome = simulation_result::outcome_t::reached_goal;
+				return result;
+			}
+
+			int limit_sub_steps;
+			switch (current_command_->tile().kind()) {
+				case command_tile::kind_t::fwd2: {
+					limit_sub_steps = 2;
+					break;
+				}
+				case command_tile::kind_t::fwd3: {
+					limit_sub_steps = 3;
+					break;
+				}
+				default : {
+					limit_sub_steps = 1;
+				}
+			}
+			if (used_sub_steps_ + 1 < limit_sub_steps) {
+				begin_step(used_sub_steps_ + 1);
+				continue;
+			}
+
+			if (current_command_->tile().is_repeat()) {
+				branch_states_[&current_command_->tile()] = current_branch_state_ - 1;
+			}
+			advance_command();
+			if (!current_command_) {
+				result.outcome = simulation_result::outcome_t::program_end;
+				return result;
+			}
+			begin_step(0);
+		}
+	}
+
+private:
+	struct tile_t {
+		bool has_floor = false;
+		int obstacle = -1;
+	};
+
+	void
+	initialize(const puzzle & puz, const command_sequence & seq)
+	{
+		seq_ = &seq;
+		robot_.pos = puz.start.pos;
+		robot_.dir = puz.start.dir;
+		goal_ = puz.end;
+
+		grid_.clear();
+		obstacles_.clear();
+		branch_states_.clear();
+		trigger_floors_.clear();
+		puz.grid.iterate([this](int x, int y, floor_tile_t tile)
+		{
+			if (tile.trigger_id >= 0) {
+				grid_(x, y).has_floor = true;
+			}
+			if (tile.trigger_id > 0) {
+				trigger_floors_[tile.trigger_id].first = grid_pos_t{x, y};
+			}
+			if (tile.trigger_id < 0) {
+				trigger_floors_[-tile.trigger_id].second = grid_pos_t{x, y};
+			}
+		});
+		for (std::size_t index = 0; index < puz.obstacles.size(); ++index) {
+			set_obstacle(index, puz.obstacles[index]);
+		}
+	}
+
+	void
+	set_floor(grid_pos_t pos, bool present)
+	{
+		if (present) {
+			grid_(pos.x, pos.y).has_floor = true;
+		} else {
+			grid_.erase(pos.x, pos.y);
+		}
+	}
+
+	void
+	set_obstacle(int index, grid_pos_t pos)
+	{
+		auto i = obstacles_.find(index);
+		if (i != obstacles_.end()) {
+			grid_(i->second.x, i->second.y).obstacle = -1;
+		}
+		obstacles_[index] = pos;
+		grid_(pos.x, pos.y).obstacle = index;
+	}
+
+	void
+	clear_obstacle(int index)
+	{
+		auto i = obstacles_.find(index);
+		if (i != obstacles_.end()) {
+			grid_(i->second.x, i->second.y).obstacle = -1;
+			obstacles_.erase(i);
+		}
+	}
+
+	/* Repetitions nested in a repeat start over whenever it
+	 * repeats. */
+	void
+	replenish_repetitions(const command_sequence & seq)
+	{
+		for (const auto & cpt : seq) {
+			branch_states_.erase(&cpt->tile());
+			for (std::size_t n = 0; n < cpt->num_branches(); ++n) {
+				replenish_repetitions(cpt->branch(n));
+			}
+		}
+	}
+
+	void
+	begin_step(int used_sub_steps)
+	{
+		used_sub_steps_ = used_sub_steps;
+		grid_coord_t origin = robot_;
+		robot_target_ = compute_target_coord(origin);
+		const tile_t * tile = grid_.get(robot_target_.pos.x, robot_target_.pos.y);
+		will_drop_ = !(tile && tile->has_floor);
+		closes_trap_ = false;
+
+		move_obstacle_ = tile ? tile->obstacle : -1;
+		if (move_obstacle_ != -1) {
+			grid_vec_t v = origin.dir.vec();
+			obstacle_target_ = grid_pos_t{robot_target_.pos.x + v.dx, robot_target_.pos.y + v.dy};
+
+			const tile_t * o_tile = grid_.get(obstacle_target_.x, obstacle_target_.y);
+			obstacle_will_drop_ = !(o_tile && o_tile->has_floor);
+			if (!obstacle_will_drop_ && o_tile->obstacle != -1) {
+				robot_target_ = origin;
+				move_obstacle_ = -1;
+			}
+
+			for (const auto & trigger : trigger_floors_) {
+				if (trigger.second.first == obstacle_target_) {
+					closed_trap_ = trigger.second.second;
+					closes_trap_ = true;
+				}
+			}
+		}
+
+		if (current_command_->tile().is_repeat()) {
+			replenish_repetitions(current_command_->branch(0));
+			auto i = branch_states_.emplace(&current_command_->tile(), current_command_->tile().num_repetitions()).first;
+			current_branch_state_ = i->second;
+			i->second -= 1;
+		} else if (current_command_->tile().is_conditional()) {
+			current_branch_state_ = check_floor_ahead(robot_target_) ? 0 : 1;
+		}
+	}
+
+	grid_coord_t
+	compute_target_coord(grid_coord_t robot) const
+	{
+		switch (current_command_->tile().kind()) {
+			case command_tile::kind_t::left: {
+				robot.dir = robot.dir.left();
+				break;
+			}
+			case command_tile::kind_t::right: {
+				robot.dir = robot.dir.right();
+				break;
+			}
+			case command_tile::kind_t::fwd1:
+			case command_tile::kind_t::fwd2:
+			case command_tile::kind_t::fwd3: {
+				grid_vec_t v = robot.dir.vec();
+				robot.pos.x += v.dx;
+				robot.pos.y += v.dy;
+				break;
+			}
+			default: {
+				break;
+			}
+		}
+		return robot;
+	}
+
+	bool
+	check_floor_ahead(grid_coord_t robot) const
+	{
+		grid_vec_t v = robot.dir.vec();
+		const tile_t * tile = grid_.get(robot.pos.x + v.dx, robot.pos.y + v.dy);
+		return tile && tile->has_floor;
+	}
+
+	/* Moves on to the command after the current one: into
+	 * the branch taken, or up out of finished branches and
+	 * back to repeats with repetitions left. No command once
+	 * the program ends. */
+	void
+	advance_command()
+	{
+		if (current_command_->tile().is_conditional()) {
+			current_path_.down(current_branch_state_);
+		} else if (current_command_->tile().is_repeat()) {
+			current_branch_state_ = 0;
+			current_path_.down(0);
+		} else {
+			current_path_.advance();
+		}
+
+		current_command_ = seq_->lookup(current_path_);
+		while (!current_command_) {
+			if (current_path_.is_leaf()) {
+				break;
+			}
+			current_path_.up();
+			current_command_ = seq_->lookup(current_path_);
+			if (current_command_->tile().is_conditional()) {
+				current_path_.advance();
+				current_command_ = seq_->lookup(current_path_);
+			} else if (current_command_->tile().is_repeat()) {
+				if (branch_states_.find(&current_command_->tile())->second == 0) {
+					current_path_.advance();
+					current_command_ = seq_->lookup(current_path_);
+				} else {
+					break;
+				}
+			}
+		}
+	}
+
+	const command_sequence * seq_ = nullptr;
+	grid_tpl<tile_t> grid_;
+	grid_pos_t goal_;
+	grid_coord_t robot_;
+	std::unordered_map<int, grid_pos_t> obstacles_;
+	/* repetitions left, by repeat tile */
+	std::unordered_map<const command_tile *, int> branch_states_;
+	/* trigger and trap door, by trigger id */
+	std::map<int, std::pair<grid_pos_t, grid_pos_t>> trigger_floors_;
+
+	/* current step */
+	command_sequence_path current_path_;
+	const command_point * current_command_ = nullptr;
+	/* repetitions left including the current one, or the
+	 * branch a conditional takes */
+	std::size_t current_branch_state_ = 0;
+	/* steps of a multi-step forward taken before */
+	int used_sub_steps_ = 0;
+	grid_coord_t robot_target_;
+	bool will_drop_ = false;
+	int move_obstacle_ = -1;
+	grid_pos_t obstacle_target_;
+	bool obstacle_will_drop_ = false;
+	bool closes_trap_ = false;
+	grid_pos_t closed_trap_;
+};
+
+/* Compares all paths on one case. */
+class case_checker {
+public:
+	case_checker()
+		: state_(new run_step_state()), single_(1)
+	{
+	}
+
+	divergence
+	check(const puzzle & puz, const command_sequence & commands, const command_sequence & variant)
+	{
+		command_program program;
+		program.compile(commands);
+
+		std::size_t num_assignments = std::size_t(1) << puz.alternative_tiles.size();
+		runs_.resize(num_assignments);
+		assignments_.resize(num_assignments);
+		profile_.assign(program.size(), 0.);
+		divergence found;
+		for (std::size_t bits = 0; bits < num_assignments; ++bits) {
+			get_alternative_assignment(puz, bits, assignments_[bits]);
+			found = run_step_by_step(puz, program, assignments_[bits], *state_, runs_[bits], profile_.data());
+			if (found.found()) {
+				return found;
+			}
+			steps_ += runs_[bits].result.steps;
+		}
+
+		auto compare = [&](const char * path, std::size_t bits, const char * what, long long expected, long long got)
+		{
+			if (!found.found() && expected != got) {
+				found.path = path;
+				found.detail = assignment_name(assignments_[bits]) + ": " + what + " " +
+					std::to_string(got) + ", expected " + std::to_string(expected);
+			}
+			return found.found();
+		};
+
+		for (std::size_t bits = 0; bits < num_assignments; ++bits) {
+			const reference_run & run = runs_[bits];
+			simulation_result expected = tree_.run(puz, commands, assignments_[bits]);
+			if (compare("step by step", bits, "outcome against tree interpreter", int(expected.outcome), int(run.result.outcome)) ||
+				compare("step by step", bits, "steps against tree interpreter", expected.steps, run.result.steps)) {
+				return found;
+			}
+		}
+
+		for (std::size_t bits = 0; bits < num_assignments; ++bits) {
+			const reference_run & run = runs_[bits];
+			state_->initialize(puz, &program);
+			simulation_result result = run_simulation(puz, *state_, assignments_[bits]);
+			if (compare("run_simulation", bits, "outcome", int(run.result.outcome), int(result.outcome)) ||
+				compare("run_simulation", bits, "steps", run.result.steps, result.steps)) {
+				return found;
+			}
+			state_->initialize(puz, &program);
+			result = run_simulation(puz, *state_, assignments_[bits], true);
+			if (compare("run_simulation", bits, "steps with stop_hopeless",
+				run.hopeless_steps ? run.hopeless_steps : run.result.steps, result.steps)) {
+				return found;
+			}
+			if (compare("simulate_execution", bits, "score",
+				run.score(), simulate_execution(&puz, &commands, assignments_[bits])) ||
+				compare("simulate_execution", bits, "score with stop_hopeless",
+				run.hopeless_score(), simulate_execution(&puz, &commands, assignments_[bits], true))) {
+				return found;
+			}
+		}
+
+		std::vector<simulation_job> jobs(2 * num_assignments);
+		for (std::size_t bits = 0; bits < num_assignments; ++bits) {
+			for (std::size_t hopeless = 0; hopeless < 2; ++hopeless) {
+				simulation_job & job = jobs[2 * bits + hopeless];
+				job.puz = &puz;
+				job.program = &program;
+				job.alternatives = assignments_[bits];
+				job.stop_hopeless = hopeless;
+			}
+		}
+		batch_simulation_result batch = simulate_batch(jobs, &single_);
+		for (std::size_t bits = 0; bits < num_assignments; ++bits) {
+			const reference_run & run = runs_[bits];
+			const simulation_result & result = batch.results[2 * bits];
+			const simulation_result & hopeless = batch.results[2 * bits + 1];
+			if (compare("simulate_batch", bits, "outcome", int(run.result.outcome), int(result.outcome)) ||
+				compare("simulate_batch", bits, "steps", run.result.steps, result.steps) ||
+				compare("simulate_batch", bits, "steps with stop_hopeless",
+				run.hopeless_steps ? run.hopeless_steps : run.result.steps, hopeless.steps)) {
+				return found;
+			}
+		}
+
+		alternative_outcomes outcomes;
+		explore_alternatives(puz, program, outcomes);
+		for (std::size_t bits = 0; bits < num_assignments; ++bits) {
+			if (compare("explore_alternatives", bits, "score", runs_[bits].score(), outcomes.score(assignments_[bits]))) {
+				return found;
+			}
+		}
+
+		alternative_exploration hopeless;
+		hopeless.set_stop_hopeless(true);
+		hopeless.update(puz, commands);
+		for (std::size_t bits = 0; bits < num_assignments; ++bits) {
+			if (compare("alternative_exploration", bits, "score with stop_hopeless",
+				runs_[bits].hopeless_score(), hopeless.outcomes().score(assignments_[bits]))) {
+				return found;
+			}
+		}
+
+		/* explore the variant first, so that the program
+		 * itself is explored by resuming its runs. Runs only
+		 * place alternative tiles they observe, so their end
+		 * states can only be compared with an exploration
+		 * from scratch. */
+		alternative_exploration fresh;
+		fresh.update(puz, commands);
+		alternative_exploration resumed;
+		resumed.update(puz, variant);
+		resumed.update(puz, commands);
+		/* no runs are recorded for an empty program, so
+		 * there are no end states or failing instructions */
+		bool recorded = !commands.empty();
+		std::size_t failure_pc = std::numeric_limits<std::size_t>::max();
+		int worst_steps = 0;
+		for (std::size_t bits = 0; bits < num_assignments; ++bits) {
+			const reference_run & run = runs_[bits];
+			if (compare("resumed alternative_exploration", bits, "score",
+				run.score(), resumed.outcomes().score(assignments_[bits])) ||
+				compare("resumed alternative_exploration", bits, "end_steps",
+				run.result.steps, resumed.end_steps(assignments_[bits])) ||
+				(recorded && compare("resumed alternative_exploration", bits, "end_state",
+				fresh.end_state(assignments_[bits]), resumed.end_state(assignments_[bits])))) {
+				return found;
+			}
+			grid_pos_t fail_pos;
+			std::size_t fail_pc;
+			bool failed = resumed.failure_point(puz, assignments_[bits], fail_pos, fail_pc);
+			if (compare("resumed alternative_exploration", bits, "failed", !run.result.succeeded(), failed) ||
+				(failed && (
+				compare("resumed alternative_exploration", bits, "failure x", run.fail_pos.x, fail_pos.x) ||
+				compare("resumed alternative_exploration", bits, "failure y", run.fail_pos.y, fail_pos.y) ||
+				compare("resumed alternative_exploration", bits, "failure pc", run.fail_pc, fail_pc)))) {
+				return found;
+			}
+			if (recorded && !run.result.succeeded()) {
+				failure_pc = std::min(failure_pc, run.furthest_pc);
+			}
+			worst_steps = std::max(worst_steps, run.result.steps);
+		}
+		if (failure_pc != resumed.failure_pc()) {
+			found.path = "resumed alternative_exploration";
+			found.detail = "failure_pc " + std::to_string(resumed.failure_pc()) +
+				", expected " + std::to_string(failure_pc);
+		} else if (worst_steps != resumed.worst_steps()) {
+			found.path = "resumed alternative_exploration";
+			found.detail = "worst_steps " + std::to_string(resumed.worst_steps()) +
+				", expected " + std::to_string(worst_steps);
+		} else {
+			check_failures(puz, program, resumed, found);
+		}
+		if (found.found()) {
+			return found;
+		}
+
+		/* runs cut short halfway, as those of programs
+		 * looping forever are */
+		int max_steps = std::max(2, worst_steps / 2);
+		alternative_outcomes limited;
+		explore_alternatives(puz, program, limited, max_steps);
+		for (std::size_t bits = 0; bits < num_assignments; ++bits) {
+			const reference_run & run = runs_[bits];
+			simulation_result expected = run.result;
+			if (expected.steps > max_steps) {
+				expected.outcome = simulation_result::outcome_t::step_limit;
+				expected.steps = max_steps;
+			}
+			state_->initialize(puz, &program);
+			simulation_result result = run_simulation(puz, *state_, assignments_[bits], false, max_steps);
+			if (compare("run_simulation", bits, "outcome with max_steps", int(expected.outcome), int(result.outcome)) ||
+				compare("run_simulation", bits, "steps with max_steps", expected.steps, result.steps) ||
+				compare("explore_alternatives", bits, "score with max_steps",
+				expected.succeeded() ? std::numeric_limits<int>::max() : expected.steps,
+				limited.score(assignments_[bits]))) {
+				return found;
+			}
+		}
+
+		execution_profile profile;
+		profile_alternatives(puz, program, profile);
+		double total_steps = 0.;
+		for (std::size_t pc = 0; pc < program.size(); ++pc) {
+			if (profile.steps[pc] != profile_[pc]) {
+				found.path = "profile_alternatives";
+				found.detail = "instruction " + std::to_string(pc) + ": " + count_name(profile.steps[pc]) +
+					" steps, expected " + count_name(profile_[pc]);
+				return found;
+			}
+			total_steps += profile_[pc];
+		}
+		if (profile.total_steps != total_steps || profile.assignments != num_assignments) {
+			found.path = "profile_alternatives";
+			found.detail = count_name(profile.total_steps) + " steps of " +
+				count_name(profile.assignments) + " assignments, expected " +
+				count_name(total_steps) + " of " + std::to_string(num_assignments);
+		}
+		return found;
+	}
+
+	/* Steps taken by step by step runs so far. */
+	inline std::uint64_t steps() const noexcept { return steps_; }
+
+private:
+	/* Failure heatmap of exploration against failures of
+	 * the step by step runs. */
+	void
+	check_failures(
+		const puzzle & puz,
+		const command_program & program,
+		const alternative_exploration & exploration,
+		divergence & found) const
+	{
+		failure_heatmap heatmap;
+		exploration.collect_failures(puz, heatmap);
+
+		failure_heatmap expected;
+		expected.assignments = runs_.size();
+		std::vector<double> instructions(program.size(), 0.);
+		for (const auto & run : runs_) {
+			if (!run.result.succeeded()) {
+				++expected.failures;
+				++expected.cells(run.fail_pos.x, run.fail_pos.y);
+				++instructions[run.fail_pc];
+			}
+		}
+
+		auto diverge = [&found](const std::string & detail)
+		{
+			found.path = "collect_failures";
+			found.detail = detail;
+		};
+		if (heatmap.assignments != expected.assignments || heatmap.failures != expected.failures) {
+			diverge(count_name(heatmap.failures) + " of " + count_name(heatmap.assignments) +
+				" assignments failing, expected " + count_name(expected.failures) +
+				" of " + count_name(expected.assignments));
+			return;
+		}
+		expected.cells.iterate([&](int x, int y, double count)
+		{
+			const double * got = heatmap.cells.get(x, y);
+			if (!found.found() && (!got || *got != count)) {
+				diverge(count_name(got ? *got : 0.) + " failures at " + position_name(grid_pos_t{x, y}) +
+					", expected " + count_name(count));
+			}
+		});
+		double commands_total = 0.;
+		for (const auto & command : heatmap.commands) {
+			double count = 0.;
+			for (std::size_t pc = 0; pc < program.size(); ++pc) {
+				if (program.point(pc) == command.first) {
+					count += instructions[pc];
+				}
+			}
+			if (!found.found() && command.second != count) {
+				diverge(count_name(command.second) + " failures at " + tile_name(command.first->tile().kind()) +
+					" tile, expected " + count_name(count));
+			}
+			commands_total += command.second;
+		}
+		double expected_total = 0.;
+		for (std::size_t pc = 0; pc < program.size(); ++pc) {
+			expected_total += program.point(pc) ? instructions[pc] : 0.;
+		}
+		if (!found.found() && commands_total != expected_total) {
+			diverge(count_name(commands_total) + " failures at tiles, expected " + count_name(expected_total));
+		}
+	}
+
+	std::unique_ptr<run_step_state> state_;
+	tree_interpreter tree_;
+	/* simulate_batch runs on the checking thread only */
+	worker_pool single_;
+	std::vector<reference_run> runs_;
+	/* steps per instruction of all runs */
+	std::vector<double> profile_;
+	std::vector<std::vector<std::size_t>> assignments_;
+	std::uint64_t steps_ = 0;
+};
+
+/* Compares solve_puzzle with trying every program the
+ * tiles of the puzzle allow: the solutions with fewest
+ * tiles must be exactly those found with find_all, and the
+ * solution with fewest steps must take as many as the best
+ * program does. */
+class solver_checker {
+public:
+	solver_checker()
+		: state_(new run_step_state()), single_(1)
+	{
+	}
+
+	divergence
+	check(const puzzle & puz)
+	{
+		puz_ = &puz;
+		std::size_t num_assignments = std::size_t(1) << puz.alternative_tiles.size();
+		assignments_.resize(num_assignments);
+		for (std::size_t bits = 0; bits < num_assignments; ++bits) {
+			get_alternative_assignment(puz, bits, assignments_[bits]);
+		}
+
+		std::fill(std::begin(budget_), std::end(budget_), 0);
+		std::size_t total_tiles = 0;
+		for (const auto & tile : puz.tiles) {
+			budget_[static_cast<std::size_t>(tile.first)] = tile.second;
+			total_tiles += tile.second;
+		}
+		solving_.clear();
+		fewest_.clear();
+		fewest_tiles_ = 0;
+		fewest_steps_ = std::numeric_limits<int>::max();
+		for (tiles_ = 1; tiles_ <= total_tiles; ++tiles_) {
+			program_.clear();
+			frames_.assign(1, frame{&program_, nullptr, 0});
+			enumerate(tiles_);
+		}
+
+		divergence found;
+		auto diverge = [&found](const char * path, const std::string & detail)
+		{
+			found.path = path;
+			found.detail = detail;
+		};
+
+		solver_options options;
+		options.find_all = true;
+		options.pool = &single_;
+		solver_result result = solve_puzzle(puz, options);
+		std::vector<std::string> reported;
+		for (const auto & solution : result.solutions) {
+			reported.push_back(describe(solution));
+		}
+		std::sort(reported.begin(), reported.end());
+		std::sort(fewest_.begin(), fewest_.end());
+		std::vector<std::string> missing, extra;
+		std::set_difference(fewest_.begin(), fewest_.end(), reported.begin(), reported.end(), std::back_inserter(missing));
+		std::set_difference(reported.begin(), reported.end(), fewest_.begin(), fewest_.end(), std::back_inserter(extra));
+		if (!result.complete) {
+			diverge("solve_puzzle find_all", "search incomplete");
+		} else if (!missing.empty()) {
+			diverge("solve_puzzle find_all", "misses " + missing.front() + ", " +
+				std::to_string(missing.size()) + " of " + std::to_string(fewest_.size()) + " solutions missing");
+		} else if (!extra.empty()) {
+			diverge("solve_puzzle find_all", "reports " + extra.front() + ", not a solution with fewest tiles");
+		} else if (std::adjacent_find(reported.begin(), reported.end()) != reported.end()) {
+			diverge("solve_puzzle find_all", "reports " + *std::adjacent_find(reported.begin(), reported.end()) + " twice");
+		}
+		if (found.found()) {
+			return found;
+		}
+
+		options.find_all = false;
+		options.fewest_steps = true;
+		result = solve_puzzle(puz, options);
+		if (!result.complete) {
+			diverge("solve_puzzle fewest_steps", "search incomplete");
+		} else if (result.solutions.empty() != solving_.empty()) {
+			diverge("solve_puzzle fewest_steps", result.solutions.empty() ?
+				"finds no solution, expected " + std::to_string(fewest_steps_ - 1) + " steps" :
+				"reports " + describe(result.solutions.front()) + ", but no program solves");
+		} else if (!result.solutions.empty()) {
+			std::string name = describe(result.solutions.front());
+			auto solution = solving_.find(name);
+			if (solution == solving_.end()) {
+				diverge("solve_puzzle fewest_steps", "reports " + name + ", not a solution");
+			} else if (solution->second != fewest_steps_ || result.steps + 1 != fewest_steps_) {
+				diverge("solve_puzzle fewest_steps", "reports " + name + " taking " +
+					std::to_string(result.steps) + " steps (" + std::to_string(solution->second - 1) +
+					" simulated), expected " + std::to_string(fewest_steps_ - 1));
+			}
+		}
+		return found;
+	}
+
+	/* Steps taken by runs of all programs so far. */
+	inline std::uint64_t steps() const noexcept { return steps_; }
+
+private:
+	/* Open sequence, and the tile owning it unless it is
+	 * the program. */
+	struct frame {
+		command_sequence * seq;
+		command_point * owner;
+		std::size_t branch;
+	};
+
+	/* Every program of tiles_left more tiles. Closes after
+	 * the last tile are left implicit, so each program is
+	 * built once. */
+	void
+	enumerate(std::size_t tiles_left)
+	{
+		if (!tiles_left) {
+			evaluate();
+			return;
+		}
+
+		for (std::size_t kind = command_tile::min_kind; kind <= command_tile::max_kind; ++kind) {
+			if (!budget_[kind]) {
+				continue;
+			}
+			--budget_[kind];
+			std::size_t depth = frames_.size();
+			command_sequence & seq = *frames_.back().seq;
+			seq.append(make_point(static_cast<command_tile::kind_t>(kind)));
+			command_point & cpt = *seq[seq.size() - 1];
+			if (cpt.num_branches()) {
+				frames_.push_back(frame{&cpt.branch(0), &cpt, 0});
+			}
+			enumerate(tiles_left - 1);
+			frames_.resize(depth);
+			seq.erase(seq.begin() + (seq.size() - 1));
+			++budget_[kind];
+		}
+
+		if (frames_.size() > 1) {
+			frame closed = frames_.back();
+			frames_.pop_back();
+			bool next_branch = closed.branch + 1 < closed.owner->num_branches();
+			if (next_branch) {
+				frames_.push_back(frame{&closed.owner->branch(closed.branch + 1), closed.owner, closed.branch + 1});
+			}
+			enumerate(tiles_left);
+			if (next_branch) {
+				frames_.pop_back();
+			}
+			frames_.push_back(closed);
+		}
+	}
+
+	void
+	evaluate()
+	{
+		compiled_.compile(program_);
+		int worst_steps = 0;
+		for (const auto & alternatives : assignments_) {
+			state_->initialize(*puz_, &compiled_);
+			simulation_result result = run_simulation(*puz_, *state_, alternatives);
+			steps_ += result.steps;
+			if (!result.succeeded()) {
+				return;
+			}
+			worst_steps = std::max(worst_steps, result.steps);
+		}
+
+		std::string name = describe(program_);
+		solving_[name] = worst_steps;
+		if (!fewest_tiles_) {
+			fewest_tiles_ = tiles_;
+		}
+		if (tiles_ == fewest_tiles_) {
+			fewest_.push_back(name);
+		}
+		fewest_steps_ = std::min(fewest_steps_, worst_steps);
+	}
+
+	std::unique_ptr<run_step_state> state_;
+	/* solve_puzzle runs on the checking thread only */
+	worker_pool single_;
+	const puzzle * puz_ = nullptr;
+	std::vector<std::vector<std::size_t>> assignments_;
+
+	std::size_t budget_[command_tile::max_kind + 1] = {};
+	command_sequence program_;
+	command_program compiled_;
+	std::vector<frame> frames_;
+	/* tiles of the programs enumerated */
+	std::size_t tiles_ = 0;
+
+	/* all solutions, with steps taken in the worst case
+	 * (counting the setup step) */
+	std::map<std::string, int> solving_;
+	std::vector<std::string> fewest_;
+	std::size_t fewest_tiles_ = 0;
+	int fewest_steps_ = 0;
+	std::uint64_t steps_ = 0;
+};
+
+/* Programs with one change that makes them simpler:
+ * a tile removed, replaced by its branch, or turned into
+ * one of fewer repetitions or steps. */
+void
+simpler_programs(const command_sequence & seq, std::vector<command_sequence> & result)
+{
+	for (std::size_t n = 0; n < seq.size(); ++n) {
+		const command_point & cpt = *seq[n];
+
+		result.push_back(seq);
+		result.back().erase(result.back().begin() + n);
+
+		for (std::size_t b = 0; b < cpt.num_branches(); ++b) {
+			result.push_back(seq);
+			command_sequence & unwrapped = result.back();
+			unwrapped.erase(unwrapped.begin() + n);
+			for (std::size_t k = 0; k < cpt.branch(b).size(); ++k) {
+				unwrapped.insert(n + k, std::unique_ptr<command_point>(new command_point(*cpt.branch(b)[k])));
+			}
+		}
+
+		command_tile::kind_t kind = cpt.tile().kind();
+		if (kind == command_tile::kind_t::fwd2 || kind == command_tile::kind_t::fwd3 ||
+			kind > command_tile::kind_t::rep1) {
+			std::unique_ptr<command_point> lower = make_point(static_cast<command_tile::kind_t>(int(kind) - 1));
+			for (std::size_t b = 0; b < lower->num_branches(); ++b) {
+				lower->branch(b) = cpt.branch(b);
+			}
+			result.push_back(seq);
+			result.back()[n] = std::move(lower);
+		}
+
+		for (std::size_t b = 0; b < cpt.num_branches(); ++b) {
+			std::vector<command_sequence> branches;
+			simpler_programs(cpt.branch(b), branches);
+			for (auto & branch : branches) {
+				result.push_back(seq);
+				result.back()[n]->branch(b) = std::move(branch);
+			}
+		}
+	}
+}
+
+/* Puzzles with one thing less: an alternative pair, an
+ * obstacle, a trap door with its trigger, or a field of
+ * plain floor. */
+void
+simpler_puzzles(const puzzle & puz, std::vector<puzzle> & result)
+{
+	for (std::size_t n = 0; n < puz.alternative_tiles.size(); ++n) {
+		result.push_back(puz);
+		result.back().alternative_tiles.erase(result.back().alternative_tiles.begin() + n);
+	}
+	for (std::size_t n = 0; n < puz.obstacles.size(); ++n) {
+		result.push_back(puz);
+		result.back().obstacles.erase(result.back().obstacles.begin() + n);
+	}
+	puz.grid.iterate([&](int x, int y, floor_tile_t tile)
+	{
+		grid_pos_t pos{x, y};
+		if (tile.trigger_id > 0) {
+			result.push_back(puz);
+			puzzle & fewer = result.back();
+			fewer.grid.iterate([&](int tx, int ty, floor_tile_t other)
+			{
+				if (other.trigger_id == tile.trigger_id || other.trigger_id == -tile.trigger_id) {
+					fewer.grid(tx, ty).trigger_id = 0;
+				}
+			});
+		} else if (tile.trigger_id == 0 && pos != puz.start.pos && pos != puz.end) {
+			for (const auto & obstacle : puz.obstacles) {
+				if (obstacle == pos) {
+					return;
+				}
+			}
+			result.push_back(puz);
+			result.back().grid.erase(x, y);
+		}
+	});
+	for (auto & fewer : result) {
+		fewer.distances.compute(fewer);
+	}
+}
+
+/* Simplifies puzzle and program for as long as the same
+ * path keeps diverging. */
+void
+minimize(puzzle & puz, command_sequence & commands, divergence & found)
+{
+	case_checker checker;
+	for (bool simplified = true; simplified; ) {
+		simplified = false;
+
+		std::vector<command_sequence> programs;
+		simpler_programs(commands, programs);
+		for (auto & program : programs) {
+			divergence other = checker.check(puz, program, program);
+			if (other.path == found.path) {
+				commands = std::move(program);
+				found = other;
+				simplified = true;
+				break;
+			}
+		}
+		if (simplified) {
+			continue;
+		}
+
+		std::vector<puzzle> puzzles;
+		simpler_puzzles(puz, puzzles);
+		for (auto & fewer : puzzles) {
+			divergence other = checker.check(fewer, commands, commands);
+			if (other.path == found.path) {
+				puz = std::move(fewer);
+				found = other;
+				simplified = true;
+				break;
+			}
+		}
+	}
+}
+
+/* As above, for the solver: simplifies the puzzle and
+ * takes away tiles it provides. */
+void
+minimize_solver(puzzle & puz, divergence & found)
+{
+	solver_checker checker;
+	for (bool simplified = true; simplified; ) {
+		simplified = false;
+
+		std::vector<puzzle> puzzles;
+		for (const auto & tile : puz.tiles) {
+			if (tile.second) {
+				puzzles.push_back(puz);
+				--puzzles.back().tiles[tile.first];
+			}
+		}
+		simpler_puzzles(puz, puzzles);
+		for (auto & fewer : puzzles) {
+			divergence other = checker.check(fewer);
+			if (other.path == found.path) {
+				puz = std::move(fewer);
+				found = other;
+				simplified = true;
+				break;
+			}
+		}
+	}
+}
+
+void
+usage(const char * argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [-S] [-n count] [-s seed] [-j threads] [-t seconds] [-c case]\n"
+		"          [-w size] [-o obstacles] [-r traps] [-l alternatives] [-M max_tiles]\n"
+		"  -S               check the solver against trying all programs instead\n"
+		"  -n count         cases to check, 0 for no limit (default: 100000)\n"
+		"  -s seed          seed of the first case (default: 1)\n"
+		"  -j threads       number of threads (default: all cores)\n"
+		"  -t seconds       stop after this long, 0 for no limit (default: 0)\n"
+		"  -c case          check only this case\n"
+		"  -w size          largest width and height of the floor\n"
+		"  -o obstacles     most obstacles\n"
+		"  -r traps         most trap doors, each with trigger\n"
+		"  -l alternatives  most alternative pairs (up to 6)\n"
+		"  -M max_tiles     most tiles of a program, or provided by a puzzle\n"
+		"                   with -S (default: 10, 5 with -S)\n",
+		argv0);
+}
+
+}
+
+int main(int argc, char ** argv)
+{
+	fuzz_options options;
+	std::uint64_t count = 100000;
+	std::uint64_t seed = 1;
+	std::size_t num_threads = 0;
+	double time_limit = 0.;
+	std::uint64_t first_case = 0;
+	bool check_solver = false;
+	bool max_tiles_given = false;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "Sn:s:j:t:c:w:o:r:l:M:")) != -1) {
+		switch (opt) {
+			case 'S': {
+				check_solver = true;
+				break;
+			}
+			case 'n': {
+				count = strtoull(optarg, nullptr, 10);
+				break;
+			}
+			case 's': {
+				seed = strtoull(optarg, nullptr, 10);
+				break;
+			}
+			case 'j': {
+				num_threads = strtoul(optarg, nullptr, 10);
+				break;
+			}
+			case 't': {
+				time_limit = strtod(optarg, nullptr);
+				break;
+			}
+			case 'c': {
+				first_case = strtoull(optarg, nullptr, 10);
+				count = 1;
+				break;
+			}
+			case 'w': {
+				options.max_size = atoi(optarg);
+				break;
+			}
+			case 'o': {
+				options.max_obstacles = strtoul(optarg, nullptr, 10);
+				break;
+			}
+			case 'r': {
+				options.max_traps = strtoul(optarg, nullptr, 10);
+				break;
+			}
+			case 'l': {
+				options.max_alternatives = strtoul(optarg, nullptr, 10);
+				break;
+			}
+			case 'M': {
+				options.max_tiles = strtoul(optarg, nullptr, 10);
+				max_tiles_given = true;
+				break;
+			}
+			default: {
+				usage(argv[0]);
+				return 2;
+			}
+		}
+	}
+	/* limits of the run engine, and of symbols for traps
+	 * and alternatives in the text format */
+	if (optind != argc || options.max_size < 2 || options.max_size > 16 ||
+		options.max_obstacles > run_step_state::max_obstacles || options.max_traps > 26 ||
+		options.max_alternatives > 6 || options.max_tiles < 1 || options.max_tiles > command_program::max_loops) {
+		usage(argv[0]);
+		return 2;
+	}
+	/* all programs of the tiles are tried */
+	if (check_solver && !max_tiles_given) {
+		options.max_tiles = 5;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	auto seconds_since = [](std::chrono::steady_clock::time_point since)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+	};
+
+	/* Cases are handed out in order; once one diverges no
+	 * more are, and those still being checked come before
+	 * the last handed out. So the lowest numbered diverging
+	 * case is found, whatever the number of threads. */
+	std::atomic<std::uint64_t> next_case{first_case};
+	std::atomic<std::uint64_t> num_checked{0};
+	std::atomic<std::uint64_t> num_steps{0};
+	std::atomic<bool> stop{false};
+	std::mutex report_mutex;
+	std::uint64_t diverging_case = std::numeric_limits<std::uint64_t>::max();
+	auto last_report = start;
+
+	worker_pool pool(num_threads);
+	pool.run([&](std::size_t)
+	{
+		case_checker checker;
+		solver_checker solver;
+		std::uint64_t reported_steps = 0;
+		while (!stop.load()) {
+			std::uint64_t n = next_case.fetch_add(1);
+			if (count && n - first_case >= count) {
+				break;
+			}
+
+			case_generator generator(case_seed(seed, n), options);
+			puzzle puz = generator.make_puzzle();
+			divergence found;
+			if (check_solver) {
+				generator.make_tiles(puz);
+				found = solver.check(puz);
+			} else {
+				command_sequence commands, variant;
+				generator.make_program(commands);
+				generator.make_variant(commands, variant);
+				found = checker.check(puz, commands, variant);
+			}
+			++num_checked;
+			num_steps += checker.steps() + solver.steps() - reported_steps;
+			reported_steps = checker.steps() + solver.steps();
+
+			std::unique_lock<std::mutex> guard(report_mutex);
+			if (found.found()) {
+				diverging_case = std::min(diverging_case, n);
+				stop = true;
+			}
+			if (time_limit > 0. && seconds_since(start) >= time_limit) {
+				stop = true;
+			}
+			if (seconds_since(last_report) >= 10.) {
+				last_report = std::chrono::steady_clock::now();
+				double seconds = seconds_since(start);
+				fprintf(stderr, "%llu cases, %.0f cases/s, %.0f steps/s\n",
+					static_cast<unsigned long long>(num_checked.load()),
+					num_checked.load() / seconds, num_steps.load() / seconds);
+			}
+		}
+	});
+
+	double seconds = seconds_since(start);
+	fprintf(stderr, "%llu cases, %llu steps, %.3f seconds, %.0f cases/s\n",
+		static_cast<unsigned long long>(num_checked.load()),
+		static_cast<unsigned long long>(num_steps.load()),
+		seconds, seconds > 0. ? num_checked.load() / seconds : 0.);
+
+	if (diverging_case == std::numeric_limits<std::uint64_t>::max()) {
+		return 0;
+	}
+
+	case_generator generator(case_seed(seed, diverging_case), options);
+	puzzle puz = generator.make_puzzle();
+	if (check_solver) {
+		generator.make_tiles(puz);
+		divergence found = solver_checker().check(puz);
+		fprintf(stderr, "case %llu diverges, minimizing\n", static_cast<unsigned long long>(diverging_case));
+		minimize_solver(puz, found);
+		printf("case %llu: %s differs, %s\n",
+			static_cast<unsigned long long>(diverging_case), found.path.c_str(), found.detail.c_str());
+		fputs(format_puzzle(puz).c_str(), stdout);
+		return 1;
+	}
+
+	command_sequence commands, variant;
+	generator.make_program(commands);
+	generator.make_variant(commands, variant);
+	divergence found = case_checker().check(puz, commands, variant);
+	fprintf(stderr, "case %llu diverges, minimizing\n", static_cast<unsigned long long>(diverging_case));
+
+	/* simpler cases are checked without a variant; a
+	 * divergence that needs one to show is printed as is */
+	bool with_variant = case_checker().check(puz, commands, commands).path != found.path;
+	if (!with_variant) {
+		minimize(puz, commands, found);
+	}
+
+	puz.tiles.clear();
+	count_tiles(commands, puz.tiles);
+	printf("case %llu: %s differs, %s\n",
+		static_cast<unsigned long long>(diverging_case), found.path.c_str(), found.detail.c_str());
+	printf("program: %s\n", describe(commands).c_str());
+	if (with_variant) {
+		printf("explored after: %s\n", describe(variant).c_str());
+	}
+	fputs(format_puzzle(puz).c_str(), stdout);
+
+	return 1;
+}
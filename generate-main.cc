@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "puzzle.h"
+#include "puzzle_generator.h"
+#include "run_engine.h"
+#include "worker_pool.h"
+
+/* Generates puzzles and prints those that pass the checks
+ * of accept_candidate, in the text format of the built-in
+ * puzzles (see puzzle.cc), so they can be pasted into
+ * puzzle_data or read by parse_puzzles. Candidates are
+ * checked in parallel, one per worker; which are printed
+ * only depends on the seed, not on the number of threads
+ * (unless searches run out of time). Progress goes to
+ * stderr. */
+
+namespace {
+
+/* splitmix64, so that neighbouring candidate numbers give
+ * unrelated seeds */
+std::uint64_t
+candidate_seed(std::uint64_t seed, std::uint64_t candidate)
+{
+	std::uint64_t x = seed + (candidate + 1) * 0x9e3779b97f4a7c15ull;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+void
+usage(const char * argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [-n count] [-s seed] [-j threads] [-a attempts] [-w size]\n"
+		"          [-o obstacles] [-r traps] [-l alternatives] [-p spare]\n"
+		"          [-m min_tiles] [-M max_tiles] [-k solutions] [-t seconds]\n"
+		"  -n count         puzzles to print (default: 10)\n"
+		"  -s seed          seed of the first candidate (default: 1)\n"
+		"  -j threads       number of threads (default: all cores)\n"
+		"  -a attempts      give up after this many candidates (default: 100000)\n"
+		"  -w size          largest width and height of the floor\n"
+		"  -o obstacles     most loose obstacles\n"
+		"  -r traps         most trap doors, each with trigger and obstacle\n"
+		"  -l alternatives  most alternative pairs\n"
+		"  -p spare         most tiles beyond those of the traced program\n"
+		"  -m min_tiles     fewest tiles a solution may take\n"
+		"  -M max_tiles     most tiles a solution may take\n"
+		"  -k solutions     most solutions with fewest tiles\n"
+		"  -t seconds       time the search may take per candidate\n",
+		argv0);
+}
+
+}
+
+int main(int argc, char ** argv)
+{
+	generator_options options;
+	std::size_t count = 10;
+	std::uint64_t seed = 1;
+	std::size_t num_threads = 0;
+	std::uint64_t max_attempts = 100000;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "n:s:j:a:w:o:r:l:p:m:M:k:t:")) != -1) {
+		switch (opt) {
+			case 'n': {
+				count = strtoul(optarg, nullptr, 10);
+				break;
+			}
+			case 's': {
+				seed = strtoull(optarg, nullptr, 10);
+				break;
+			}
+			case 'j': {
+				num_threads = strtoul(optarg, nullptr, 10);
+				break;
+			}
+			case 'a': {
+				max_attempts = strtoull(optarg, nullptr, 10);
+				break;
+			}
+			case 'w': {
+				options.max_size = atoi(optarg);
+				break;
+			}
+			case 'o': {
+				options.max_obstacles = strtoul(optarg, nullptr, 10);
+				break;
+			}
+			case 'r': {
+				options.max_traps = strtoul(optarg, nullptr, 10);
+				break;
+			}
+			case 'l': {
+				options.max_alternatives = strtoul(optarg, nullptr, 10);
+				break;
+			}
+			case 'p': {
+				options.max_spare_tiles = strtoul(optarg, nullptr, 10);
+				break;
+			}
+			case 'm': {
+				options.min_tiles = strtoul(optarg, nullptr, 10);
+				break;
+			}
+			case 'M': {
+				options.max_tiles = strtoul(optarg, nullptr, 10);
+				break;
+			}
+			case 'k': {
+				options.max_solutions = strtoul(optarg, nullptr, 10);
+				break;
+			}
+			case 't': {
+				options.time_limit = strtod(optarg, nullptr);
+				break;
+			}
+			default: {
+				usage(argv[0]);
+				return 2;
+			}
+		}
+	}
+	/* the run engine's board holds 32 fields across, and
+	 * there is an obstacle for every trap */
+	if (optind != argc || options.max_size < 2 || options.max_size > 16
+		|| options.max_obstacles + options.max_traps > run_step_state::max_obstacles
+		|| options.max_tiles + options.max_spare_tiles > command_program::max_loops
+		|| options.min_tiles < 1 || options.min_tiles > options.max_tiles) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	/* Candidates are handed out in order, and once enough
+	 * are accepted no more are; those still being checked
+	 * all come before the last handed out. So the lowest
+	 * numbered count accepted ones are the same for any
+	 * number of threads. */
+	std::atomic<std::uint64_t> next_candidate{0};
+	std::atomic<std::size_t> num_accepted{0};
+	std::mutex accepted_mutex;
+	std::vector<std::pair<std::uint64_t, std::string>> accepted;
+
+	worker_pool pool(num_threads);
+	pool.run([&](std::size_t)
+	{
+		for (;;) {
+			if (num_accepted.load() >= count) {
+				break;
+			}
+			std::uint64_t candidate = next_candidate.fetch_add(1);
+			if (candidate >= max_attempts) {
+				break;
+			}
+
+			puzzle generated;
+			if (!generate_candidate(candidate_seed(seed, candidate), options, generated)) {
+				continue;
+			}
+			/* check the puzzle as read back from its text,
+			 * which is what gets shipped */
+			puzzle puz = parse_puzzles(format_puzzle(generated)).front();
+			if (!accept_candidate(puz, options)) {
+				continue;
+			}
+
+			std::string text = format_puzzle(puz);
+			std::unique_lock<std::mutex> guard(accepted_mutex);
+			accepted.emplace_back(candidate, std::move(text));
+			++num_accepted;
+			fprintf(stderr, "candidate %llu accepted, %zu tiles, %zu steps\n",
+				static_cast<unsigned long long>(candidate), puz.par_tiles, puz.par_steps);
+		}
+	});
+
+	std::sort(accepted.begin(), accepted.end());
+	if (accepted.size() > count) {
+		accepted.resize(count);
+	}
+	for (const auto & entry : accepted) {
+		fputs(entry.second.c_str(), stdout);
+	}
+	fprintf(stderr, "%zu of %llu candidates accepted\n",
+		accepted.size(), static_cast<unsigned long long>(std::min(next_candidate.load(), max_attempts)));
+
+	return accepted.size() < count ? 1 : 0;
+}
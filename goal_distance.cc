@@ -0,0 +1,293 @@
+#include "goal_distance.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+
+#include "puzzle.h"
+#include "run_engine.h"
+
+constexpr int goal_distance::unreachable;
+
+namespace {
+
+/* most states searched by search_boards */
+constexpr std::size_t max_boards = 1 << 14;
+
+}
+
+void
+goal_distance::compute(const puzzle & puz)
+{
+	grid_pos_t min = puz.end, max = puz.end;
+	auto extend = [&min, &max](grid_pos_t pos)
+	{
+		min.x = std::min(min.x, pos.x);
+		min.y = std::min(min.y, pos.y);
+		max.x = std::max(max.x, pos.x);
+		max.y = std::max(max.y, pos.y);
+	};
+	extend(puz.start.pos);
+	puz.grid.iterate([&extend](int x, int y, floor_tile_t) { extend(grid_pos_t{x, y}); });
+	for (const auto & alternative : puz.alternative_tiles) {
+		extend(alternative.first);
+		extend(alternative.second);
+	}
+	origin_ = min;
+	width_ = max.x - min.x + 1;
+	height_ = max.y - min.y + 1;
+
+	/* trap doors count as floor if some trigger can close
+	 * them */
+	std::set<int> triggers;
+	if (!puz.obstacles.empty()) {
+		puz.grid.iterate([&triggers](int, int, floor_tile_t tile)
+		{
+			if (tile.trigger_id > 0) {
+				triggers.insert(tile.trigger_id);
+			}
+		});
+	}
+
+	std::vector<bool> floor(width_ * height_, false);
+	puz.grid.iterate([this, &floor, &triggers](int x, int y, floor_tile_t tile)
+	{
+		if (tile.trigger_id >= 0 || triggers.count(-tile.trigger_id)) {
+			floor[cell_index(x, y)] = true;
+		}
+	});
+	for (const auto & alternative : puz.alternative_tiles) {
+		floor[cell_index(alternative.first.x, alternative.first.y)] = true;
+		floor[cell_index(alternative.second.x, alternative.second.y)] = true;
+	}
+
+	steps_.assign(width_ * height_ * 4, unreachable);
+	traps_.clear();
+	int goal = cell_index(puz.end.x, puz.end.y);
+	if (!floor[goal]) {
+		return;
+	}
+
+	/* search backwards: a state is reached from the states
+	 * turning into it, and from the cell behind it */
+	std::deque<grid_coord_t> queue;
+	for (grid_dir_t dir : {grid_dir_t::north, grid_dir_t::west, grid_dir_t::south, grid_dir_t::east}) {
+		steps_[goal * 4 + dir.value()] = 0;
+		queue.push_back(grid_coord_t{puz.end, dir});
+	}
+	while (!queue.empty()) {
+		grid_coord_t coord = queue.front();
+		queue.pop_front();
+		int next = steps_[cell_index(coord.pos.x, coord.pos.y) * 4 + coord.dir.value()] + 1;
+
+		grid_vec_t v = coord.dir.vec();
+		grid_coord_t predecessors[3] = {
+			{coord.pos, coord.dir.left()},
+			{coord.pos, coord.dir.right()},
+			{grid_pos_t{coord.pos.x - v.dx, coord.pos.y - v.dy}, coord.dir}
+		};
+		for (const grid_coord_t & pred : predecessors) {
+			int index = cell_index(pred.pos.x, pred.pos.y);
+			if (index < 0 || !floor[index]) {
+				continue;
+			}
+			int & steps = steps_[index * 4 + pred.dir.value()];
+			if (steps == unreachable) {
+				steps = next;
+				queue.push_back(pred);
+			}
+		}
+	}
+
+	auto is_floor = [this, &floor](int x, int y)
+	{
+		int index = cell_index(x, y);
+		return index >= 0 && floor[index];
+	};
+	const grid_vec_t vecs[4] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+	std::map<int, std::vector<grid_pos_t>> trigger_cells;
+	puz.grid.iterate([&trigger_cells](int x, int y, floor_tile_t tile)
+	{
+		if (tile.trigger_id > 0) {
+			trigger_cells[tile.trigger_id].push_back(grid_pos_t{x, y});
+		}
+	});
+	puz.grid.iterate([&](int x, int y, floor_tile_t tile)
+	{
+		if (tile.trigger_id >= 0 || !triggers.count(-tile.trigger_id)) {
+			return;
+		}
+		traps_.push_back(trap_door());
+		trap_door & trap = traps_.back();
+		trap.pos = grid_pos_t{x, y};
+
+		/* cells connected to the goal with the trap door
+		 * left out; the robot can turn anywhere */
+		trap.bypass.assign(width_ * height_, false);
+		std::deque<grid_pos_t> cells;
+		if (puz.end != trap.pos) {
+			trap.bypass[goal] = true;
+			cells.push_back(puz.end);
+		}
+		while (!cells.empty()) {
+			grid_pos_t pos = cells.front();
+			cells.pop_front();
+			for (const grid_vec_t & v : vecs) {
+				grid_pos_t next{pos.x + v.dx, pos.y + v.dy};
+				if (next != trap.pos && is_floor(next.x, next.y) && !trap.bypass[cell_index(next.x, next.y)]) {
+					trap.bypass[cell_index(next.x, next.y)] = true;
+					cells.push_back(next);
+				}
+			}
+		}
+
+		/* backwards from the triggers: an obstacle gets to
+		 * a cell by a push from the cell before it, with the
+		 * robot standing behind that */
+		std::vector<bool> closer(width_ * height_, false);
+		for (const grid_pos_t & pos : trigger_cells[-tile.trigger_id]) {
+			if (is_floor(pos.x, pos.y)) {
+				closer[cell_index(pos.x, pos.y)] = true;
+				cells.push_back(pos);
+			}
+		}
+		while (!cells.empty()) {
+			grid_pos_t pos = cells.front();
+			cells.pop_front();
+			trap.closers.push_back(pos);
+			for (const grid_vec_t & v : vecs) {
+				grid_pos_t from{pos.x - v.dx, pos.y - v.dy};
+				if (is_floor(from.x, from.y) && is_floor(from.x - v.dx, from.y - v.dy)
+					&& !closer[cell_index(from.x, from.y)]) {
+					closer[cell_index(from.x, from.y)] = true;
+					cells.push_back(from);
+				}
+			}
+		}
+	});
+
+	board_steps_.clear();
+	if (puz.alternative_tiles.empty() && puz.start.pos != puz.end) {
+		search_boards(puz);
+	}
+}
+
+void
+goal_distance::search_boards(const puzzle & puz)
+{
+	/* a program for every step the robot can take */
+	const command_tile::kind_t kinds[3] = {
+		command_tile::kind_t::left, command_tile::kind_t::right, command_tile::kind_t::fwd1
+	};
+	command_program actions[3];
+	for (std::size_t k = 0; k < 3; ++k) {
+		command_sequence seq;
+		seq.append(std::unique_ptr<command_point>(new command_point(
+			std::unique_ptr<command_tile>(new command_tile(kinds[k], 0.)))));
+		actions[k].compile(seq);
+	}
+
+	/* forwards from the start, numbering states in the
+	 * order they are found and noting which states step to
+	 * every one of them, and which onto the goal */
+	std::unordered_map<std::uint64_t, std::size_t> numbers;
+	std::vector<std::vector<std::size_t>> predecessors(1);
+	std::vector<std::size_t> finishing;
+	std::deque<run_step_state> queue(1);
+	queue.front().initialize(puz, &actions[0]);
+	numbers.emplace(queue.front().board_hash(), 0);
+	for (std::size_t current = 0; !queue.empty(); ++current) {
+		for (const command_program & action : actions) {
+			run_step_state next = queue.front();
+			next.program = &action;
+			next.start_program();
+			run_step_state::step_result_t result = next.finish_step();
+			if (result == run_step_state::step_result_t::reached_goal) {
+				finishing.push_back(current);
+				continue;
+			}
+			if (result == run_step_state::step_result_t::dropped) {
+				continue;
+			}
+			auto inserted = numbers.emplace(next.board_hash(), predecessors.size());
+			if (inserted.second) {
+				if (predecessors.size() == max_boards) {
+					return;
+				}
+				predecessors.emplace_back();
+				queue.push_back(next);
+			}
+			predecessors[inserted.first->second].push_back(current);
+		}
+		queue.pop_front();
+	}
+
+	/* then backwards from the goal */
+	std::vector<int> steps(predecessors.size(), unreachable);
+	std::deque<std::size_t> states;
+	for (std::size_t number : finishing) {
+		if (steps[number] == unreachable) {
+			steps[number] = 1;
+			states.push_back(number);
+		}
+	}
+	while (!states.empty()) {
+		std::size_t number = states.front();
+		states.pop_front();
+		for (std::size_t pred : predecessors[number]) {
+			if (steps[pred] == unreachable) {
+				steps[pred] = steps[number] + 1;
+				states.push_back(pred);
+			}
+		}
+	}
+
+	for (const auto & entry : numbers) {
+		board_steps_.emplace(entry.first, steps[entry.second]);
+	}
+}
+
+int
+goal_distance::steps(const grid_coord_t & robot) const noexcept
+{
+	if (steps_.empty()) {
+		return 0;
+	}
+	int index = cell_index(robot.pos.x, robot.pos.y);
+	return index < 0 ? unreachable : steps_[index * 4 + robot.dir.value()];
+}
+
+int
+goal_distance::steps(const run_step_state & state) const noexcept
+{
+	auto found = board_steps_.find(state.board_hash());
+	return found != board_steps_.end() ? found->second : steps(state.robot);
+}
+
+bool
+goal_distance::hopeless(const run_step_state & state) const noexcept
+{
+	auto found = board_steps_.find(state.board_hash());
+	if (found != board_steps_.end()) {
+		return found->second == unreachable;
+	}
+	if (steps(state.robot) == unreachable) {
+		return true;
+	}
+
+	int robot = cell_index(state.robot.pos.x, state.robot.pos.y);
+	for (const auto & trap : traps_) {
+		if (trap.bypass[robot] || state.tile(trap.pos).has_floor) {
+			continue;
+		}
+		bool closable = std::any_of(trap.closers.begin(), trap.closers.end(),
+			[&state](const grid_pos_t & pos) { return state.tile(pos).obstacle != -1; });
+		if (!closable) {
+			return true;
+		}
+	}
+	return false;
+}
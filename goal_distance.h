@@ -0,0 +1,115 @@
+#ifndef GOAL_DISTANCE_H
+#define GOAL_DISTANCE_H
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include "grid.h"
+
+struct puzzle;
+struct run_step_state;
+
+/* Fewest steps the robot needs to reach the goal of a
+ * puzzle, for every position and direction. Found by
+ * breadth first search backwards from the goal, where
+ * every turn and every field moved forward is a step. All
+ * cells that can have floor at some point count as floor:
+ * both tiles of every alternative pair, and trap doors
+ * that some trigger closes (if there is an obstacle to
+ * push onto it). Obstacles are left out; pushing them
+ * takes the same steps, and being blocked by them more.
+ *
+ * Distances are thus a lower bound on the steps of any
+ * run, under any alternative assignment. A robot standing
+ * where the goal is unreachable will never get there,
+ * whatever the program does next.
+ *
+ * Neither will it where it has to cross a trap door that
+ * is still open, once no obstacle is left that could be
+ * pushed onto a trigger closing it. Obstacles are pushed
+ * from the cell behind them, so only cells that can have
+ * floor both ahead of and behind an obstacle lead closer
+ * to a trigger; other obstacles are left out.
+ *
+ * Puzzles without alternatives have only a single run for
+ * every program, and if the states of robot, floor and
+ * obstacles it can get into are few enough, all of them
+ * are searched as well, taking every step the robot can.
+ * Steps from those states are then exact: a run takes at
+ * least as many, and is hopeless if the goal is out of
+ * reach. */
+class goal_distance {
+public:
+	static constexpr int unreachable = std::numeric_limits<int>::max();
+
+	/* Compute distances for puzzle; until then there are
+	 * none, see steps. */
+	void
+	compute(const puzzle & puz);
+
+	inline bool empty() const noexcept { return steps_.empty(); }
+
+	/* Steps from given robot position and direction to the
+	 * goal, unreachable if there is no way there. 0 (which
+	 * is a valid lower bound) if not computed. */
+	int
+	steps(const grid_coord_t & robot) const noexcept;
+
+	/* Steps from robot and board of given run state to the
+	 * goal; exact where its states have been searched (see
+	 * above), else as for the robot alone. */
+	int
+	steps(const run_step_state & state) const noexcept;
+
+	/* Whether goal can be reached from position, in any
+	 * direction, as turns are always possible. */
+	inline bool
+	reachable(const grid_pos_t & pos) const noexcept
+	{
+		return steps(grid_coord_t{pos, grid_dir_t::north}) != unreachable;
+	}
+
+	/* Whether a run in given state can no longer reach the
+	 * goal, whatever the program does next: see above. */
+	bool
+	hopeless(const run_step_state & state) const noexcept;
+
+private:
+	/* Trap door that some trigger closes. */
+	struct trap_door {
+		grid_pos_t pos;
+		/* per cell: whether the goal can be reached from
+		 * there without crossing the trap door */
+		std::vector<bool> bypass;
+		/* cells from which an obstacle can be pushed onto a
+		 * trigger closing it */
+		std::vector<grid_pos_t> closers;
+	};
+
+	/* Search states of runs, see above; leaves
+	 * board_steps_ empty if there are too many. */
+	void
+	search_boards(const puzzle & puz);
+
+	/* index of cell at position, -1 outside the bounds */
+	inline int
+	cell_index(int x, int y) const noexcept
+	{
+		unsigned int dx = x - origin_.x;
+		unsigned int dy = y - origin_.y;
+		return dx < width_ && dy < height_ ? int(dy * width_ + dx) : -1;
+	}
+
+	/* bounds covering every cell that can have floor */
+	grid_pos_t origin_ = {0, 0};
+	unsigned int width_ = 0, height_ = 0;
+	/* four entries per cell, by direction */
+	std::vector<int> steps_;
+	std::vector<trap_door> traps_;
+	/* steps from state by its board_hash, see search_boards */
+	std::unordered_map<std::uint64_t, int> board_steps_;
+};
+
+#endif
@@ -54,13 +54,18 @@ public:
 
 	inline bool operator!=(const grid_dir_t & other) const noexcept
 	{
-		return value_ == other.value_;
+		return value_ != other.value_;
 	}
 	inline bool operator!=(value_t value) const noexcept
 	{
 		return value_ != value;
 	}
 
+	inline value_t value() const noexcept
+	{
+		return value_;
+	}
+
 	inline grid_dir_t left() const noexcept
 	{
 		return grid_dir_t(static_cast<value_t>((static_cast<uint8_t>(value_) + 1) & 3));
@@ -0,0 +1,201 @@
+#include "hint_engine.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "program_solver.h"
+
+constexpr double hint_engine::time_budget;
+
+namespace {
+
+bool
+embed(const command_sequence & part, const command_sequence & seq, std::vector<std::size_t> * matches);
+
+/* Whether b has the kind of a, and each branch of b the
+ * tiles of the same branch of a. */
+bool
+fits(const command_point & a, const command_point & b)
+{
+	if (a.tile().kind() != b.tile().kind()) {
+		return false;
+	}
+	for (std::size_t n = 0; n < a.num_branches(); ++n) {
+		if (!embed(a.branch(n), b.branch(n), nullptr)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Whether seq contains the tiles of part in the same order,
+ * each tile of part matched to one that fits it. Tiles are
+ * matched to the earliest one that fits, which leaves the
+ * most room for those after it; matches receives the index
+ * within seq for every tile of part. */
+bool
+embed(const command_sequence & part, const command_sequence & seq, std::vector<std::size_t> * matches)
+{
+	std::size_t m = 0;
+	for (std::size_t n = 0; n < part.size(); ++n, ++m) {
+		while (m < seq.size() && !fits(*part[n], *seq[m])) {
+			++m;
+		}
+		if (m == seq.size()) {
+			return false;
+		}
+		if (matches) {
+			matches->push_back(m);
+		}
+	}
+	return true;
+}
+
+/* First tile of completed in program order that is not one
+ * of the tiles of program, which completed must contain;
+ * returns false if there is none. */
+bool
+first_insertion(
+	const command_sequence & program,
+	const command_sequence & completed,
+	hint_engine::result_t & result)
+{
+	std::vector<std::size_t> matches;
+	embed(program, completed, &matches);
+
+	std::size_t n = 0;
+	for (std::size_t m = 0; m < completed.size(); ++m) {
+		if (n == matches.size() || matches[n] != m) {
+			result.kind = completed[m]->tile().kind();
+			result.position.push_back(n);
+			return true;
+		}
+		for (std::size_t k = 0; k < program[n]->num_branches(); ++k) {
+			result.position.push_back(n);
+			result.position.push_back(k);
+			if (first_insertion(program[n]->branch(k), completed[m]->branch(k), result)) {
+				return true;
+			}
+			result.position.resize(result.position.size() - 2);
+		}
+		++n;
+	}
+	return false;
+}
+
+/* Tiles of each kind used by seq are taken from tiles. */
+void
+take_tiles(const command_sequence & seq, std::map<command_tile::kind_t, std::size_t> & tiles)
+{
+	for (const auto & cpt : seq) {
+		std::size_t & count = tiles[cpt->tile().kind()];
+		count -= std::min<std::size_t>(count, 1);
+		for (std::size_t n = 0; n < cpt->num_branches(); ++n) {
+			take_tiles(cpt->branch(n), tiles);
+		}
+	}
+}
+
+}
+
+command_sequence_path
+hint_engine::result_t::path() const
+{
+	command_sequence_path result(position.empty() ? 0 : position.back());
+	for (std::size_t n = position.size(); n >= 3; n -= 2) {
+		result = command_sequence_path(position[n - 3], std::unique_ptr<command_branch_path>(
+			new command_branch_path(position[n - 2], std::move(result))));
+	}
+	return result;
+}
+
+hint_engine::~hint_engine()
+{
+}
+
+hint_engine::hint_engine()
+	: pool_(std::max(2u, std::thread::hardware_concurrency()) - 1)
+{
+	job_.start([this](){ thread_function(); });
+}
+
+void
+hint_engine::set_puzzle(const puzzle & puz)
+{
+	std::unique_lock<std::mutex> guard(job_.mutex());
+	puzzle_.reset(new puzzle(puz));
+	commands_.clear();
+	job_.drop();
+	result_ = result_t();
+}
+
+void
+hint_engine::request(const command_sequence & commands)
+{
+	command_sequence copy(commands);
+
+	std::unique_lock<std::mutex> guard(job_.mutex());
+	commands_ = std::move(copy);
+	result_ = result_t();
+	result_.status = status_t::pending;
+	job_.post();
+}
+
+void
+hint_engine::cancel()
+{
+	std::unique_lock<std::mutex> guard(job_.mutex());
+	job_.drop();
+	result_ = result_t();
+}
+
+hint_engine::result_t
+hint_engine::result() const
+{
+	std::unique_lock<std::mutex> guard(job_.mutex());
+	return result_;
+}
+
+void
+hint_engine::thread_function()
+{
+	puzzle puz;
+
+	for (;;) {
+		command_sequence commands;
+		std::uint64_t generation;
+		{
+			std::unique_lock<std::mutex> guard(job_.mutex());
+			if (!job_.wait(guard, generation)) {
+				return;
+			}
+			if (puzzle_) {
+				puz = std::move(*puzzle_);
+				puzzle_.reset();
+			}
+			commands = std::move(commands_);
+		}
+
+		puzzle left = puz;
+		take_tiles(commands, left.tiles);
+
+		solver_options options;
+		options.base = &commands;
+		options.cancel = job_.cancelled();
+		options.time_limit = time_budget;
+		options.pool = &pool_;
+		solver_result found = solve_puzzle(left, options);
+
+		result_t result;
+		result.status = status_t::none;
+		if (!found.solutions.empty() && first_insertion(commands, found.solutions.front(), result)) {
+			result.status = status_t::found;
+			result.num_insertions = found.solutions.front().num_tiles() - commands.num_tiles();
+		}
+
+		std::unique_lock<std::mutex> guard(job_.mutex());
+		if (job_.current(generation)) {
+			result_ = std::move(result);
+		}
+	}
+}
@@ -0,0 +1,98 @@
+#ifndef HINT_ENGINE_H
+#define HINT_ENGINE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "background_job.h"
+#include "puzzle.h"
+#include "tiles.h"
+#include "worker_pool.h"
+
+/* Suggests how to go on with the program being edited:
+ * searches, on a dedicated thread, for the fewest tiles
+ * that inserted anywhere into the program make it reach
+ * the goal under all alternatives, taken from the tiles
+ * not placed yet (see solver_options::base), and reports
+ * the first of them. Only the latest request matters: it
+ * cancels any search in progress. Searches give up after
+ * time_budget seconds, and run on one worker less than
+ * there are cores, leaving one for drawing. */
+class hint_engine {
+public:
+	enum class status_t {
+		/* nothing requested */
+		idle = 0,
+		/* search for latest request in progress */
+		pending = 1,
+		/* a tile to insert was found */
+		found = 2,
+		/* program cannot be completed with the tiles left,
+		 * not within time_budget, or needs no more tiles */
+		none = 3
+	};
+
+	struct result_t {
+		status_t status = status_t::idle;
+		/* tile to insert */
+		command_tile::kind_t kind = command_tile::kind_t::fwd1;
+		/* where to insert it: index within the program to
+		 * insert before, or of the tile to insert into,
+		 * followed by branch and index within it and so on */
+		std::vector<std::size_t> position;
+		/* tiles the completion found inserts in total */
+		std::size_t num_insertions = 0;
+
+		/* position as path for command_sequence::insert */
+		command_sequence_path
+		path() const;
+	};
+
+	/* seconds a search may take at most */
+	static constexpr double time_budget = 2.;
+
+	~hint_engine();
+
+	hint_engine();
+
+	hint_engine(const hint_engine & other) = delete;
+	hint_engine & operator=(const hint_engine & other) = delete;
+
+	/* Complete programs for given puzzle in subsequent
+	 * requests. */
+	void
+	set_puzzle(const puzzle & puz);
+
+	/* Request hint for given program; all tiles of the
+	 * puzzle it does not use are left to insert. The program
+	 * is copied on the calling thread, everything else
+	 * happens in the background. */
+	void
+	request(const command_sequence & commands);
+
+	/* Drop any request in progress. */
+	void
+	cancel();
+
+	/* Result for latest request; never waits for search
+	 * to complete. */
+	result_t
+	result() const;
+
+private:
+	void
+	thread_function();
+
+	worker_pool pool_;
+
+	/* data shared between caller / search thread, guarded
+	 * by the mutex of job_ */
+	std::unique_ptr<puzzle> puzzle_;
+	command_sequence commands_;
+	result_t result_;
+
+	background_job job_;
+};
+
+#endif
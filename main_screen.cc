@@ -2,6 +2,8 @@
 
 #include <math.h>
 
+#include <sstream>
+
 #include "clock.h"
 #include "texgen.h"
 #include "background.h"
@@ -15,6 +17,32 @@ std::unique_ptr<command_tile> new_tile(command_tile::kind_t kind, double phase)
 	return std::unique_ptr<command_tile>(new command_tile(kind, phase));
 }
 
+/* Seconds the result of a won level is shown before the
+ * next level starts. */
+static constexpr double result_duration = 3.;
+
+void draw_scratch_quad(const char * s, double x, double y, double size)
+{
+	texture_generator::make_scratch_text(s);
+	texture_generator::make_tex_quad2d(
+		texid_scratch,
+		x, y,
+		x + size, y,
+		x + size, y + size,
+		x, y + size);
+}
+
+/* Count, or "?" if unknown (zero). */
+std::string count_text(std::size_t count)
+{
+	if (!count) {
+		return "?";
+	}
+	std::ostringstream os;
+	os << count;
+	return os.str();
+}
+
 }
 
 main_screen::main_screen(application * app, std::shared_ptr<background_renderer> bg)
@@ -40,7 +68,7 @@ main_screen::resize(std::size_t width, std::size_t height)
 	repo_.configure(x1, 0, width, y1, tile_display_args_);
 	cq_.configure(0, y1, width, height, tile_display_args_);
 	back_icon_.configure(x2, 0, x1, y2);
-	run_controller_.set_bounds(10, 10, 210, 42);
+	run_controller_.set_bounds(10, 10, 314, 54);
 	if (dragging_) {
 		dragging_->set_display_args(tile_display_args_);
 	}
@@ -86,6 +114,10 @@ main_screen::redraw()
 	}
 
 	back_icon_.redraw();
+
+	if (showing_result_) {
+		draw_level_result();
+	}
 }
 
 void
@@ -96,6 +128,11 @@ main_screen::handle_button_press(
 {
 	update_current_time();
 
+	if (showing_result_) {
+		finish_level();
+		return;
+	}
+
 	if (back_icon_.handle_button_press(button, x, y, button_state)) {
 		return;
 	}
@@ -131,6 +168,8 @@ main_screen::handle_button_release(
 		return;
 	}
 
+	run_controller_.handle_button_release();
+
 	if (dragging_) {
 		command_tile_owner * owners[] = {&cq_, &repo_};
 		for (command_tile_owner * o : owners) {
@@ -151,6 +190,9 @@ main_screen::handle_key_press(
 	const char * chars)
 {
 	if (key_code == XK_Escape) {
+		if (showing_result_) {
+			finish_level();
+		}
 		exit_main_screen_handler_();
 	}
 }
@@ -160,6 +202,7 @@ void main_screen::handle_pointer_motion(
 	int button_state)
 {
 	back_icon_.handle_pointer_motion(x, y, button_state);
+	run_controller_.handle_pointer_motion(x, y, get_current_time());
 
 	if (dragging_) {
 		dragging_->move(x, y);
@@ -197,15 +240,89 @@ main_screen::timer_tick()
 	run_controller_.animate(now);
 	bg_->animate(now);
 
+	if (showing_result_ && now >= result_end_) {
+		finish_level();
+	}
+
 	request_redraw();
 }
 
 void
 main_screen::handle_level_win()
 {
+	update_current_time();
+
+	result_tiles_ = cq_.commands().num_tiles();
+	result_steps_ = run_controller_.worst_steps();
+	result_end_ = get_current_time() + result_duration;
+	showing_result_ = true;
+
+	request_redraw();
+}
+
+void
+main_screen::finish_level()
+{
+	showing_result_ = false;
 	complete_level_handler_();
 }
 
+/* Panel in the middle of the screen comparing tiles and
+ * steps of the winning program with par, in rows of tile
+ * resp. run icon, own count and par; counts at or below
+ * par are green. */
+void
+main_screen::draw_level_result() const
+{
+	double size = width() / 16.;
+	double x0 = (width() - 3 * size) / 2;
+	double y0 = (height() - 3 * size) / 2;
+
+	glColor4f(0., 0., 0., .75);
+	texture_generator::make_tex_quad2d(
+		texid_solid,
+		x0 - size / 4, y0 - size / 4,
+		x0 + 3 * size + size / 4, y0 - size / 4,
+		x0 + 3 * size + size / 4, y0 + 3 * size + size / 4,
+		x0 - size / 4, y0 + 3 * size + size / 4);
+
+	glColor4f(.5, .5, .5, 1.);
+	draw_scratch_quad("you", x0 + size, y0, size);
+	draw_scratch_quad("par", x0 + 2 * size, y0, size);
+
+	struct {
+		int texid;
+		std::size_t count;
+		std::size_t par;
+	} rows[] = {
+		{texid_fwd1, result_tiles_, puzzle_.par_tiles},
+		{texid_button_run1x, result_steps_, puzzle_.par_steps}
+	};
+
+	double y = y0 + size;
+	for (const auto & row : rows) {
+		glColor4f(1., 1., 1., 1.);
+		texture_generator::make_tex_quad2d(
+			row.texid,
+			x0, y,
+			x0 + size, y,
+			x0 + size, y + size,
+			x0, y + size);
+
+		if (!row.par || row.count <= row.par) {
+			glColor4f(.2, 1., .2, 1.);
+		} else {
+			glColor4f(1., 1., .2, 1.);
+		}
+		draw_scratch_quad(count_text(row.count).c_str(), x0 + size, y, size);
+
+		glColor4f(1., 1., 1., 1.);
+		draw_scratch_quad(count_text(row.par).c_str(), x0 + 2 * size, y, size);
+
+		y += size;
+	}
+}
+
 void
 main_screen::start_level(const puzzle & puz)
 {
@@ -213,6 +330,7 @@ main_screen::start_level(const puzzle & puz)
 	cq_.reset();
 
 	puzzle_ = puz;
+	showing_result_ = false;
 
 	double phase = 0.0;
 	for (const auto & tile_kind_count : puzzle_.tiles) {
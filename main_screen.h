@@ -70,6 +70,12 @@ public:
 		std::function<void()> complete_level_handler);
 
 private:
+	void
+	finish_level();
+
+	void
+	draw_level_result() const;
+
 	std::shared_ptr<background_renderer> bg_;
 
 	puzzle puzzle_;
@@ -89,6 +95,13 @@ private:
 	std::function<void()> complete_level_handler_;
 
 	icon back_icon_;
+
+	/* tiles and worst case steps of the program that won
+	 * the level, shown next to par until result_end_ */
+	bool showing_result_ = false;
+	double result_end_ = 0.;
+	std::size_t result_tiles_ = 0;
+	std::size_t result_steps_ = 0;
 };
 
 #endif
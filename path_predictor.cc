@@ -0,0 +1,110 @@
+#include "path_predictor.h"
+
+#include "alternative_explorer.h"
+#include "run_engine.h"
+#include "run_trace.h"
+
+constexpr std::size_t path_predictor::max_path_length;
+
+path_predictor::~path_predictor()
+{
+}
+
+path_predictor::path_predictor()
+{
+	job_.start([this](){ thread_function(); });
+}
+
+void
+path_predictor::set_puzzle(const puzzle & puz)
+{
+	std::unique_lock<std::mutex> guard(job_.mutex());
+	puzzle_.reset(new puzzle(puz));
+	job_.drop();
+}
+
+std::uint64_t
+path_predictor::predict(command_program program)
+{
+	std::unique_lock<std::mutex> guard(job_.mutex());
+	program_ = std::move(program);
+	return job_.post();
+}
+
+void
+path_predictor::cancel()
+{
+	std::unique_lock<std::mutex> guard(job_.mutex());
+	job_.drop();
+}
+
+bool
+path_predictor::poll(result_t & result) const
+{
+	std::unique_lock<std::mutex> guard(job_.mutex());
+	if (!job_.current(result_.generation) || result_.generation == result.generation) {
+		return false;
+	}
+	result = result_;
+	return true;
+}
+
+void
+path_predictor::thread_function()
+{
+	/* runs of programs looping forever end where their
+	 * animation does */
+	alternative_exploration exploration;
+	exploration.set_max_steps(run_trace::max_steps);
+	puzzle puz;
+	std::vector<std::size_t> alternatives;
+	run_step_state state;
+
+	for (;;) {
+		command_program program;
+		std::uint64_t generation;
+		{
+			std::unique_lock<std::mutex> guard(job_.mutex());
+			if (!job_.wait(guard, generation)) {
+				return;
+			}
+			if (puzzle_) {
+				puz = std::move(*puzzle_);
+				puzzle_.reset();
+				exploration.reset();
+			}
+			program = std::move(program_);
+		}
+
+		if (!exploration.update(puz, std::move(program), job_.cancelled())) {
+			continue;
+		}
+
+		alternatives.assign(puz.alternative_tiles.size(), 0);
+		exploration.outcomes().lowest_assignment(alternatives);
+
+		result_t result;
+		result.generation = generation;
+		state.initialize(puz, &exploration.program());
+		state.apply_alternatives(puz, alternatives);
+		result.path.push_back(state.robot.pos);
+		if (state.start_program()) {
+			for (std::size_t nsteps = 0; nsteps < max_path_length; ++nsteps) {
+				const grid_pos_t & target = state.current_step().robot_target.pos;
+				if (target != result.path.back()) {
+					result.path.push_back(target);
+				}
+				run_step_state::step_result_t step_result = state.complete_step();
+				if (step_result != run_step_state::step_result_t::running) {
+					result.reaches_goal = step_result == run_step_state::step_result_t::reached_goal;
+					break;
+				}
+			}
+		}
+
+		std::unique_lock<std::mutex> guard(job_.mutex());
+		if (job_.current(generation)) {
+			result_ = std::move(result);
+		}
+	}
+}
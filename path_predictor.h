@@ -0,0 +1,74 @@
+#ifndef PATH_PREDICTOR_H
+#define PATH_PREDICTOR_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "background_job.h"
+#include "command_program.h"
+#include "grid.h"
+#include "puzzle.h"
+
+/* Predicts the path of the robot for hypothetical programs
+ * (e.g. while a tile is hovering over the command queue)
+ * on a dedicated thread. The path shown is the one under
+ * the earliest failing floor alternative, as that is what
+ * a run would animate. Only the latest request matters:
+ * it cancels any prediction in progress, and results of
+ * earlier requests are never reported. */
+class path_predictor {
+public:
+	struct result_t {
+		/* request the result belongs to, 0 for none */
+		std::uint64_t generation = 0;
+		/* cells entered by robot, beginning with start */
+		std::vector<grid_pos_t> path;
+		bool reaches_goal = false;
+	};
+
+	~path_predictor();
+
+	path_predictor();
+
+	path_predictor(const path_predictor & other) = delete;
+	path_predictor & operator=(const path_predictor & other) = delete;
+
+	/* Predict subsequent requests on given puzzle. */
+	void
+	set_puzzle(const puzzle & puz);
+
+	/* Request prediction for given program, returns the
+	 * generation its result will carry. */
+	std::uint64_t
+	predict(command_program program);
+
+	/* Drop any request in progress. */
+	void
+	cancel();
+
+	/* Copies result of latest request into result, if it is
+	 * available and newer than what result holds already.
+	 * Returns whether it did. Never waits for prediction to
+	 * complete. */
+	bool
+	poll(result_t & result) const;
+
+private:
+	/* steps recorded at most, as (failing) programs may run
+	 * for long */
+	static constexpr std::size_t max_path_length = 256;
+
+	void
+	thread_function();
+
+	/* data shared between caller / prediction thread,
+	 * guarded by the mutex of job_ */
+	std::unique_ptr<puzzle> puzzle_;
+	command_program program_;
+	result_t result_;
+
+	background_job job_;
+};
+
+#endif
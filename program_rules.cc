@@ -0,0 +1,347 @@
+#include "program_rules.h"
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+
+namespace {
+
+using kind_t = command_tile::kind_t;
+
+bool
+is_turn(kind_t kind)
+{
+	return kind == kind_t::left || kind == kind_t::right;
+}
+
+bool
+is_forward(kind_t kind)
+{
+	return kind >= kind_t::fwd1 && kind <= kind_t::fwd3;
+}
+
+/* fields moved by forward tile */
+int
+forward_distance(kind_t kind)
+{
+	return static_cast<int>(kind) - static_cast<int>(kind_t::fwd1) + 1;
+}
+
+kind_t
+forward_kind(int distance)
+{
+	return static_cast<kind_t>(static_cast<int>(kind_t::fwd1) + distance - 1);
+}
+
+/* quarter turns to the left, modulo 4 */
+int
+rotation(kind_t kind)
+{
+	return kind == kind_t::left ? 1 : 3;
+}
+
+std::unique_ptr<command_point>
+new_point(kind_t kind)
+{
+	return std::unique_ptr<command_point>(new command_point(
+		std::unique_ptr<command_tile>(new command_tile(kind, 0.))));
+}
+
+/* What a tile does if it only turns or only moves
+ * forward; a counted repeat of such tiles (or repeats) all
+ * doing the same counts as one of them. */
+enum class effect_t {
+	other,
+	turn,
+	forward
+};
+
+/* Effect of cpt, and its amount: quarter turns to the left
+ * (modulo 4) or fields moved. Adds the tiles it consists
+ * of to counts, indexed by kind, unless other. */
+effect_t
+element_effect(const command_point & cpt, int & amount, std::size_t * counts)
+{
+	const command_tile & tile = cpt.tile();
+	kind_t kind = tile.kind();
+	if (is_turn(kind) || is_forward(kind)) {
+		amount = is_turn(kind) ? rotation(kind) : forward_distance(kind);
+		++counts[static_cast<std::size_t>(kind)];
+		return is_turn(kind) ? effect_t::turn : effect_t::forward;
+	}
+	if (!tile.is_repeat() || kind == kind_t::rep0 || cpt.branch(0).empty()) {
+		return effect_t::other;
+	}
+
+	effect_t effect = effect_t::other;
+	std::size_t inner_counts[command_tile::max_kind + 1] = {};
+	int total = 0;
+	for (const auto & inner : cpt.branch(0)) {
+		int inner_amount;
+		effect_t inner_effect = element_effect(*inner, inner_amount, inner_counts);
+		if (inner_effect == effect_t::other || (effect != effect_t::other && inner_effect != effect)) {
+			return effect_t::other;
+		}
+		effect = inner_effect;
+		total += inner_amount;
+	}
+	amount = total * tile.num_repetitions();
+	if (effect == effect_t::turn) {
+		amount %= 4;
+	}
+	for (std::size_t n = 0; n <= command_tile::max_kind; ++n) {
+		counts[n] += inner_counts[n];
+	}
+	++counts[static_cast<std::size_t>(kind)];
+	return effect;
+}
+
+/* Tiles of each kind that turn by given quarters, or move
+ * given fields: left, left left or right; as many fwd3 as
+ * fit and the remainder. Quarters 2 may be right right as
+ * well. Returns number of tiles. */
+std::size_t
+replacement(effect_t effect, int amount, std::size_t * needed)
+{
+	if (effect == effect_t::turn) {
+		if (amount == 3) {
+			needed[static_cast<std::size_t>(kind_t::right)] = 1;
+			return 1;
+		}
+		needed[static_cast<std::size_t>(kind_t::left)] = amount;
+		return amount;
+	}
+	needed[static_cast<std::size_t>(kind_t::fwd3)] = amount / 3;
+	if (amount % 3) {
+		++needed[static_cast<std::size_t>(forward_kind(amount % 3))];
+	}
+	return (amount + 2) / 3;
+}
+
+/* Whether needed tiles can be had from those of counts,
+ * or from budget without running short: more than
+ * tiles_after of a kind are left whatever continuations
+ * use. */
+bool
+available(const std::size_t * needed, const std::size_t * counts, const std::size_t * budget, std::size_t tiles_after)
+{
+	for (std::size_t kind = 0; kind <= command_tile::max_kind; ++kind) {
+		std::size_t spare = budget[kind] > tiles_after ? budget[kind] - tiles_after : 0;
+		if (needed[kind] > counts[kind] + spare) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Whether the first end elements of seq followed by one
+ * more, with given effect, amount and tiles by kind in
+ * counts, end in adjacent tiles and repeats with the same
+ * effect that fewer tiles do as well, which may reuse
+ * their tiles. budget has them taken already. */
+bool
+replaceable_run(
+	const command_sequence & seq,
+	std::size_t end,
+	effect_t effect,
+	int amount,
+	std::size_t * counts,
+	const std::size_t * budget,
+	std::size_t tiles_after)
+{
+	for (std::size_t n = end; ; --n) {
+		std::size_t tiles = std::accumulate(counts, counts + command_tile::max_kind + 1, std::size_t(0));
+		std::size_t needed[command_tile::max_kind + 1] = {};
+		if (replacement(effect, amount, needed) < tiles) {
+			if (available(needed, counts, budget, tiles_after)) {
+				return true;
+			}
+			/* half a turn either way */
+			if (effect == effect_t::turn && amount == 2) {
+				std::swap(needed[static_cast<std::size_t>(kind_t::left)], needed[static_cast<std::size_t>(kind_t::right)]);
+				if (available(needed, counts, budget, tiles_after)) {
+					return true;
+				}
+			}
+		}
+
+		int more;
+		if (n == 0 || element_effect(*seq[n - 1], more, counts) != effect) {
+			return false;
+		}
+		amount = effect == effect_t::turn ? (amount + more) % 4 : amount + more;
+	}
+}
+
+using point_list = std::vector<std::unique_ptr<command_point>>;
+
+/* Replace runs of turns by left, left left or right. */
+void
+join_turns(point_list & points)
+{
+	point_list result;
+	for (std::size_t n = 0; n < points.size(); ) {
+		if (!is_turn(points[n]->tile().kind())) {
+			result.push_back(std::move(points[n]));
+			++n;
+			continue;
+		}
+		int quarters = 0;
+		for (; n < points.size() && is_turn(points[n]->tile().kind()); ++n) {
+			quarters = (quarters + rotation(points[n]->tile().kind())) % 4;
+		}
+		if (quarters == 3) {
+			result.push_back(new_point(kind_t::right));
+		} else {
+			for (int k = 0; k < quarters; ++k) {
+				result.push_back(new_point(kind_t::left));
+			}
+		}
+	}
+	points.swap(result);
+}
+
+/* Replace runs of forward tiles by as many fwd3 as fit,
+ * followed by the remainder. */
+void
+join_forwards(point_list & points)
+{
+	point_list result;
+	for (std::size_t n = 0; n < points.size(); ) {
+		if (!is_forward(points[n]->tile().kind())) {
+			result.push_back(std::move(points[n]));
+			++n;
+			continue;
+		}
+		int distance = 0;
+		for (; n < points.size() && is_forward(points[n]->tile().kind()); ++n) {
+			distance += forward_distance(points[n]->tile().kind());
+		}
+		for (; distance > 0; distance -= std::min(distance, 3)) {
+			result.push_back(new_point(forward_kind(std::min(distance, 3))));
+		}
+	}
+	points.swap(result);
+}
+
+}
+
+bool
+same_point(const command_point & a, const command_point & b)
+{
+	if (a.tile().kind() != b.tile().kind()) {
+		return false;
+	}
+	for (std::size_t k = 0; k < a.num_branches(); ++k) {
+		if (!same_commands(a.branch(k), b.branch(k))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool
+same_commands(const command_sequence & a, const command_sequence & b)
+{
+	if (a.size() != b.size()) {
+		return false;
+	}
+	for (std::size_t n = 0; n < a.size(); ++n) {
+		if (!same_point(*a[n], *b[n])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void
+canonicalize(command_sequence & seq)
+{
+	/* branches first, so that only this level is left;
+	 * tiles standing for their body are replaced by it */
+	point_list points;
+	for (auto & cpt : seq) {
+		for (std::size_t n = 0; n < cpt->num_branches(); ++n) {
+			canonicalize(cpt->branch(n));
+		}
+		const command_tile & tile = cpt->tile();
+		std::size_t counts[command_tile::max_kind + 1] = {};
+		std::size_t needed[command_tile::max_kind + 1] = {};
+		int amount = 0;
+		effect_t effect = tile.is_repeat() ? element_effect(*cpt, amount, counts) : effect_t::other;
+		if (tile.kind() == kind_t::rep1
+			|| (tile.is_conditional() && same_commands(cpt->branch(0), cpt->branch(1)))) {
+			for (auto & inner : cpt->branch(0)) {
+				points.push_back(std::move(inner));
+			}
+		} else if (effect != effect_t::other
+			&& replacement(effect, amount, needed) <= std::accumulate(std::begin(counts), std::end(counts), std::size_t(0))) {
+			for (std::size_t k = 0; k <= command_tile::max_kind; ++k) {
+				for (std::size_t n = 0; n < needed[k]; ++n) {
+					points.push_back(new_point(static_cast<kind_t>(k)));
+				}
+			}
+		} else if (!(tile.is_repeat() && tile.kind() != kind_t::rep0 && cpt->branch(0).empty())) {
+			points.push_back(std::move(cpt));
+		}
+	}
+
+	/* turns first, as runs of them that cancel out bring
+	 * forward tiles together */
+	join_turns(points);
+	join_forwards(points);
+
+	seq.clear();
+	for (auto & cpt : points) {
+		seq.append(std::move(cpt));
+	}
+}
+
+bool
+redundant_append(
+	const command_sequence & seq,
+	command_tile::kind_t kind,
+	const std::size_t * budget,
+	std::size_t tiles_after)
+{
+	if (kind == kind_t::rep1) {
+		return true;
+	}
+	if (!is_turn(kind) && !is_forward(kind)) {
+		return false;
+	}
+
+	/* the tile appended is taken from the budget */
+	std::size_t left[command_tile::max_kind + 1];
+	std::copy(budget, budget + command_tile::max_kind + 1, left);
+	--left[static_cast<std::size_t>(kind)];
+	std::size_t counts[command_tile::max_kind + 1] = {};
+	counts[static_cast<std::size_t>(kind)] = 1;
+	return is_turn(kind) ?
+		replaceable_run(seq, seq.size(), effect_t::turn, rotation(kind), counts, left, tiles_after) :
+		replaceable_run(seq, seq.size(), effect_t::forward, forward_distance(kind), counts, left, tiles_after);
+}
+
+bool
+redundant_close(
+	const command_sequence & seq,
+	std::size_t branch,
+	const std::size_t * budget,
+	std::size_t tiles_after)
+{
+	const command_point & cpt = *seq[seq.size() - 1];
+	const command_tile & tile = cpt.tile();
+	if (!tile.is_repeat()) {
+		return tile.is_conditional() && branch == 1 && same_commands(cpt.branch(0), cpt.branch(1));
+	}
+	if (tile.kind() == kind_t::rep0) {
+		return false;
+	}
+	if (cpt.branch(0).empty()) {
+		return true;
+	}
+	std::size_t counts[command_tile::max_kind + 1] = {};
+	int amount;
+	effect_t effect = element_effect(cpt, amount, counts);
+	return effect != effect_t::other && replaceable_run(seq, seq.size() - 1, effect, amount, counts, budget, tiles_after);
+}
@@ -0,0 +1,70 @@
+#ifndef PROGRAM_RULES_H
+#define PROGRAM_RULES_H
+
+#include "tiles.h"
+
+/* Rewrites of programs that keep their runs the same under
+ * every puzzle and alternative assignment, but use fewer
+ * tiles and no more steps:
+ *
+ * - adjacent left and right cancel, as do four equal turns
+ * - three equal turns are one opposite turn
+ * - adjacent forward tiles covering up to three fields are
+ *   one forward tile
+ * - rep1 is its body
+ * - a counted repeat without body does nothing
+ * - a counted repeat of turns only, or of forward tiles
+ *   only, is the turns or forward tiles it adds up to, and
+ *   joins with those next to it
+ * - a conditional with equal branches is its branch
+ *
+ * Turns do not change the board, and forward tiles move
+ * one field per step, so splitting or joining them is not
+ * observable; repeats take a step of their own each time
+ * round. rep0 is left alone. */
+
+/* Whether sequences consist of the same tiles. */
+bool
+same_commands(const command_sequence & a, const command_sequence & b);
+
+/* Apply all rewrites until none is left; tiles created
+ * may be of kinds the puzzle does not provide. Canonical
+ * form is unique per runs of tiles: forward runs become
+ * as many fwd3 as fit followed by the remainder, turn runs
+ * become left, left left or right. Repeats of turns or
+ * forward tiles only become part of such runs where that
+ * takes no more tiles. */
+void
+canonicalize(command_sequence & seq);
+
+/* Rules for searches that build programs by appending
+ * tiles to the end of open sequences and closing them, so
+ * that tiles once next to each other stay so. They tell
+ * whether all programs continuing the current one contain
+ * a rewrite whose result can still be built from the tiles
+ * provided, and may thus be skipped: for every program left
+ * out there is one with fewer tiles that runs the same.
+ *
+ * budget holds the tiles of each kind not used yet, indexed
+ * by kind; tiles_after is the largest number of tiles any
+ * continuation may add after the one at hand. */
+
+/* Whether to skip appending a tile of given kind to the
+ * end of seq. */
+bool
+redundant_append(
+	const command_sequence & seq,
+	command_tile::kind_t kind,
+	const std::size_t * budget,
+	std::size_t tiles_after);
+
+/* Whether to skip closing given branch of the last tile
+ * of seq, with all branches before it closed already. */
+bool
+redundant_close(
+	const command_sequence & seq,
+	std::size_t branch,
+	const std::size_t * budget,
+	std::size_t tiles_after);
+
+#endif
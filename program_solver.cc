@@ -0,0 +1,1019 @@
+#include "program_solver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "alternative_explorer.h"
+#include "command_program.h"
+#include "program_rules.h"
+#include "run_engine.h"
+#include "transposition_table.h"
+#include "worker_pool.h"
+
+namespace {
+
+/* 2^20 entries of 16 bytes */
+static constexpr std::size_t table_log2_size = 20;
+
+/* Transpositions are only looked for in puzzles with at
+ * most this many alternative pairs, as all assignments
+ * are enumerated for them. */
+static constexpr std::size_t max_transposition_pairs = 10;
+
+/* transposition table value: subtree was cut short by the
+ * number of tiles */
+static constexpr std::uint64_t truncated_flag = std::uint64_t(1) << 32;
+
+/* Programs built with fewer moves than this are always
+ * handed out as separate tasks, programs with fewer than
+ * max_split_moves only while some worker is idle. */
+static constexpr std::size_t split_moves = 3;
+static constexpr std::size_t max_split_moves = 10;
+
+/* nodes evaluated between checks of cancel flag and time */
+static constexpr std::uint64_t poll_interval = 256;
+
+/* Step of building a program: appending a tile of some
+ * kind, or closing the innermost open sequence. Moves
+ * that take over the program to complete (see
+ * solver_options::base) carry base_flag. */
+using search_move = std::uint8_t;
+static constexpr search_move close_move = 0;
+static constexpr search_move base_flag = 0x80;
+
+using clock_type = std::chrono::steady_clock;
+
+double
+seconds_since(clock_type::time_point start)
+{
+	return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+/* Whether search may use tiles of given kind. */
+bool
+usable(command_tile::kind_t kind, const solver_options & options)
+{
+	if (options.straight_line) {
+		return command_tile(kind, 0.).num_branches() == 0;
+	}
+	return kind != command_tile::kind_t::rep0;
+}
+
+/* splitmix64 finalizer */
+std::uint64_t
+mix_key(std::uint64_t x)
+{
+	x += 0x9e3779b97f4a7c15ull;
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ull;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebull;
+	x ^= x >> 31;
+	return x;
+}
+
+/* Key of the runs from given segment on: the pairs they
+ * fork on and where they end, with the steps they take if
+ * with_steps. Runs that fork on different pairs get
+ * different keys, even where they end the same under every
+ * assignment. */
+std::uint64_t
+runs_key(const std::vector<alternative_exploration::segment> & segments, std::size_t seg, bool with_steps)
+{
+	const alternative_exploration::segment & s = segments[seg];
+	if (s.pair < 0) {
+		std::uint64_t key = mix_key(s.end_state);
+		return with_steps ? mix_key(key ^ std::uint64_t(s.end_steps)) : key;
+	}
+	std::uint64_t key = mix_key(runs_key(segments, s.child[0], with_steps) ^ std::uint64_t(s.pair));
+	return mix_key(key ^ runs_key(segments, s.child[1], with_steps));
+}
+
+/* Moves building seq, each branch followed by a close. */
+void
+append_moves(const command_sequence & seq, std::vector<search_move> & moves)
+{
+	for (const auto & cpt : seq) {
+		moves.push_back(static_cast<search_move>(cpt->tile().kind()));
+		for (std::size_t n = 0; n < cpt->num_branches(); ++n) {
+			append_moves(cpt->branch(n), moves);
+			moves.push_back(close_move);
+		}
+	}
+}
+
+/* Subtree of the search: the program built by the given
+ * moves, of which the last one is yet to be made. The root
+ * has no moves. */
+struct search_task {
+	std::vector<search_move> moves;
+	std::size_t tiles_left;
+};
+
+/* One deque of tasks per worker. Workers push and pop at
+ * the back of their own deque, and when it runs empty
+ * steal from the front of the others, where the tasks
+ * closest to the root and thus largest are. */
+class task_deques {
+public:
+	explicit task_deques(std::size_t num_workers);
+
+	void
+	push(std::size_t worker, search_task task);
+
+	/* Next task for worker, returns false if all deques
+	 * are empty. */
+	bool
+	pop(std::size_t worker, search_task & task);
+
+	/* Called once a popped task has been carried out. */
+	void
+	done();
+
+	/* Called by a worker that found no task: waits until
+	 * one is pushed or all have been carried out. */
+	void
+	wait();
+
+	/* Whether all tasks pushed have been carried out. */
+	inline bool
+	finished() const noexcept { return outstanding_.load(std::memory_order_acquire) == 0; }
+
+	inline std::size_t
+	idle() const noexcept { return idle_.load(std::memory_order_relaxed); }
+
+	inline void
+	set_idle(bool idle) noexcept { idle_.fetch_add(idle ? 1 : -1, std::memory_order_relaxed); }
+
+private:
+	struct deque {
+		std::mutex mutex;
+		std::deque<search_task> tasks;
+	};
+
+	std::size_t num_workers_;
+	std::unique_ptr<deque[]> deques_;
+	std::atomic<std::size_t> outstanding_{0};
+	/* tasks pushed but not yet popped */
+	std::atomic<std::size_t> queued_{0};
+	std::atomic<std::size_t> idle_{0};
+
+	std::mutex wait_mutex_;
+	std::condition_variable wake_;
+};
+
+task_deques::task_deques(std::size_t num_workers)
+	: num_workers_(num_workers), deques_(new deque[num_workers])
+{
+}
+
+void
+task_deques::push(std::size_t worker, search_task task)
+{
+	outstanding_.fetch_add(1, std::memory_order_acq_rel);
+	{
+		std::unique_lock<std::mutex> guard(deques_[worker].mutex);
+		deques_[worker].tasks.push_back(std::move(task));
+	}
+	queued_.fetch_add(1, std::memory_order_acq_rel);
+	/* taking the mutex orders this against a waiting worker
+	 * checking queued_ */
+	std::unique_lock<std::mutex> guard(wait_mutex_);
+	wake_.notify_one();
+}
+
+bool
+task_deques::pop(std::size_t worker, search_task & task)
+{
+	{
+		deque & own = deques_[worker];
+		std::unique_lock<std::mutex> guard(own.mutex);
+		if (!own.tasks.empty()) {
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			queued_.fetch_sub(1, std::memory_order_acq_rel);
+			return true;
+		}
+	}
+	for (std::size_t n = 1; n < num_workers_; ++n) {
+		deque & victim = deques_[(worker + n) % num_workers_];
+		std::unique_lock<std::mutex> guard(victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			queued_.fetch_sub(1, std::memory_order_acq_rel);
+			return true;
+		}
+	}
+	return false;
+}
+
+void
+task_deques::done()
+{
+	if (outstanding_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		std::unique_lock<std::mutex> guard(wait_mutex_);
+		wake_.notify_all();
+	}
+}
+
+void
+task_deques::wait()
+{
+	std::unique_lock<std::mutex> guard(wait_mutex_);
+	wake_.wait(guard, [this]() { return queued_.load(std::memory_order_acquire) != 0 || finished(); });
+}
+
+/* State shared by all workers of a search. */
+struct shared_search {
+	shared_search(const puzzle & puz, const solver_options & options, std::size_t num_workers);
+
+	const puzzle & puz;
+	const solver_options & options;
+	clock_type::time_point start;
+
+	/* set once search is to end early, for whatever
+	 * reason */
+	std::atomic<bool> stop{false};
+	std::atomic<bool> cancelled{false};
+
+	transposition_table table;
+	task_deques tasks;
+
+	std::mutex solutions_mutex;
+	std::vector<command_sequence> solutions;
+	/* moves building options.base, and how many of them
+	 * come before the closes ending it, which programs
+	 * containing it need not make */
+	std::vector<search_move> base_moves;
+	std::size_t base_end = 0;
+	/* worst_steps of first solution; when searching for
+	 * fewest steps, only programs with fewer are wanted */
+	std::atomic<int> best_steps{std::numeric_limits<int>::max()};
+};
+
+shared_search::shared_search(const puzzle & puz, const solver_options & options, std::size_t num_workers)
+	: puz(puz), options(options), start(clock_type::now())
+	, table(table_log2_size), tasks(num_workers)
+{
+	if (options.base) {
+		append_moves(*options.base, base_moves);
+	}
+	base_end = base_moves.size();
+	while (base_end && base_moves[base_end - 1] == close_move) {
+		--base_end;
+	}
+}
+
+/* Depth first search over programs with bounded number
+ * of tiles. The program is grown in place: tiles are
+ * appended to the innermost open sequence, which is either
+ * the program itself or a branch of a tile appended
+ * earlier; closing a branch moves on to the sequence
+ * containing its tile (or to the second branch of a
+ * conditional). */
+class program_search {
+public:
+	program_search(shared_search & shared, std::size_t worker);
+
+	/* Carry out tasks until all are done. */
+	void
+	work();
+
+	/* Start new iteration of the deepening. */
+	void
+	reset_iteration() noexcept;
+
+	/* Whether last iteration left out some programs
+	 * because they exceeded the number of tiles. */
+	inline bool truncated() const noexcept { return truncated_; }
+
+	inline std::uint64_t nodes() const noexcept { return nodes_; }
+	inline std::uint64_t simulated_steps() const noexcept { return simulated_steps_; }
+
+private:
+	/* Open sequence that tiles are appended to. */
+	struct frame {
+		command_sequence * seq;
+		/* index of the owning tile within the enclosing
+		 * frame, and branch of it; unused for program */
+		std::size_t index;
+		std::size_t branch;
+		bool conditional;
+		/* owning tile was inserted into the program to
+		 * complete, or there is none to complete */
+		bool inserted;
+	};
+
+	/* Outcome of a partial program. */
+	struct evaluation {
+		bool solved;
+		std::size_t failure_pc;
+	};
+
+	void
+	run_task(const search_task & task);
+
+	bool
+	search(const evaluation & eval, std::size_t tiles_left);
+
+	/* Whether to hand out next move as task instead of
+	 * making it. */
+	bool
+	split() const noexcept;
+
+	void
+	spawn(search_move move, std::size_t tiles_left);
+
+	/* Whether all tiles of the program to complete are
+	 * in place; always true if there is none. */
+	inline bool
+	base_complete() const noexcept { return base_pos_ >= shared_.base_end; }
+
+	/* Whether appending a tile of given kind need not be
+	 * searched, see program_rules.h. */
+	bool
+	redundant(command_tile::kind_t kind, std::size_t tiles_left) const;
+
+	/* Change program and frames for moves, without
+	 * evaluating; tiles of the program to complete use up
+	 * no budget. */
+	void
+	push_tile(command_tile::kind_t kind, bool base);
+
+	void
+	pop_tile(command_tile::kind_t kind, std::size_t depth, bool base);
+
+	frame
+	close_frame();
+
+	/* Sequence holding the tile that owns the innermost
+	 * open sequence, which must not be the program; that
+	 * tile is its last. */
+	const command_sequence &
+	owner_sequence() const noexcept;
+
+	void
+	reopen_frame(const frame & closed);
+
+	bool
+	append(command_tile::kind_t kind, std::size_t tiles_left, bool base);
+
+	bool
+	close(const evaluation & eval, std::size_t tiles_left, bool base);
+
+	bool
+	evaluate(evaluation & eval);
+
+	/* Key identifying the runs of the current program,
+	 * which must have been evaluated last, and the tiles
+	 * left. */
+	std::uint64_t
+	transposition_key(std::size_t tiles_left);
+
+	/* Lowest instruction that changes if any tile is
+	 * appended in any open sequence. */
+	std::size_t
+	stable_instructions();
+
+	std::size_t
+	insertion_difference(const command_sequence_path & path);
+
+	command_sequence_path
+	frame_path(std::size_t level, command_sequence_path path) const;
+
+	/* Whether completions of the current program might
+	 * take fewer steps than the best solution so far. */
+	bool
+	may_improve(std::size_t stable);
+
+	bool
+	verify() const;
+
+	void
+	add_solution();
+
+	shared_search & shared_;
+	const puzzle & puz_;
+	const solver_options & options_;
+	std::size_t worker_;
+
+	std::size_t budget_[command_tile::max_kind + 1] = {};
+
+	command_sequence program_;
+	std::vector<frame> frames_;
+	std::vector<search_move> moves_;
+	/* moves of the program to complete made so far */
+	std::size_t base_pos_ = 0;
+
+	command_program compiled_;
+	command_program probe_;
+	command_point probe_point_;
+
+	alternative_exploration exploration_;
+
+	bool truncated_ = false;
+	std::uint64_t nodes_ = 0;
+	std::uint64_t simulated_steps_ = 0;
+};
+
+program_search::program_search(shared_search & shared, std::size_t worker)
+	: shared_(shared), puz_(shared.puz), options_(shared.options), worker_(worker)
+	, probe_point_(std::unique_ptr<command_tile>(new command_tile(command_tile::kind_t::fwd1, 0.)))
+{
+	/* runs that can no longer reach the goal fail early,
+	 * before the instructions that would have let them
+	 * drop */
+	exploration_.set_stop_hopeless(true);
+}
+
+void
+program_search::reset_iteration() noexcept
+{
+	truncated_ = false;
+}
+
+void
+program_search::work()
+{
+	search_task task;
+	for (;;) {
+		if (shared_.tasks.pop(worker_, task)) {
+			if (!shared_.stop.load(std::memory_order_relaxed)) {
+				run_task(task);
+			}
+			shared_.tasks.done();
+		} else if (shared_.tasks.finished()) {
+			break;
+		} else {
+			shared_.tasks.set_idle(true);
+			shared_.tasks.wait();
+			shared_.tasks.set_idle(false);
+		}
+	}
+}
+
+void
+program_search::run_task(const search_task & task)
+{
+	program_.clear();
+	frames_.assign(1, frame{&program_, 0, 0, false, false});
+	moves_.clear();
+	base_pos_ = 0;
+	std::fill(std::begin(budget_), std::end(budget_), 0);
+	for (const auto & tile : puz_.tiles) {
+		if (usable(tile.first, options_)) {
+			budget_[static_cast<std::size_t>(tile.first)] = tile.second;
+		}
+	}
+
+	if (task.moves.empty()) {
+		/* runs of the empty program for the transposition
+		 * key of the root */
+		compiled_.compile(program_);
+		if (exploration_.update(puz_, compiled_, &shared_.stop)) {
+			evaluation empty{false, std::numeric_limits<std::size_t>::max()};
+			search(empty, task.tiles_left);
+		}
+		return;
+	}
+
+	for (std::size_t n = 0; n + 1 < task.moves.size(); ++n) {
+		bool base = task.moves[n] & base_flag;
+		search_move move = task.moves[n] & ~base_flag;
+		if (move == close_move) {
+			close_frame();
+		} else {
+			push_tile(static_cast<command_tile::kind_t>(move), base);
+		}
+		base_pos_ += base;
+		moves_.push_back(task.moves[n]);
+	}
+
+	bool base = task.moves.back() & base_flag;
+	search_move move = task.moves.back() & ~base_flag;
+	if (move != close_move) {
+		append(static_cast<command_tile::kind_t>(move), task.tiles_left, base);
+		return;
+	}
+
+	/* the task was split off when this program was
+	 * evaluated, redo that */
+	compiled_.compile(program_);
+	if (!exploration_.update(puz_, compiled_, &shared_.stop)) {
+		return;
+	}
+	evaluation eval{false, exploration_.failure_pc()};
+	close(eval, task.tiles_left, base);
+}
+
+bool
+program_search::search(const evaluation & eval, std::size_t tiles_left)
+{
+	if (tiles_left == 0) {
+		truncated_ = true;
+		/* the program to complete may still take the
+		 * rest of its tiles */
+		if (base_complete()) {
+			return true;
+		}
+	}
+
+	/* With all tiles closed, further tiles only continue
+	 * the runs where they ended. Programs that leave every
+	 * run in the same state and the same tiles to spare are
+	 * interchangeable; only search after one of them. The
+	 * entry is made before searching, so that programs
+	 * returning to the state of a shorter one are dropped
+	 * as well. */
+	/* Entries of other workers count as well: the subtree
+	 * is searched by them, and they report solutions and
+	 * truncation themselves. When collecting all solutions,
+	 * the programs dropped would be solutions of their own,
+	 * so there are no transpositions. */
+	std::uint64_t key = 0;
+	if (frames_.size() == 1 && !options_.find_all && puz_.alternative_tiles.size() <= max_transposition_pairs) {
+		key = transposition_key(tiles_left);
+		std::uint64_t value;
+		if (shared_.table.lookup(key, value) && (value & ~truncated_flag) >= tiles_left) {
+			truncated_ = truncated_ || (value & truncated_flag);
+			return true;
+		}
+		shared_.table.store(key, tiles_left);
+	}
+
+	bool outer_truncated = truncated_;
+	truncated_ = false;
+
+	bool keep_going = true;
+
+	/* the next move of the program to complete belongs to
+	 * its innermost open sequence, so any tiles inserted
+	 * into it must be closed first; the closes ending it
+	 * are needed to insert after them */
+	if (base_pos_ < shared_.base_moves.size() && !frames_.back().inserted) {
+		search_move move = shared_.base_moves[base_pos_];
+		if (split()) {
+			spawn(move | base_flag, tiles_left);
+		} else if (move == close_move) {
+			keep_going = close(eval, tiles_left, true);
+		} else {
+			keep_going = append(static_cast<command_tile::kind_t>(move), tiles_left, true);
+		}
+	}
+
+	/* programs with a shorter equivalent need not be
+	 * built, see program_rules.h */
+	for (std::size_t kind = command_tile::min_kind; kind <= command_tile::max_kind && keep_going && tiles_left; ++kind) {
+		if (!budget_[kind] || redundant(static_cast<command_tile::kind_t>(kind), tiles_left)) {
+			continue;
+		}
+		if (split()) {
+			spawn(static_cast<search_move>(kind), tiles_left);
+		} else {
+			keep_going = append(static_cast<command_tile::kind_t>(kind), tiles_left, false);
+		}
+	}
+	if (keep_going && frames_.size() > 1 && frames_.back().inserted
+		&& !redundant_close(owner_sequence(), frames_.back().branch, budget_, tiles_left)) {
+		if (split()) {
+			spawn(close_move, tiles_left);
+		} else {
+			keep_going = close(eval, tiles_left, false);
+		}
+	}
+
+	if (key && keep_going) {
+		shared_.table.store(key, tiles_left | (truncated_ ? truncated_flag : 0));
+	}
+	truncated_ = truncated_ || outer_truncated;
+	return keep_going;
+}
+
+bool
+program_search::split() const noexcept
+{
+	if (shared_.tasks.idle()) {
+		return moves_.size() < max_split_moves;
+	}
+	return moves_.size() < split_moves;
+}
+
+void
+program_search::spawn(search_move move, std::size_t tiles_left)
+{
+	search_task task{moves_, tiles_left};
+	task.moves.push_back(move);
+	shared_.tasks.push(worker_, std::move(task));
+}
+
+std::uint64_t
+program_search::transposition_key(std::size_t tiles_left)
+{
+	const auto & segments = exploration_.segments();
+	std::uint64_t key = segments.empty() ? 0 : runs_key(segments, 0, options_.fewest_steps);
+	/* no more than tiles_left tiles of a kind can be used,
+	 * larger budgets are all the same */
+	for (std::size_t kind = command_tile::min_kind; kind <= command_tile::max_kind; ++kind) {
+		key = mix_key(key ^ std::min(budget_[kind], tiles_left));
+	}
+	/* tiles of the program to complete still to come */
+	key = mix_key(key ^ base_pos_);
+	/* zero marks positions without key */
+	return key | 1;
+}
+
+bool
+program_search::redundant(command_tile::kind_t kind, std::size_t tiles_left) const
+{
+	/* rewrites could drop tiles of the program to complete
+	 * next to the one appended; among inserted tiles only,
+	 * all apply. rep1 is always replaced by its body, which
+	 * consists of inserted tiles. */
+	if (!shared_.base_moves.empty() && !frames_.back().inserted) {
+		return kind == command_tile::kind_t::rep1;
+	}
+	return redundant_append(*frames_.back().seq, kind, budget_, tiles_left - 1);
+}
+
+bool
+program_search::append(command_tile::kind_t kind, std::size_t tiles_left, bool base)
+{
+	std::size_t depth = frames_.size();
+	push_tile(kind, base);
+	moves_.push_back(static_cast<search_move>(kind) | (base ? base_flag : 0));
+	base_pos_ += base;
+
+	bool keep_going = true;
+	evaluation eval;
+	if (!evaluate(eval)) {
+		keep_going = false;
+	} else if (eval.solved && !options_.fewest_steps && base_complete()) {
+		if (verify()) {
+			add_solution();
+			keep_going = options_.find_all;
+		}
+	} else {
+		/* with more tiles, a solution may still be
+		 * reached in fewer steps; a program to complete
+		 * must get all its tiles first */
+		if (eval.solved && base_complete() && verify()) {
+			add_solution();
+		}
+		std::size_t stable = stable_instructions();
+		if (eval.failure_pc >= stable && may_improve(stable)) {
+			keep_going = search(eval, base ? tiles_left : tiles_left - 1);
+		}
+	}
+
+	base_pos_ -= base;
+	moves_.pop_back();
+	pop_tile(kind, depth, base);
+	return keep_going;
+}
+
+bool
+program_search::close(const evaluation & eval, std::size_t tiles_left, bool base)
+{
+	if (frames_.size() == 1) {
+		return true;
+	}
+
+	frame closed = close_frame();
+	moves_.push_back(close_move | (base ? base_flag : 0));
+	base_pos_ += base;
+
+	/* fewer places are left to append to, so more
+	 * instructions are fixed */
+	compiled_.compile(program_);
+	bool keep_going = true;
+	std::size_t stable = stable_instructions();
+	if (eval.failure_pc >= stable && may_improve(stable)) {
+		/* program level search needs the runs of this
+		 * program for transpositions */
+		if (frames_.size() == 1) {
+			keep_going = exploration_.update(puz_, compiled_, &shared_.stop);
+		}
+		if (keep_going) {
+			keep_going = search(eval, tiles_left);
+		}
+	}
+
+	base_pos_ -= base;
+	moves_.pop_back();
+	reopen_frame(closed);
+	return keep_going;
+}
+
+void
+program_search::push_tile(command_tile::kind_t kind, bool base)
+{
+	command_sequence & seq = *frames_.back().seq;
+	seq.append(std::unique_ptr<command_point>(new command_point(
+		std::unique_ptr<command_tile>(new command_tile(kind, 0.)))));
+	command_point & cpt = *seq[seq.size() - 1];
+	if (!base) {
+		--budget_[static_cast<std::size_t>(kind)];
+	}
+	if (cpt.num_branches()) {
+		frames_.push_back(frame{&cpt.branch(0), seq.size() - 1, 0, kind == command_tile::kind_t::conditional, !base});
+	}
+}
+
+void
+program_search::pop_tile(command_tile::kind_t kind, std::size_t depth, bool base)
+{
+	frames_.resize(depth);
+	if (!base) {
+		++budget_[static_cast<std::size_t>(kind)];
+	}
+	command_sequence & seq = *frames_.back().seq;
+	seq.erase(seq.begin() + (seq.size() - 1));
+}
+
+program_search::frame
+program_search::close_frame()
+{
+	frame closed = frames_.back();
+	frames_.pop_back();
+	if (closed.conditional && closed.branch == 0) {
+		command_point & cpt = *(*frames_.back().seq)[closed.index];
+		frames_.push_back(frame{&cpt.branch(1), closed.index, 1, true, closed.inserted});
+	}
+	return closed;
+}
+
+const command_sequence &
+program_search::owner_sequence() const noexcept
+{
+	return *frames_[frames_.size() - 2].seq;
+}
+
+void
+program_search::reopen_frame(const frame & closed)
+{
+	if (closed.conditional && closed.branch == 0) {
+		frames_.pop_back();
+	}
+	frames_.push_back(closed);
+}
+
+bool
+program_search::evaluate(evaluation & eval)
+{
+	if (++nodes_ % poll_interval == 0) {
+		bool cancel = options_.cancel && options_.cancel->load(std::memory_order_relaxed);
+		bool expired = options_.time_limit > 0. && seconds_since(shared_.start) > options_.time_limit;
+		if (cancel || expired) {
+			shared_.cancelled.store(true, std::memory_order_relaxed);
+			shared_.stop.store(true, std::memory_order_relaxed);
+		}
+	}
+	compiled_.compile(program_);
+
+	if (!exploration_.update(puz_, compiled_, &shared_.stop)) {
+		return false;
+	}
+	simulated_steps_ += exploration_.simulated_steps();
+
+	const alternative_outcomes & outcomes = exploration_.outcomes();
+	eval.solved = outcomes.min_score(outcomes.root()) == std::numeric_limits<int>::max();
+	eval.failure_pc = exploration_.failure_pc();
+	return true;
+}
+
+std::size_t
+program_search::stable_instructions()
+{
+	std::size_t stable = std::numeric_limits<std::size_t>::max();
+	for (std::size_t level = frames_.size(); level-- > 0; ) {
+		const frame & f = frames_[level];
+		stable = std::min(stable, insertion_difference(frame_path(level, command_sequence_path(f.seq->size()))));
+		if (f.conditional && f.branch == 0) {
+			/* second branch of conditional is still to come */
+			command_sequence_path second(f.index, std::unique_ptr<command_branch_path>(
+				new command_branch_path(1, command_sequence_path(0))));
+			stable = std::min(stable, insertion_difference(frame_path(level - 1, std::move(second))));
+		}
+	}
+	return stable;
+}
+
+std::size_t
+program_search::insertion_difference(const command_sequence_path & path)
+{
+	/* the kind of tile appended does not matter, all shift
+	 * later instructions the same way */
+	probe_.compile(program_, path, probe_point_);
+	return probe_.first_difference(compiled_);
+}
+
+command_sequence_path
+program_search::frame_path(std::size_t level, command_sequence_path path) const
+{
+	/* wrap path within sequence of given frame into
+	 * paths through all enclosing frames */
+	for (; level > 0; --level) {
+		const frame & f = frames_[level];
+		path = command_sequence_path(f.index, std::unique_ptr<command_branch_path>(
+			new command_branch_path(f.branch, std::move(path))));
+	}
+	return path;
+}
+
+bool
+program_search::verify() const
+{
+	/* explored from scratch, then every way it ends
+	 * simulated once more */
+	command_program program;
+	program.compile(program_);
+	alternative_outcomes outcomes;
+	explore_alternatives(puz_, program, outcomes);
+	if (outcomes.min_score(outcomes.root()) != std::numeric_limits<int>::max()) {
+		return false;
+	}
+	for (const auto & alternatives : outcomes.path_assignments(puz_.alternative_tiles.size())) {
+		if (simulate_execution(&puz_, &program_, alternatives, true) != std::numeric_limits<int>::max()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool
+program_search::may_improve(std::size_t stable)
+{
+	return !options_.fewest_steps
+		|| exploration_.worst_steps_bound(stable) < shared_.best_steps.load(std::memory_order_relaxed);
+}
+
+void
+program_search::add_solution()
+{
+	int steps = exploration_.worst_steps();
+	std::unique_lock<std::mutex> guard(shared_.solutions_mutex);
+	if (options_.fewest_steps) {
+		if (steps < shared_.best_steps.load(std::memory_order_relaxed)) {
+			shared_.solutions.assign(1, program_);
+			shared_.best_steps.store(steps, std::memory_order_relaxed);
+		}
+		return;
+	}
+
+	if (options_.find_all || shared_.solutions.empty()) {
+		shared_.solutions.push_back(program_);
+	}
+	if (shared_.solutions.size() == 1) {
+		shared_.best_steps.store(steps, std::memory_order_relaxed);
+	}
+	if (!options_.find_all) {
+		shared_.stop.store(true, std::memory_order_relaxed);
+	}
+}
+
+/* One pass of the search over programs of up to given
+ * number of tiles, on all workers. Returns whether some
+ * programs were left out for exceeding it. */
+bool
+search_pass(
+	shared_search & shared,
+	worker_pool & pool,
+	std::vector<std::unique_ptr<program_search>> & workers,
+	std::size_t tiles,
+	solver_result & result)
+{
+	clock_type::time_point start = clock_type::now();
+	std::uint64_t nodes = result.nodes;
+
+	for (auto & worker : workers) {
+		worker->reset_iteration();
+	}
+	shared.tasks.push(0, search_task{std::vector<search_move>(), tiles});
+	pool.run([&](std::size_t n) { workers[n]->work(); });
+
+	bool truncated = false;
+	result.nodes = 0;
+	result.simulated_steps = 0;
+	for (const auto & worker : workers) {
+		truncated = truncated || worker->truncated();
+		result.nodes += worker->nodes();
+		result.simulated_steps += worker->simulated_steps();
+	}
+	result.depth_nodes.push_back(result.nodes - nodes);
+	result.depth_seconds.push_back(seconds_since(start));
+	return truncated;
+}
+
+/* Branch and bound on steps, starting from a solution
+ * found by searching for fewest tiles. */
+solver_result
+solve_fewest_steps(const puzzle & puz, const solver_options & options)
+{
+	clock_type::time_point start = clock_type::now();
+
+	/* straight-line programs take one step per tile, the
+	 * shortest is usually a good bound */
+	solver_options first_options = options;
+	first_options.fewest_steps = false;
+	first_options.find_all = false;
+	first_options.straight_line = true;
+	solver_result first = solve_puzzle(puz, first_options);
+	if (first.solutions.empty() && first.complete && !options.straight_line) {
+		first_options.straight_line = false;
+		first_options.time_limit = options.time_limit > 0. ? std::max(1e-3, options.time_limit - seconds_since(start)) : 0.;
+		first = solve_puzzle(puz, first_options);
+	}
+	if (first.solutions.empty()) {
+		first.seconds = seconds_since(start);
+		return first;
+	}
+
+	solver_result result;
+	worker_pool & pool = options.pool ? *options.pool : worker_pool::shared();
+	shared_search shared(puz, options, pool.size());
+	shared.start = start;
+	shared.solutions = std::move(first.solutions);
+	shared.best_steps = first.steps + 1;
+
+	std::vector<std::unique_ptr<program_search>> workers;
+	for (std::size_t n = 0; n < pool.size(); ++n) {
+		workers.emplace_back(new program_search(shared, n));
+	}
+
+	std::size_t max_tiles = 0;
+	for (const auto & tile : puz.tiles) {
+		if (usable(tile.first, options)) {
+			max_tiles += tile.second;
+		}
+	}
+	max_tiles = std::min(max_tiles, options.max_tiles);
+	if (puz.alternative_tiles.empty()) {
+		/* tiles that are never executed can be left out,
+		 * so a single run executes all tiles at least once */
+		max_tiles = std::min(max_tiles, static_cast<std::size_t>(first.steps - 1));
+	}
+
+	search_pass(shared, pool, workers, max_tiles, result);
+
+	result.nodes += first.nodes;
+	result.simulated_steps += first.simulated_steps;
+	result.complete = !shared.cancelled.load(std::memory_order_relaxed);
+	result.solutions = std::move(shared.solutions);
+	result.steps = shared.best_steps - 1;
+	result.seconds = seconds_since(start);
+	return result;
+}
+
+}
+
+solver_result
+solve_puzzle(const puzzle & puz, const solver_options & options)
+{
+	if (options.fewest_steps) {
+		if (options.base) {
+			solver_options tiles_options = options;
+			tiles_options.fewest_steps = false;
+			return solve_puzzle(puz, tiles_options);
+		}
+		return solve_fewest_steps(puz, options);
+	}
+
+	solver_result result;
+
+	std::size_t total_tiles = 0;
+	for (const auto & tile : puz.tiles) {
+		if (usable(tile.first, options)) {
+			total_tiles += tile.second;
+		}
+	}
+	std::size_t max_tiles = std::min(options.max_tiles, total_tiles);
+
+	worker_pool & pool = options.pool ? *options.pool : worker_pool::shared();
+	shared_search shared(puz, options, pool.size());
+	std::vector<std::unique_ptr<program_search>> workers;
+	for (std::size_t n = 0; n < pool.size(); ++n) {
+		workers.emplace_back(new program_search(shared, n));
+	}
+
+	/* a program to complete may need no insertion at all */
+	for (std::size_t tiles = shared.base_moves.empty() ? 1 : 0; tiles <= max_tiles; ++tiles) {
+		bool truncated = search_pass(shared, pool, workers, tiles, result);
+		if (!shared.solutions.empty() || shared.cancelled.load(std::memory_order_relaxed) || !truncated) {
+			/* found, or no program gets any further with
+			 * more tiles */
+			break;
+		}
+	}
+
+	result.complete = !shared.cancelled.load(std::memory_order_relaxed)
+		|| (!options.find_all && !shared.solutions.empty());
+	result.solutions = std::move(shared.solutions);
+	result.steps = result.solutions.empty() ? 0 : shared.best_steps - 1;
+	result.seconds = seconds_since(shared.start);
+	return result;
+}
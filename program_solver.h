@@ -0,0 +1,98 @@
+#ifndef PROGRAM_SOLVER_H
+#define PROGRAM_SOLVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "puzzle.h"
+#include "tiles.h"
+
+class worker_pool;
+
+struct solver_options {
+	/* collect all solutions with the fewest tiles instead
+	 * of stopping at the first one */
+	bool find_all = false;
+	/* look for the solution taking fewest steps in the
+	 * worst case over all alternatives instead, with any
+	 * number of tiles */
+	bool fewest_steps = false;
+	/* only use tiles without branches; much faster where
+	 * the budget allows such programs, but misses solutions
+	 * that need repeats or conditionals */
+	bool straight_line = false;
+	/* only look for programs that contain this one, with
+	 * tiles inserted anywhere (including into its branches)
+	 * but none of its tiles moved or left out; the tiles of
+	 * the puzzle are those left to insert, and solutions
+	 * have the fewest insertions. fewest_steps is ignored.
+	 * Must stay unchanged during search */
+	const command_sequence * base = nullptr;
+	/* largest number of tiles to try */
+	std::size_t max_tiles = std::numeric_limits<std::size_t>::max();
+	/* search stops early once this becomes set */
+	const std::atomic<bool> * cancel = nullptr;
+	/* search stops early after this many seconds of wall
+	 * time, unless zero */
+	double time_limit = 0.;
+	/* workers to search on, shared pool if null */
+	worker_pool * pool = nullptr;
+};
+
+struct solver_result {
+	/* programs that succeed under all alternatives, all
+	 * using the same (smallest) number of tiles */
+	std::vector<command_sequence> solutions;
+	/* false if search was cancelled or ran out of time
+	 * before it could either find a solution or rule out
+	 * all programs */
+	bool complete = false;
+	/* steps taken by the first solution in the worst case
+	 * over all alternatives, not counting the setup step
+	 * of simulate_execution */
+	int steps = 0;
+
+	/* per number of tiles tried: programs examined, and
+	 * wall time spent in seconds */
+	std::vector<std::uint64_t> depth_nodes;
+	std::vector<double> depth_seconds;
+
+	std::uint64_t nodes = 0;
+	std::uint64_t simulated_steps = 0;
+	double seconds = 0.;
+};
+
+/* Searches for programs that solve the puzzle using the
+ * tiles it provides. Programs are built by iterative
+ * deepening on the number of tiles, appending tiles in
+ * program order. A partial program is abandoned as soon
+ * as one of its runs fails before reaching the place where
+ * further tiles would go, as no completion can change that
+ * run, and programs with a shorter equivalent (see
+ * program_rules.h) are not built at all. Evaluations are
+ * cached in a transposition table across iterations. Infinite repeats (rep0) are never
+ * used, runs of programs containing them need not end.
+ *
+ * When looking for fewest steps, the search starts from
+ * a solution with fewest tiles (straight-line if there is
+ * one) and then runs branch and bound over all programs
+ * within the budget: a partial program is dropped once the
+ * steps its runs take before reaching the instructions
+ * still to be changed leave no room for improvement.
+ *
+ * When completing a given program, its tiles and closes
+ * are made as moves of the search that use up no tiles,
+ * interleaved with inserted ones; rewrites that might drop
+ * its tiles are not applied.
+ *
+ * Subtrees near the root are searched as separate tasks
+ * by all workers of the pool, which steal tasks from each
+ * other once out of work and share the transposition
+ * table. Must not be called from within a job of the
+ * pool. */
+solver_result
+solve_puzzle(const puzzle & puz, const solver_options & options = solver_options());
+
+#endif
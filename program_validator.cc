@@ -0,0 +1,132 @@
+#include "program_validator.h"
+
+#include <limits>
+
+#include "alternative_explorer.h"
+#include "run_trace.h"
+
+program_validator::~program_validator()
+{
+}
+
+program_validator::program_validator()
+{
+	job_.start([this](){ thread_function(); });
+}
+
+void
+program_validator::set_puzzle(const puzzle & puz)
+{
+	std::unique_lock<std::mutex> guard(job_.mutex());
+	puzzle_.reset(new puzzle(puz));
+	program_ = command_program();
+	job_.drop();
+	result_ = result_t();
+}
+
+void
+program_validator::validate(const command_sequence & commands)
+{
+	command_program program;
+	program.compile(commands);
+
+	std::unique_lock<std::mutex> guard(job_.mutex());
+	if (commands.empty()) {
+		job_.drop();
+		result_ = result_t();
+		return;
+	}
+
+	program_ = std::move(program);
+	result_.status = status_t::pending;
+	result_.outcomes.reset();
+	result_.failures.reset();
+	result_.profile.reset();
+	job_.post();
+}
+
+program_validator::result_t
+program_validator::result() const
+{
+	std::unique_lock<std::mutex> guard(job_.mutex());
+	return result_;
+}
+
+program_validator::result_t
+program_validator::await_result() const
+{
+	std::unique_lock<std::mutex> guard(job_.mutex());
+	job_.await(guard, [this](){ return result_.status != status_t::pending; });
+	return result_;
+}
+
+void
+program_validator::thread_function()
+{
+	/* runs of programs looping forever end where their
+	 * animation does */
+	alternative_exploration exploration;
+	exploration.set_max_steps(run_trace::max_steps);
+	puzzle puz;
+
+	for (;;) {
+		command_program program;
+		std::uint64_t generation;
+		{
+			std::unique_lock<std::mutex> guard(job_.mutex());
+			if (!job_.wait(guard, generation)) {
+				return;
+			}
+			if (puzzle_) {
+				puz = std::move(*puzzle_);
+				puzzle_.reset();
+				exploration.reset();
+			}
+			program = std::move(program_);
+		}
+
+		if (!exploration.update(puz, std::move(program), job_.cancelled())) {
+			continue;
+		}
+
+		std::shared_ptr<alternative_outcomes> outcomes = std::make_shared<alternative_outcomes>(exploration.outcomes());
+		int score = outcomes->min_score(outcomes->root());
+
+		std::shared_ptr<failure_heatmap> failures;
+		if (score != std::numeric_limits<int>::max()) {
+			failures = std::make_shared<failure_heatmap>();
+			exploration.collect_failures(puz, *failures);
+		}
+
+		{
+			std::unique_lock<std::mutex> guard(job_.mutex());
+			if (!job_.current(generation)) {
+				continue;
+			}
+			if (score == std::numeric_limits<int>::max()) {
+				result_.status = status_t::succeeded;
+				result_.failing_step = 0;
+			} else {
+				result_.status = status_t::failed;
+				result_.failing_step = score;
+			}
+			result_.outcomes = std::move(outcomes);
+			result_.worst_steps = exploration.worst_steps();
+			result_.failures = std::move(failures);
+			job_.posted();
+		}
+
+		/* the profile runs all alternatives from scratch, so
+		 * it follows once the outcome is known; a new request
+		 * cancels it like any validation */
+		std::shared_ptr<execution_profile> profile = std::make_shared<execution_profile>();
+		if (!profile_alternatives(puz, exploration.program(), *profile, job_.cancelled(), run_trace::max_steps)) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard(job_.mutex());
+		if (job_.current(generation)) {
+			result_.profile = std::move(profile);
+		}
+	}
+}
@@ -0,0 +1,96 @@
+#ifndef PROGRAM_VALIDATOR_H
+#define PROGRAM_VALIDATOR_H
+
+#include <memory>
+
+#include "background_job.h"
+#include "command_program.h"
+#include "puzzle.h"
+
+class alternative_outcomes;
+struct execution_profile;
+struct failure_heatmap;
+
+/* Validates the program while it is being edited: all
+ * floor alternatives are explored on a dedicated thread,
+ * see alternative_exploration, and where runs fail is
+ * collected there as well. Once the result is posted, how
+ * often every command executes (see profile_alternatives)
+ * follows. A new request cancels any validation or
+ * profile still in progress, so bursts of edits do not
+ * queue up stale work. Runs fail once they take as many
+ * steps as a run is animated for at most (see
+ * run_trace::max_steps), so programs looping forever get
+ * validated as well. */
+class program_validator {
+public:
+	enum class status_t {
+		/* nothing to validate */
+		idle = 0,
+		/* validation of latest request in progress */
+		pending = 1,
+		/* program reaches goal under all alternatives */
+		succeeded = 2,
+		/* program fails under some alternative */
+		failed = 3
+	};
+
+	struct result_t {
+		status_t status = status_t::idle;
+		/* step at which the earliest failing alternative
+		 * fails, if failed */
+		int failing_step = 0;
+		/* outcomes under all alternatives, and steps taken
+		 * in the worst case (see alternative_exploration),
+		 * once validated */
+		std::shared_ptr<const alternative_outcomes> outcomes;
+		int worst_steps = 0;
+		/* where runs under all alternatives fail, if
+		 * failed */
+		std::shared_ptr<const failure_heatmap> failures;
+		/* steps taken by every command under all
+		 * alternatives, some time after validation */
+		std::shared_ptr<const execution_profile> profile;
+	};
+
+	~program_validator();
+
+	program_validator();
+
+	program_validator(const program_validator & other) = delete;
+	program_validator & operator=(const program_validator & other) = delete;
+
+	/* Validate subsequent requests against given puzzle. */
+	void
+	set_puzzle(const puzzle & puz);
+
+	/* Request validation of given program. The program is
+	 * compiled on the calling thread, everything else
+	 * happens in the background. */
+	void
+	validate(const command_sequence & commands);
+
+	/* Result for latest request; never waits for
+	 * validation to complete. */
+	result_t
+	result() const;
+
+	/* Result for latest request once it is validated (the
+	 * profile may still follow), waiting for that. */
+	result_t
+	await_result() const;
+
+private:
+	void
+	thread_function();
+
+	/* data shared between caller / validation thread,
+	 * guarded by the mutex of job_ */
+	std::unique_ptr<puzzle> puzzle_;
+	command_program program_;
+	result_t result_;
+
+	background_job job_;
+};
+
+#endif
@@ -1,6 +1,10 @@
 #include "puzzle.h"
 
+#include <algorithm>
 #include <sstream>
+#include <stdexcept>
+
+#include "run_engine.h"
 
 static const char puzzle_data[] = R"(
    X
@@ -8,6 +12,8 @@ static const char puzzle_data[] = R"(
 >###
 T left 1
 T fwd1 5
+P tiles 6
+P steps 6
 -------------
 >###
    #
@@ -15,10 +21,14 @@ T fwd1 5
 T right 1
 T fwd2 1
 T fwd3 1
+P tiles 3
+P steps 6
 -------------
 >#####X
 T fwd3 1
 T rep2 1
+P tiles 2
+P steps 8
 -------------
    X
    #
@@ -27,6 +37,8 @@ T rep2 1
 T fwd1 2
 T rep3 2
 T left 1
+P tiles 4
+P steps 13
 -------------
 >####
     #
@@ -35,6 +47,8 @@ T fwd1 1
 T fwd2 1
 T rep2 2
 T right 1
+P tiles 4
+P steps 11
 -------------
 ^##
   #
@@ -42,11 +56,15 @@ X##
 T fwd2 1
 T right 1
 T rep3 1
+P tiles 3
+P steps 12
 -------------
 >#####X
 T fwd1 1
 T rep2 1
 T rep3 1
+P tiles 3
+P steps 14
 -------------
 O#O#X
 # O
@@ -54,6 +72,8 @@ O#O#X
 T fwd2 3
 T left 1
 T right 1
+P tiles 5
+P steps 8
 -------------
 >##
   O
@@ -64,6 +84,8 @@ T fwd2 1
 T fwd3 2
 T left 1
 T right 1
+P tiles 5
+P steps 9
 -------------
 >
 #
@@ -74,6 +96,8 @@ T right 1
 T fwd2 2
 T left 1
 T rep2 1
+P tiles 5
+P steps 14
 -------------
 < #####
 # #   #
@@ -89,6 +113,8 @@ T fwd3 2
 T fwd2 2
 T fwd1 2
 T left 3
+P tiles 12
+P steps 44
 -------------
 >##aX
   O
@@ -97,6 +123,8 @@ T fwd1 2
 T fwd2 2
 T right 2
 T left 2
+P tiles 8
+P steps 10
 -------------
 X#O#O#<
     # #
@@ -106,6 +134,8 @@ T rep3 1
 T left 3
 T right 1
 T fwd2 3
+P tiles 8
+P steps 19
 -------------
 X#aOAO<
     # #
@@ -115,6 +145,8 @@ T fwd2 6
 T fwd3 2
 T right 5
 T left 5
+P tiles 13
+P steps 18
 -------------
   v
   #
@@ -129,6 +161,8 @@ T fwd2 10
 T fwd3 10
 T right 10
 T left 10
+P tiles 16
+P steps 23
 -------------
   A
   O
@@ -141,6 +175,8 @@ T rep3 1
 T left 3
 T fwd2 3
 T right 1
+P tiles 8
+P steps 27
 -------------
    ###
    #B#
@@ -154,6 +190,7 @@ T right 10
 T left 10
 T rep2 3
 T rep3 3
+P steps 25
 -------------
 ###B
 ###O
@@ -166,6 +203,8 @@ T fwd1 5
 T fwd2 5
 T fwd3 5
 T right 8
+P tiles 9
+P steps 15
 -------------
     v
     #
@@ -174,6 +213,8 @@ T fwd2 1
 T right 1
 T conditional 1
 T rep4 1
+P tiles 4
+P steps 12
 -------------
 ###X
 1 #
@@ -183,6 +224,8 @@ T fwd2 4
 T left 2
 T right 2
 T conditional 1
+P tiles 7
+P steps 8
 -------------
 )";
 
@@ -191,6 +234,9 @@ T conditional 1
  *   Lines starting with "-": Begin next level
  *   Lines starting with "T": (ex: "T fwd1 4") designate tile counts
  *      possible tiles: fwd1 fwd2 fwd3 left right conditional rep2,,rep5
+ *   Lines starting with "P": (ex: "P tiles 4", "P steps 12") designate
+ *      par, fewest tiles resp. steps (worst case over alternatives,
+ *      excluding setup) any solution needs, as found by lamrob-solve
  *   All other lines describe grid layout, using the following chars:
  *
  *   < > ^ v : robot starting position and orientation
@@ -409,6 +455,22 @@ aggregate_weights(
 	}
 }
 
+void
+parse_par_line(puzzle & puz, std::string::const_iterator i, const std::string::const_iterator & limit)
+{
+	/* skip leading "P " from line */
+	get_next_token(i, limit);
+	std::string kind = get_next_token(i, limit);
+	std::size_t count;
+	std::istringstream(get_next_token(i, limit)) >> count;
+
+	if (kind == "tiles") {
+		puz.par_tiles = count;
+	} else if (kind == "steps") {
+		puz.par_steps = count;
+	}
+}
+
 std::vector<puzzle>
 parse_puzzles(const std::string & data)
 {
@@ -431,8 +493,14 @@ parse_puzzles(const std::string & data)
 			char c = *lbegin;
 			if (c == 'T') {
 				parse_tile_line(*current, lbegin, lend);
+			} else if (c == 'P') {
+				parse_par_line(*current, lbegin, lend);
 			} else if (c == '-') {
 				parse_grid(std::move(grid), *current, weight_x / ntiles, weight_y / ntiles);
+				if (const char * limit = run_step_state::exceeded_limit(*current)) {
+					throw std::runtime_error("puzzle " + std::to_string(result.size()) + ": " + limit);
+				}
+				current->distances.compute(*current);
 				y = 0;
 				ntiles = 0;
 				weight_x = 0;
@@ -451,6 +519,108 @@ parse_puzzles(const std::string & data)
 	return result;
 }
 
+namespace {
+
+const char *
+tile_name(command_tile::kind_t kind)
+{
+	switch (kind) {
+		case command_tile::kind_t::left: return "left";
+		case command_tile::kind_t::right: return "right";
+		case command_tile::kind_t::fwd1: return "fwd1";
+		case command_tile::kind_t::fwd2: return "fwd2";
+		case command_tile::kind_t::fwd3: return "fwd3";
+		case command_tile::kind_t::conditional: return "conditional";
+		case command_tile::kind_t::rep0: return "rep0";
+		case command_tile::kind_t::rep1: return "rep1";
+		case command_tile::kind_t::rep2: return "rep2";
+		case command_tile::kind_t::rep3: return "rep3";
+		case command_tile::kind_t::rep4: return "rep4";
+		case command_tile::kind_t::rep5: return "rep5";
+		default: return "?";
+	}
+}
+
+char
+start_symbol(grid_dir_t dir)
+{
+	switch (dir.value()) {
+		case grid_dir_t::north: return '>';
+		case grid_dir_t::west: return '^';
+		case grid_dir_t::south: return '<';
+		case grid_dir_t::east: default: return 'v';
+	}
+}
+
+}
+
+std::string
+format_puzzle(const puzzle & puz)
+{
+	grid_pos_t min = puz.start.pos, max = puz.start.pos;
+	auto extend = [&min, &max](grid_pos_t pos)
+	{
+		min.x = std::min(min.x, pos.x);
+		min.y = std::min(min.y, pos.y);
+		max.x = std::max(max.x, pos.x);
+		max.y = std::max(max.y, pos.y);
+	};
+	extend(puz.end);
+	puz.grid.iterate([&extend](int x, int y, floor_tile_t) { extend(grid_pos_t{x, y}); });
+	for (const auto & alternative : puz.alternative_tiles) {
+		extend(alternative.first);
+		extend(alternative.second);
+	}
+
+	/* rows run from top (largest y) to bottom */
+	std::vector<std::string> rows(max.y - min.y + 1, std::string(max.x - min.x + 1, ' '));
+	auto symbol = [&rows, &min, &max](grid_pos_t pos) -> char &
+	{
+		return rows[max.y - pos.y][pos.x - min.x];
+	};
+	puz.grid.iterate([&symbol](int x, int y, floor_tile_t tile)
+	{
+		char & c = symbol(grid_pos_t{x, y});
+		if (tile.trigger_id > 0) {
+			c = 'A' + (tile.trigger_id - 1);
+		} else if (tile.trigger_id < 0) {
+			c = 'a' + (-tile.trigger_id - 1);
+		} else {
+			c = '#';
+		}
+	});
+	for (std::size_t n = 0; n < puz.alternative_tiles.size(); ++n) {
+		symbol(puz.alternative_tiles[n].first) = '0' + n;
+		symbol(puz.alternative_tiles[n].second) = '0' + n;
+	}
+	for (const auto & obstacle : puz.obstacles) {
+		symbol(obstacle) = 'O';
+	}
+	symbol(puz.end) = 'X';
+	symbol(puz.start.pos) = start_symbol(puz.start.dir);
+
+	std::ostringstream os;
+	for (auto & row : rows) {
+		/* empty lines are skipped, rows without any
+		 * field keep a single space */
+		row.erase(std::max<std::size_t>(row.find_last_not_of(' ') + 1, 1));
+		os << row << '\n';
+	}
+	for (const auto & tile : puz.tiles) {
+		if (tile.second) {
+			os << "T " << tile_name(tile.first) << ' ' << tile.second << '\n';
+		}
+	}
+	if (puz.par_tiles) {
+		os << "P tiles " << puz.par_tiles << '\n';
+	}
+	if (puz.par_steps) {
+		os << "P steps " << puz.par_steps << '\n';
+	}
+	os << "-------------\n";
+	return os.str();
+}
+
 const std::vector<puzzle> & get_puzzles()
 {
 	static const std::vector<puzzle> puzzles = parse_puzzles(puzzle_data);
@@ -1,6 +1,10 @@
 #ifndef PUZZLE_H
 #define PUZZLE_H
 
+#include <string>
+#include <vector>
+
+#include "goal_distance.h"
 #include "grid.h"
 #include "tiles.h"
 
@@ -30,8 +34,30 @@ struct puzzle {
 	std::vector<grid_pos_t> obstacles;
 
 	std::vector<std::pair<grid_pos_t, grid_pos_t>> alternative_tiles;
+
+	/* fewest tiles and fewest steps (see solver_result) a
+	 * solution needs, 0 if not known */
+	std::size_t par_tiles = 0;
+	std::size_t par_steps = 0;
+
+	/* lower bounds on steps to the goal; filled in for the
+	 * built-in puzzles, others need to compute them */
+	goal_distance distances;
 };
 
 const std::vector<puzzle> & get_puzzles(); // XXX use this
 
+/* Puzzles in the text format of the built-in ones (see
+ * puzzle.cc), each ended by a line starting with "-".
+ * Throws std::runtime_error if one does not fit the run
+ * engine, see run_step_state::exceeded_limit. */
+std::vector<puzzle>
+parse_puzzles(const std::string & data);
+
+/* Text of puzzle in that format, ended by a line of
+ * dashes. Positions are relative, as parsing centers the
+ * floor around the origin. */
+std::string
+format_puzzle(const puzzle & puz);
+
 #endif
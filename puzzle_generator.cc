@@ -0,0 +1,420 @@
+#include "puzzle_generator.h"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <random>
+
+#include "alternative_explorer.h"
+#include "command_program.h"
+#include "program_solver.h"
+#include "run_engine.h"
+#include "worker_pool.h"
+
+namespace {
+
+using kind_t = command_tile::kind_t;
+using random_engine = std::mt19937_64;
+
+/* programs tried per candidate before giving up */
+static constexpr std::size_t max_trace_attempts = 1000;
+
+/* steps traced at most; longer runs make for tedious
+ * puzzles */
+static constexpr std::size_t max_trace_steps = 64;
+
+int
+uniform(random_engine & rng, int low, int high)
+{
+	return std::uniform_int_distribution<int>(low, high)(rng);
+}
+
+bool
+chance(random_engine & rng, double p)
+{
+	return std::bernoulli_distribution(p)(rng);
+}
+
+std::unique_ptr<command_point>
+new_point(kind_t kind)
+{
+	return std::unique_ptr<command_point>(new command_point(
+		std::unique_ptr<command_tile>(new command_tile(kind, 0.))));
+}
+
+/* Appends given number of tiles: turns and forward tiles,
+ * some of them within repeats. */
+void
+random_sequence(random_engine & rng, std::size_t tiles, int depth, command_sequence & seq)
+{
+	/* forward tiles come up more often, turns alone go
+	 * nowhere */
+	static const kind_t simple[] = {
+		kind_t::left, kind_t::right, kind_t::fwd1, kind_t::fwd2, kind_t::fwd3, kind_t::fwd1, kind_t::fwd2
+	};
+	while (tiles) {
+		if (depth < 2 && tiles >= 3 && chance(rng, .3)) {
+			std::size_t body = uniform(rng, 1, std::min<int>(tiles - 1, 3));
+			std::unique_ptr<command_point> cpt = new_point(chance(rng, .5) ? kind_t::rep2 : kind_t::rep3);
+			random_sequence(rng, body, depth + 1, cpt->branch(0));
+			seq.append(std::move(cpt));
+			tiles -= body + 1;
+		} else {
+			seq.append(new_point(simple[uniform(rng, 0, 6)]));
+			--tiles;
+		}
+	}
+}
+
+/* Coordinates of robot before and after every step of
+ * the program, run on an open field of given radius around
+ * the origin from facing north. Returns false if the robot
+ * leaves the field or takes too many steps. */
+bool
+trace(const command_sequence & seq, int radius, std::vector<grid_coord_t> & path)
+{
+	puzzle open;
+	for (int x = -radius; x <= radius; ++x) {
+		for (int y = -radius; y <= radius; ++y) {
+			open.grid(x, y).trigger_id = 0;
+		}
+	}
+	open.start.pos = grid_pos_t{0, 0};
+	open.start.dir = grid_dir_t::north;
+	/* out of reach */
+	open.end = grid_pos_t{radius + 1, radius + 1};
+
+	command_program program;
+	program.compile(seq);
+	run_step_state state;
+	state.initialize(open, &program);
+	state.apply_alternatives(open, {});
+	path.assign(1, state.robot);
+	if (!state.start_program()) {
+		return false;
+	}
+	for (std::size_t n = 0; n < max_trace_steps; ++n) {
+		path.push_back(state.current_step().robot_target);
+		switch (state.complete_step()) {
+			case run_step_state::step_result_t::running: {
+				break;
+			}
+			case run_step_state::step_result_t::program_end: {
+				return true;
+			}
+			default: {
+				return false;
+			}
+		}
+	}
+	return false;
+}
+
+void
+count_tiles(const command_sequence & seq, std::map<kind_t, std::size_t> & tiles)
+{
+	for (const auto & cpt : seq) {
+		++tiles[cpt->tile().kind()];
+		for (std::size_t n = 0; n < cpt->num_branches(); ++n) {
+			count_tiles(cpt->branch(n), tiles);
+		}
+	}
+}
+
+grid_pos_t
+neighbor(grid_pos_t pos, grid_dir_t dir)
+{
+	grid_vec_t v = dir.vec();
+	return grid_pos_t{pos.x + v.dx, pos.y + v.dy};
+}
+
+/* Layout under construction: floor fields and what is on
+ * them, kept within a square of given size. */
+class layout {
+public:
+	layout(const std::vector<grid_coord_t> & path, int size);
+
+	/* Whether field has no floor yet, and floor there
+	 * keeps the layout within its size. */
+	bool
+	free(grid_pos_t pos) const;
+
+	/* Whether field is floor without anything on it and
+	 * neither start nor goal. */
+	bool
+	plain(grid_pos_t pos) const;
+
+	/* First step of path at which the robot is on given
+	 * field, path size if never. */
+	std::size_t
+	first_visit(grid_pos_t pos) const;
+
+	/* Whether the robot is on given field at one step of
+	 * path only. */
+	bool
+	visited_once(grid_pos_t pos) const;
+
+	void
+	add_floor(grid_pos_t pos, int trigger_id = 0);
+
+	puzzle puz;
+	const std::vector<grid_coord_t> & path;
+
+private:
+	int size_;
+	grid_pos_t min_, max_;
+};
+
+layout::layout(const std::vector<grid_coord_t> & init_path, int size)
+	: path(init_path), size_(size), min_(init_path.front().pos), max_(init_path.front().pos)
+{
+	for (const auto & coord : path) {
+		add_floor(coord.pos);
+	}
+	puz.start.pos = path.front().pos;
+	puz.start.dir = path.front().dir;
+	puz.end = path.back().pos;
+}
+
+bool
+layout::free(grid_pos_t pos) const
+{
+	if (puz.grid.get(pos.x, pos.y)) {
+		return false;
+	}
+	for (const auto & alternative : puz.alternative_tiles) {
+		if (alternative.first == pos || alternative.second == pos) {
+			return false;
+		}
+	}
+	return std::max(max_.x, pos.x) - std::min(min_.x, pos.x) < size_
+		&& std::max(max_.y, pos.y) - std::min(min_.y, pos.y) < size_;
+}
+
+bool
+layout::plain(grid_pos_t pos) const
+{
+	const floor_tile_t * tile = puz.grid.get(pos.x, pos.y);
+	if (!tile || tile->trigger_id || pos == puz.start.pos || pos == puz.end) {
+		return false;
+	}
+	return std::find(puz.obstacles.begin(), puz.obstacles.end(), pos) == puz.obstacles.end();
+}
+
+std::size_t
+layout::first_visit(grid_pos_t pos) const
+{
+	std::size_t n = 0;
+	while (n < path.size() && path[n].pos != pos) {
+		++n;
+	}
+	return n;
+}
+
+bool
+layout::visited_once(grid_pos_t pos) const
+{
+	return std::count_if(path.begin(), path.end(),
+		[&pos](const grid_coord_t & coord) { return coord.pos == pos; }) == 1;
+}
+
+void
+layout::add_floor(grid_pos_t pos, int trigger_id)
+{
+	puz.grid(pos.x, pos.y).trigger_id = trigger_id;
+	min_.x = std::min(min_.x, pos.x);
+	min_.y = std::min(min_.y, pos.y);
+	max_.x = std::max(max_.x, pos.x);
+	max_.y = std::max(max_.y, pos.y);
+}
+
+/* Fields next to the path, for the robot to stray onto. */
+void
+add_side_fields(random_engine & rng, layout & l, int count)
+{
+	for (int n = 0; n < count; ++n) {
+		grid_pos_t pos = l.path[uniform(rng, 0, l.path.size() - 1)].pos;
+		grid_pos_t side = neighbor(pos, static_cast<grid_dir_t::value_t>(uniform(rng, 0, 3)));
+		if (l.free(side)) {
+			l.add_floor(side);
+		}
+	}
+}
+
+/* Trap door on the path, closed by pushing an obstacle
+ * met earlier on the path onto its trigger, which lies
+ * straight ahead off the path. */
+bool
+add_trap(random_engine & rng, layout & l, int trigger_id)
+{
+	const auto & path = l.path;
+	for (int attempt = 0; attempt < 16; ++attempt) {
+		std::size_t push = uniform(rng, 1, path.size() - 2);
+		grid_pos_t obstacle = path[push].pos;
+		if (obstacle == path[push - 1].pos || !l.plain(obstacle) || l.first_visit(obstacle) != push) {
+			continue;
+		}
+		grid_pos_t trigger = neighbor(obstacle, path[push].dir);
+		if (!l.free(trigger)) {
+			continue;
+		}
+		std::size_t trap = uniform(rng, push + 1, path.size() - 1);
+		grid_pos_t door = path[trap].pos;
+		if (!l.plain(door) || l.first_visit(door) <= push) {
+			continue;
+		}
+		l.puz.obstacles.push_back(obstacle);
+		l.add_floor(trigger, trigger_id);
+		l.add_floor(door, -trigger_id);
+		return true;
+	}
+	return false;
+}
+
+void
+add_obstacle(random_engine & rng, layout & l)
+{
+	std::vector<grid_pos_t> fields;
+	l.puz.grid.iterate([&l, &fields](int x, int y, floor_tile_t)
+	{
+		if (l.plain(grid_pos_t{x, y})) {
+			fields.push_back(grid_pos_t{x, y});
+		}
+	});
+	if (!fields.empty()) {
+		l.puz.obstacles.push_back(fields[uniform(rng, 0, fields.size() - 1)]);
+	}
+}
+
+/* Field of the path that may be moved sideways instead. */
+bool
+add_alternative(random_engine & rng, layout & l)
+{
+	const auto & path = l.path;
+	for (int attempt = 0; attempt < 16; ++attempt) {
+		const grid_coord_t & coord = path[uniform(rng, 1, path.size() - 2)];
+		if (!l.plain(coord.pos) || !l.visited_once(coord.pos)) {
+			continue;
+		}
+		grid_pos_t side = neighbor(coord.pos, chance(rng, .5) ? coord.dir.left() : coord.dir.right());
+		if (!l.free(side)) {
+			continue;
+		}
+		l.puz.grid.erase(coord.pos.x, coord.pos.y);
+		if (chance(rng, .5)) {
+			l.puz.alternative_tiles.emplace_back(coord.pos, side);
+		} else {
+			l.puz.alternative_tiles.emplace_back(side, coord.pos);
+		}
+		return true;
+	}
+	return false;
+}
+
+}
+
+bool
+generate_candidate(std::uint64_t seed, const generator_options & options, puzzle & puz)
+{
+	random_engine rng(seed);
+
+	command_sequence program;
+	std::vector<grid_coord_t> path;
+	bool traced = false;
+	for (std::size_t n = 0; n < max_trace_attempts && !traced; ++n) {
+		program.clear();
+		random_sequence(rng, uniform(rng, options.min_tiles, options.max_tiles), 0, program);
+		traced = trace(program, options.max_size, path) && path.size() > 2 && path.front().pos != path.back().pos;
+		if (traced) {
+			/* fits if every field does */
+			grid_pos_t min = path.front().pos, max = min;
+			for (const auto & coord : path) {
+				min.x = std::min(min.x, coord.pos.x);
+				min.y = std::min(min.y, coord.pos.y);
+				max.x = std::max(max.x, coord.pos.x);
+				max.y = std::max(max.y, coord.pos.y);
+			}
+			traced = max.x - min.x < options.max_size && max.y - min.y < options.max_size;
+		}
+	}
+	if (!traced) {
+		return false;
+	}
+
+	layout l(path, options.max_size);
+	add_side_fields(rng, l, uniform(rng, 0, 3));
+	/* trigger ids are letters A to H */
+	int traps = uniform(rng, 0, std::min<int>(options.max_traps, 8));
+	for (int n = 0; n < traps; ++n) {
+		add_trap(rng, l, n + 1);
+	}
+	int obstacles = uniform(rng, 0, options.max_obstacles);
+	for (int n = 0; n < obstacles; ++n) {
+		add_obstacle(rng, l);
+	}
+	/* alternatives are digits */
+	int alternatives = uniform(rng, 0, std::min<int>(options.max_alternatives, 10));
+	for (int n = 0; n < alternatives; ++n) {
+		add_alternative(rng, l);
+	}
+
+	count_tiles(program, l.puz.tiles);
+	if (!l.puz.alternative_tiles.empty()) {
+		l.puz.tiles[kind_t::conditional] += l.puz.alternative_tiles.size();
+	}
+	static const kind_t spare[] = {
+		kind_t::left, kind_t::right, kind_t::fwd1, kind_t::fwd2, kind_t::fwd3, kind_t::rep2, kind_t::rep3
+	};
+	int spares = uniform(rng, 0, options.max_spare_tiles);
+	for (int n = 0; n < spares; ++n) {
+		++l.puz.tiles[spare[uniform(rng, 0, 6)]];
+	}
+
+	puz = std::move(l.puz);
+	return true;
+}
+
+bool
+accept_candidate(puzzle & puz, const generator_options & options)
+{
+	worker_pool single(1);
+
+	solver_options search;
+	search.find_all = true;
+	search.max_tiles = options.max_tiles;
+	search.time_limit = options.time_limit;
+	search.pool = &single;
+	solver_result found = solve_puzzle(puz, search);
+	if (!found.complete || found.solutions.empty() || found.solutions.size() > options.max_solutions) {
+		return false;
+	}
+	std::size_t tiles = found.solutions.front().num_tiles();
+	if (tiles < options.min_tiles) {
+		return false;
+	}
+
+	/* once for every way runs of a solution can end */
+	for (const auto & solution : found.solutions) {
+		command_program program;
+		program.compile(solution);
+		alternative_outcomes outcomes;
+		explore_alternatives(puz, program, outcomes);
+		for (const auto & alternatives : outcomes.path_assignments(puz.alternative_tiles.size())) {
+			if (simulate_execution(&puz, &solution, alternatives) != std::numeric_limits<int>::max()) {
+				return false;
+			}
+		}
+	}
+
+	/* fewest steps may need more tiles than fewest tiles
+	 * do, any number within the budget counts */
+	search.find_all = false;
+	search.fewest_steps = true;
+	search.max_tiles = std::numeric_limits<std::size_t>::max();
+	search.time_limit = std::max(1e-3, options.time_limit - found.seconds);
+	solver_result fastest = solve_puzzle(puz, search);
+
+	puz.par_tiles = tiles;
+	puz.par_steps = fastest.complete && !fastest.solutions.empty() ? fastest.steps : 0;
+	return true;
+}
@@ -0,0 +1,52 @@
+#ifndef PUZZLE_GENERATOR_H
+#define PUZZLE_GENERATOR_H
+
+#include <cstdint>
+#include <string>
+
+#include "puzzle.h"
+
+struct generator_options {
+	/* largest width and height of the floor */
+	int max_size = 8;
+	/* most obstacles (not counting those needed for trap
+	 * doors), trap doors with their trigger, and alternative
+	 * pairs per puzzle */
+	std::size_t max_obstacles = 1;
+	std::size_t max_traps = 1;
+	std::size_t max_alternatives = 1;
+	/* most tiles in the budget that the program the layout
+	 * was traced from does not use */
+	std::size_t max_spare_tiles = 2;
+	/* accepted puzzles need at least min_tiles and at most
+	 * max_tiles tiles to solve, and have at most
+	 * max_solutions solutions with fewest tiles */
+	std::size_t min_tiles = 4;
+	std::size_t max_tiles = 7;
+	std::size_t max_solutions = 3;
+	/* seconds the searches may take per candidate */
+	double time_limit = 10.;
+};
+
+/* Random candidate puzzle. The floor is the path of a
+ * random program of min_tiles to max_tiles tiles run on an
+ * open field, with the goal where it ends and a few fields
+ * next to the path added; the tiles of that program and
+ * some spare ones make up the budget. Obstacles and trap
+ * doors go onto the path, each trap door with an obstacle
+ * the robot pushes onto its trigger earlier on, and
+ * alternatives move a field of the path aside. Equal seeds
+ * give equal candidates. Returns false if no program
+ * traced a path within max_size. */
+bool
+generate_candidate(std::uint64_t seed, const generator_options & options, puzzle & puz);
+
+/* Whether puzzle meets the options: its solutions are
+ * searched for (see solve_puzzle) on the calling thread
+ * only, and each one is checked by simulate_execution
+ * under all alternatives. Fills in par of puzzle if
+ * accepted, steps only if their search completes in time. */
+bool
+accept_candidate(puzzle & puz, const generator_options & options);
+
+#endif
@@ -2,26 +2,15 @@
 
 #include <GL/gl.h>
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
+#include <sstream>
 
-#include "clock.h"
 #include "texgen.h"
 
 namespace {
 
-view_coord_t
-to_view_coord(const grid_coord_t & coord)
-{
-	view_coord_t  result;
-	result.x = coord.pos.x;
-	result.y = coord.pos.y;
-	result.z = 0.;
-	result.angle = coord.dir.angle();
-	result.tilt = 0.;
-	return result;
-}
-
 double
 get_alternative_opacity(double now, std::size_t index)
 {
@@ -36,667 +25,6 @@ get_alternative_opacity(double now, std::size_t index)
 
 }
 
-void
-run_step_state::set_obstacle(int index, grid_pos_t pos)
-{
-	auto i = obstacles.find(index);
-	if (i != obstacles.end()) {
-		grid(i->second.x, i->second.y).obstacle = -1;
-	}
-	obstacles[index] = pos;
-	grid(pos.x, pos.y).obstacle = index;
-}
-
-void
-run_step_state::clear_obstacle(int index)
-{
-	auto i = obstacles.find(index);
-	if (i != obstacles.end()) {
-		grid(i->second.x, i->second.y).obstacle = -1;
-		obstacles.erase(i);
-	}
-}
-
-void
-run_step_state::initialize(const puzzle & puz, const command_sequence * init_seq)
-{
-	seq = init_seq;
-	robot.pos = puz.start.pos;
-	robot.dir = puz.start.dir;
-
-	branch_states.clear();
-	obstacles.clear();
-	grid.clear();
-
-	puz.grid.iterate([this](int x, int y, floor_tile_t tile)
-	{
-		if (tile.trigger_id >= 0) {
-			grid(x, y).has_floor = true;
-		}
-		if (tile.trigger_id > 0) {
-			trigger_floors[tile.trigger_id].first = grid_pos_t{x, y};
-		}
-		if (tile.trigger_id < 0) {
-			trigger_floors[-tile.trigger_id].second = grid_pos_t{x, y};
-		}
-	});
-	goal = puz.end;
-
-	for (std::size_t index = 0; index < puz.obstacles.size(); ++index) {
-		set_obstacle(index, puz.obstacles[index]);
-	}
-}
-
-
-run_step::~run_step()
-{
-}
-
-std::unique_ptr<run_step>
-run_step::make_initial(
-	const puzzle & puz,
-	const run_step_state & state,
-	const std::vector<std::size_t> & alternatives)
-{
-	std::unique_ptr<run_step> result;
-	result.reset(new setup_run_step(0.0, puz, alternatives));
-	return result;
-}
-
-
-namespace {
-
-void
-animate_falling_obstacles(
-	double current_time,
-	const std::unordered_map<int, falling_obstacle> & falling_obstacles,
-	board_view & bv)
-{
-	for (const auto & o : falling_obstacles) {
-		if (o.second.start_time > current_time) {
-			continue;
-		}
-		double delta_time = current_time - o.second.start_time;
-		double x = o.second.start.x + o.second.vx * delta_time;
-		double y = o.second.start.y + o.second.vy * delta_time;
-		double z = o.second.start.z + o.second.vz * delta_time - .5 * delta_time * delta_time * 8;
-		double angle = o.second.start.angle;
-		double tilt = delta_time * 240;
-
-		bv.set_obstacle_pos(o.first, x, y, z, angle, tilt);
-	}
-}
-
-}
-
-setup_run_step::~setup_run_step()
-{
-}
-
-setup_run_step::setup_run_step(
-	double start_time,
-	const puzzle & puz,
-	const std::vector<std::size_t> & alternatives)
-	: run_step(start_time)
-{
-	double now = get_current_time();
-	for (std::size_t n = 0; n < puz.alternative_tiles.size(); ++n) {
-		std::size_t option = n >= alternatives.size() ? 0 : alternatives[n];
-
-		floor_tiles_.push_back({
-			puz.alternative_tiles[n].first,
-			board_view::get_alternative_tile_color(n),
-			(option == 0),
-			get_alternative_opacity(now, 0)
-		});
-
-		floor_tiles_.push_back({
-			puz.alternative_tiles[n].second,
-			board_view::get_alternative_tile_color(n),
-			(option == 1),
-			get_alternative_opacity(now, 1)
-		});
-	}
-}
-
-void
-setup_run_step::step(
-	run_step_state & state,
-	std::unique_ptr<run_step> & next_step)
-{
-	for (const auto & floor_tile : floor_tiles_) {
-		if (floor_tile.present) {
-			state.grid(floor_tile.pos.x, floor_tile.pos.y).has_floor = true;
-		} else {
-			state.grid.erase(floor_tile.pos.x, floor_tile.pos.y);
-		}
-	}
-
-	if (!state.seq->empty()) {
-		next_step.reset(new command_run_step(start_time() + animation_duration(), command_sequence_path(0), state, {}));
-	} else {
-		next_step.reset();
-	}
-}
-
-void
-setup_run_step::animate(
-	double delta_time,
-	board_view & bv) const
-{
-	double f_end = animation_duration() ? delta_time / animation_duration() : 0.0;
-	double f_start = 1 - f_end;
-	for (const auto & floor_tile : floor_tiles_) {
-		double start_state = floor_tile.start_state;
-		double end_state = floor_tile.present ? 1.0 : 0.0;
-		board_view::tile_color_t color = floor_tile.color;
-		color.a = f_start * start_state + f_end * end_state;
-		bv.modify_floor(floor_tile.pos.x, floor_tile.pos.y).color = color;
-	}
-}
-
-void
-setup_run_step::end_animate(
-	board_view & bv) const
-{
-	for (const auto & floor_tile : floor_tiles_) {
-		if (floor_tile.present) {
-			bv.modify_floor(floor_tile.pos.x, floor_tile.pos.y).color = floor_tile.color;
-		} else {
-			bv.clear_floor(floor_tile.pos.x, floor_tile.pos.y);
-		}
-	}
-}
-
-double
-setup_run_step::animation_duration() const noexcept
-{
-	return floor_tiles_.empty() ? 0.0 : 1.0;
-}
-
-namespace {
-
-void
-replenish_repetitions(const command_sequence & seq, run_step_state & state);
-
-void
-replenish_repetitions(const command_point & cpt, run_step_state & state)
-{
-	state.branch_states.erase(&cpt.tile());
-	for (std::size_t n = 0; n < cpt.num_branches(); ++n) {
-		replenish_repetitions(cpt.branch(n), state);
-	}
-}
-
-void
-replenish_repetitions(const command_sequence & seq, run_step_state & state)
-{
-	for (const auto & cpt : seq) {
-		replenish_repetitions(*cpt, state);
-	}
-}
-
-}
-
-command_run_step::~command_run_step()
-{
-}
-
-command_run_step::command_run_step(
-	double start_time,
-	command_sequence_path current_command,
-	run_step_state & rs,
-	std::unordered_map<int, falling_obstacle> falling_obstacles)
-	: run_step(start_time)
-	, current_path_(std::move(current_command))
-	, current_command_(rs.seq->lookup(current_path_))
-	, falling_obstacles_(std::move(falling_obstacles))
-{
-	begin_step(rs, 0);
-}
-
-void
-command_run_step::step(
-	run_step_state & state,
-	std::unique_ptr<run_step> & next_step)
-{
-	if (will_drop_) {
-		double x = .5 * (robot_coord_origin_.pos.x + robot_coord_target_.pos.x);
-		double y = .5 * (robot_coord_origin_.pos.y + robot_coord_target_.pos.y);
-		double z = 0;
-		double angle = robot_coord_origin_.dir.angle() + robot_coord_origin_.dir.delta_angle(robot_coord_target_.dir) * .5;
-		double vx = (robot_coord_target_.pos.x - robot_coord_origin_.pos.x);
-		double vy = (robot_coord_target_.pos.y - robot_coord_origin_.pos.y);
-		double vz = 0;
-
-		next_step.reset(
-			new drop_run_step(
-				start_time() + 0.5,
-				state,
-				dropping_object{{x, y, z, angle}, vx, vy, vz},
-				std::move(falling_obstacles_)));
-	} else {
-		state.robot = robot_coord_target_;
-
-		if (move_obstacle_ != -1) {
-			if (!obstacle_will_drop_) {
-				state.set_obstacle(move_obstacle_, obstacle_pos_target_);
-			} else {
-				state.clear_obstacle(move_obstacle_);
-			}
-		}
-
-		if (closes_trap_) {
-			state.grid(closed_trap_.x, closed_trap_.y).has_floor = true;
-		}
-
-		if (state.robot.pos == state.goal) {
-			next_step.reset(new finish_goal_run_step(start_time() + 1.0, robot_coord_target_, std::move(falling_obstacles_)));
-		} else {
-			int limit_sub_steps;
-			switch (current_command_->tile().kind()) {
-				case command_tile::kind_t::fwd2: {
-					limit_sub_steps = 2;
-					break;
-				}
-				case command_tile::kind_t::fwd3: {
-					limit_sub_steps = 3;
-					break;
-				}
-				default : {
-					limit_sub_steps = 1;
-				}
-			}
-
-			if (used_sub_steps_ + 1 >= limit_sub_steps) {
-				if (current_command_->tile().is_repeat()) {
-					state.branch_states[&current_command_->tile()] = current_branch_state_ - 1;
-				}
-				advance_command(state);
-				if (!current_command_) {
-					next_step.reset(new finish_fail_run_step(start_time() + 1.0, std::move(falling_obstacles_)));
-				} else {
-					set_start_time(start_time() + 1.0);
-					begin_step(state, 0);
-				}
-			} else {
-				set_start_time(start_time() + 1.0);
-				begin_step(state, used_sub_steps_ + 1);
-			}
-		}
-	}
-}
-
-void
-command_run_step::advance_command(run_step_state & state)
-{
-	if (current_command_->tile().is_conditional()) {
-		current_path_.down(current_branch_state_);
-	} else if (current_command_->tile().is_repeat()) {
-		current_branch_state_ = 0;
-		current_path_.down(0);
-	} else {
-		current_path_.advance();
-	}
-
-	current_command_ = state.seq->lookup(current_path_);
-	while (!current_command_) {
-		if (current_path_.is_leaf()) {
-			// reached end of command sequence
-			break;
-		}
-		current_path_.up();
-		current_command_ = state.seq->lookup(current_path_);
-		if (current_command_->tile().is_conditional()) {
-			current_path_.advance();
-			current_command_ = state.seq->lookup(current_path_);
-		} else if (current_command_->tile().is_repeat()) {
-			std::size_t rep = state.branch_states.find(&current_command_->tile())->second;
-			if (rep == 0) {
-				current_path_.advance();
-				current_command_ = state.seq->lookup(current_path_);
-			} else {
-				break;
-			}
-		}
-	}
-}
-
-void
-command_run_step::animate(
-	double delta_time,
-	board_view & bv) const
-{
-	double f_target = delta_time;
-	double f_origin = 1 - f_target;
-
-	double x = robot_coord_origin_.pos.x * f_origin + robot_coord_target_.pos.x * f_target;
-	double y = robot_coord_origin_.pos.y * f_origin + robot_coord_target_.pos.y * f_target;
-	double z = 0;
-	double angle = robot_coord_origin_.dir.angle() + robot_coord_origin_.dir.delta_angle(robot_coord_target_.dir) * f_target;
-
-	double wheel_angle = current_command_->tile().is_conditional() || current_command_->tile().is_repeat() ? 0.0 : delta_time * M_PI * 2 * 2;
-	bv.set_robot_pos(x, y, z, angle, 0., wheel_angle);
-	current_command_->tile().set_state(command_tile::state_t::flashing);
-
-	if (delta_time > 0.5) {
-		animate_branch_states();
-	}
-
-	animate_beam(bv, delta_time);
-
-
-	if (move_obstacle_ != -1) {
-		double x = obstacle_pos_origin_.x * f_origin + obstacle_pos_target_.x * f_target;
-		double y = obstacle_pos_origin_.y * f_origin + obstacle_pos_target_.y * f_target;
-		double z = 0;
-		bv.set_obstacle_pos(move_obstacle_, x, y, z, 0., 0.);
-	}
-
-	if (closes_trap_) {
-		bv.modify_floor(closed_trap_.x, closed_trap_.y).opened = std::min(1.0, 2 * f_origin);
-	}
-
-	animate_falling_obstacles(delta_time + start_time(), falling_obstacles_, bv);
-}
-
-void
-command_run_step::end_animate(
-	board_view & bv) const
-{
-	if (!will_drop_) {
-		bv.set_robot_pos(robot_coord_target_.pos.x, robot_coord_target_.pos.y, 0., robot_coord_target_.dir.angle(), 0., 0.);
-	}
-	if (move_obstacle_ != -1 && !obstacle_will_drop_) {
-		bv.set_obstacle_pos(move_obstacle_, obstacle_pos_target_.x, obstacle_pos_target_.y, 0., 0., 0.);
-	}
-	if (closes_trap_) {
-		bv.modify_floor(closed_trap_.x, closed_trap_.y).opened = 0.0;
-	}
-
-	animate_branch_states();
-
-	animate_beam(bv, 1.);
-
-	if (current_command_->tile().is_repeat()) {
-		if (current_branch_state_ > 1) {
-			current_command_->tile().set_repetitions_left(current_branch_state_ - 1);
-			current_command_->tile().set_state(command_tile::state_t::normal);
-		} else {
-			current_command_->tile().set_repetitions_left(current_command_->tile().num_repetitions());
-			current_command_->tile().set_state(command_tile::state_t::depleted);
-		}
-	} else {
-		current_command_->tile().set_state(command_tile::state_t::depleted);
-	}
-}
-
-void
-command_run_step::animate_branch_states() const
-{
-	if (current_command_->tile().is_repeat()) {
-		current_command_->branch(0).replenish();
-		current_command_->tile().set_repetitions_left(current_branch_state_ - 1);
-	} else if (current_command_->tile().is_conditional()) {
-		/* fuse out the branch we do not want to take */
-		current_command_->branch(1 - current_branch_state_).exhaust();
-	}
-}
-
-void
-command_run_step::animate_beam(board_view & bv, double delta_time) const
-{
-	if (!current_command_->tile().is_conditional() ||
-		(delta_time < .2) ||
-		(delta_time >= .4 && delta_time < .6) ||
-		(delta_time > .8)) {
-		bv.set_robot_beam(board_view::robot_beam_t::off);
-	} else {
-		bv.set_robot_beam(current_branch_state_ ? board_view::robot_beam_t::hits_nothing : board_view::robot_beam_t::hits_floor);
-	}
-}
-
-double
-command_run_step::animation_duration() const noexcept
-{
-	return will_drop_ ? 0.5 : 1.0;
-}
-
-void
-command_run_step::begin_step(run_step_state & state, int used_sub_steps)
-{
-	used_sub_steps_ = used_sub_steps;
-	robot_coord_origin_ = state.robot;
-	robot_coord_target_ = compute_target_coord(robot_coord_origin_);
-	const auto * tile = state.grid.get(robot_coord_target_.pos.x, robot_coord_target_.pos.y);
-	will_drop_ = !(tile && tile->has_floor);
-	closes_trap_ = false;
-
-	move_obstacle_ = tile ? tile->obstacle : -1;
-	if (move_obstacle_ != -1) {
-		obstacle_pos_origin_ = robot_coord_target_.pos;
-		obstacle_pos_target_ = obstacle_pos_origin_;
-		grid_vec_t v = state.robot.dir.vec();
-		obstacle_pos_target_.x += v.dx;
-		obstacle_pos_target_.y += v.dy;
-
-		const auto * o_tile = state.grid.get(obstacle_pos_target_.x, obstacle_pos_target_.y);
-		obstacle_will_drop_ = !(o_tile && o_tile->has_floor);
-
-		if (obstacle_will_drop_) {
-			double x = .5 * (obstacle_pos_origin_.x + obstacle_pos_target_.x);
-			double y = .5 * (obstacle_pos_origin_.y + obstacle_pos_target_.y);
-			double z = 0;
-			double angle = robot_coord_origin_.dir.angle() + robot_coord_origin_.dir.delta_angle(robot_coord_target_.dir) * .5;
-			double vx = (obstacle_pos_target_.x - obstacle_pos_target_.x);
-			double vy = (obstacle_pos_target_.y - obstacle_pos_target_.y);
-			double vz = 0;
-
-			falling_obstacles_[move_obstacle_] = falling_obstacle {
-				{x, y, z, angle}, vx, vy, vz, start_time() + .5
-			};
-		} else if (o_tile && o_tile->obstacle != -1) {
-			robot_coord_target_ = robot_coord_origin_;
-			move_obstacle_ = -1;
-		}
-
-		for (const auto & trigger : state.trigger_floors) {
-			if (trigger.second.first == obstacle_pos_target_) {
-				closed_trap_ = trigger.second.second;
-				closes_trap_ = true;
-			}
-		}
-	}
-
-	if (current_command_->tile().is_repeat()) {
-		replenish_repetitions(current_command_->branch(0), state);
-		auto i = state.branch_states.emplace(&current_command_->tile(), current_command_->tile().num_repetitions()).first;
-		current_branch_state_ = i->second;
-		i->second -= 1;
-	} else if (current_command_->tile().is_conditional()) {
-		current_branch_state_ = check_floor_ahead(state, robot_coord_target_) ? 0 : 1;
-	}
-}
-
-grid_coord_t
-command_run_step::compute_target_coord(grid_coord_t robot) const
-{
-	switch (current_command_->tile().kind()) {
-		case command_tile::kind_t::left: {
-			robot.dir = robot.dir.left();
-			break;
-		}
-		case command_tile::kind_t::right: {
-			robot.dir = robot.dir.right();
-			break;
-		}
-		case command_tile::kind_t::fwd1:
-		case command_tile::kind_t::fwd2:
-		case command_tile::kind_t::fwd3: {
-			grid_vec_t v = robot.dir.vec();
-			robot.pos.x += v.dx;
-			robot.pos.y += v.dy;
-			break;
-		}
-		default: {
-			break;
-		}
-	}
-
-	return robot;
-}
-
-bool
-command_run_step::check_floor_ahead(const run_step_state & state, grid_coord_t robot) const
-{
-	grid_vec_t v = robot.dir.vec();
-	robot.pos.x += v.dx;
-	robot.pos.y += v.dy;
-	const auto * tile = state.grid.get(robot.pos.x, robot.pos.y);
-	return tile && tile->has_floor;
-}
-
-drop_run_step::~drop_run_step()
-{
-}
-
-drop_run_step::drop_run_step(
-	double start_time,
-	const run_step_state & rs,
-	dropping_object dropping_robot,
-	std::unordered_map<int, falling_obstacle> falling_obstacles)
-	: run_step(start_time)
-	, dropping_robot_(std::move(dropping_robot))
-	, falling_obstacles_(std::move(falling_obstacles))
-{
-}
-
-void
-drop_run_step::animate(
-	double delta_time,
-	board_view & bv) const
-{
-	double x = dropping_robot_.start.x + dropping_robot_.vx * delta_time;
-	double y = dropping_robot_.start.y + dropping_robot_.vy * delta_time;
-	double z = dropping_robot_.start.z + dropping_robot_.vz * delta_time - .5 * delta_time * delta_time * 8;
-	double angle = dropping_robot_.start.angle;
-	double tilt = delta_time * 240;
-
-	bv.set_robot_pos(x, y, z, angle, tilt, 0.);
-
-	animate_falling_obstacles(delta_time + start_time(), falling_obstacles_, bv);
-}
-
-void
-drop_run_step::end_animate(
-	board_view & bv) const
-{
-}
-
-double
-drop_run_step::animation_duration() const noexcept
-{
-	return 3;
-}
-
-void
-drop_run_step::step(
-	run_step_state & state,
-	std::unique_ptr<run_step> & next_step)
-{
-	next_step.reset();
-}
-
-
-finish_goal_run_step::~finish_goal_run_step()
-{
-}
-
-finish_goal_run_step::finish_goal_run_step(
-	double start_time,
-	grid_coord_t end_coord,
-	std::unordered_map<int, falling_obstacle> falling_obstacles)
-	: run_step(start_time)
-	, end_coord_(end_coord)
-	, falling_obstacles_(std::move(falling_obstacles))
-{
-}
-
-void
-finish_goal_run_step::step(
-	run_step_state & state,
-	std::unique_ptr<run_step> & next_step)
-{
-	state.succeeded = true;
-	next_step.reset();
-}
-
-void
-finish_goal_run_step::animate(
-	double delta_time,
-	board_view & bv) const
-{
-	view_coord_t coord = to_view_coord(end_coord_);
-	coord.angle += delta_time * 240;
-
-	bv.set_robot_pos(coord.x, coord.y, coord.z, coord.angle, 0., 0.);
-
-	animate_falling_obstacles(delta_time + start_time(), falling_obstacles_, bv);
-}
-
-void
-finish_goal_run_step::end_animate(
-	board_view & bv) const
-{
-}
-
-double
-finish_goal_run_step::animation_duration() const noexcept
-{
-	return 3;
-}
-
-finish_fail_run_step::~finish_fail_run_step()
-{
-}
-
-finish_fail_run_step::finish_fail_run_step(
-	double start_time,
-	std::unordered_map<int, falling_obstacle> falling_obstacles)
-	: run_step(start_time)
-	, falling_obstacles_(std::move(falling_obstacles))
-{
-}
-
-void
-finish_fail_run_step::step(
-	run_step_state & state,
-	std::unique_ptr<run_step> & next_step)
-{
-	next_step.reset();
-}
-
-void
-finish_fail_run_step::animate(
-	double delta_time,
-	board_view & bv) const
-{
-	animate_falling_obstacles(delta_time + start_time(), falling_obstacles_, bv);
-}
-
-void
-finish_fail_run_step::end_animate(
-	board_view & bv) const
-{
-}
-
-double
-finish_fail_run_step::animation_duration() const noexcept
-{
-	return 3;
-}
-
-
 run_controller::run_controller(
 	command_queue * cq, command_tile_repository * command_tile_repository, board_view * board_view, std::function<void()> success)
 	: run_state_(run_state_t::not_running), puzzle_(nullptr), command_queue_(cq), command_tile_repository_(command_tile_repository)
@@ -735,7 +63,7 @@ run_controller::redraw(double global_phase)
 {
 	glEnable(GL_TEXTURE_2D);
 
-	for (std::size_t n = 0; n < 5; ++n) {
+	for (std::size_t n = 0; n < 7; ++n) {
 		double x = bounds_.x1 + n * 32;
 		double y = bounds_.y1;
 
@@ -743,16 +71,35 @@ run_controller::redraw(double global_phase)
 
 		draw_button(x, y, kind, get_button_state(kind));
 	}
+
+	draw_validation(bounds_.x1 + 7 * 32 + 8, bounds_.y1);
+	draw_hint_button(bounds_.x1 + 8 * 32 + 16, bounds_.y1);
+	draw_seek_bar(global_phase);
 }
 
 void
 run_controller::handle_button_press(double x, double y, double now)
 {
-	if (x < bounds_.x1 || y < bounds_.y1 || y >= bounds_.y1 + 32) {
+	if (x < bounds_.x1 || y < bounds_.y1) {
+		return;
+	}
+	if (y >= bounds_.y1 + 36) {
+		if (run_state_ != run_state_t::not_running && x < bounds_.x1 + 7 * 32) {
+			seeking_ = true;
+			seek_to_bar(x, now);
+		}
+		return;
+	}
+	if (y >= bounds_.y1 + 32) {
+		return;
+	}
+	double hint_x = bounds_.x1 + 8 * 32 + 16;
+	if (x >= hint_x && x < hint_x + 32) {
+		set_hints_enabled(!hints_enabled_);
 		return;
 	}
 	int index = (x - bounds_.x1) / 32.;
-	if (index >= 5) {
+	if (index >= 7) {
 		return;
 	}
 	if (index == 0) {
@@ -767,6 +114,20 @@ run_controller::handle_button_press(double x, double y, double now)
 	run_state_ = static_cast<run_state_t>(index);
 }
 
+void
+run_controller::handle_pointer_motion(double x, double y, double now)
+{
+	if (seeking_ && run_state_ != run_state_t::not_running) {
+		seek_to_bar(x, now);
+	}
+}
+
+void
+run_controller::handle_button_release()
+{
+	seeking_ = false;
+}
+
 void
 run_controller::draw_button(double x, double y, run_state_t kind, button_state_t state) const
 {
@@ -818,6 +179,14 @@ run_controller::draw_button(double x, double y, run_state_t kind, button_state_t
 			texid = texid_button_run3x;
 			break;
 		}
+		case run_state_t::turbo: {
+			texid = texid_button_turbo;
+			break;
+		}
+		case run_state_t::instant: {
+			texid = texid_button_instant;
+			break;
+		}
 	}
 
 	texture_generator::make_tex_quad2d(
@@ -828,6 +197,130 @@ run_controller::draw_button(double x, double y, run_state_t kind, button_state_t
 		x, y + button_h);
 }
 
+void
+run_controller::draw_validation(double x, double y) const
+{
+	program_validator::result_t result = validator_.result();
+	if (result.status == program_validator::status_t::idle) {
+		return;
+	}
+
+	double w = 32;
+	double h = 32;
+	glColor4f(1., 1., 1., 1.);
+
+	texture_generator::make_tex_quad2d(
+		texid_button_raised_bg,
+		x, y,
+		x + w, y,
+		x + w, y + h,
+		x, y + h);
+
+	switch (result.status) {
+		case program_validator::status_t::succeeded: {
+			texture_generator::make_scratch_text("ok");
+			glColor4f(.2, 1., .2, 1.);
+			break;
+		}
+		case program_validator::status_t::failed: {
+			std::ostringstream os;
+			os << result.failing_step;
+			texture_generator::make_scratch_text(os.str().c_str());
+			glColor4f(1., .2, .2, 1.);
+			break;
+		}
+		default: {
+			texture_generator::make_scratch_text("...");
+			glColor4f(.5, .5, .5, 1.);
+			break;
+		}
+	}
+
+	texture_generator::make_tex_quad2d(
+		texid_scratch,
+		x, y,
+		x + w, y,
+		x + w, y + h,
+		x, y + h);
+}
+
+void
+run_controller::draw_hint_button(double x, double y) const
+{
+	double w = 32;
+	double h = 32;
+	glColor4f(1., 1., 1., 1.);
+
+	texture_generator::make_tex_quad2d(
+		hints_enabled_ ? texid_button_lowered_bg : texid_button_raised_bg,
+		x, y,
+		x + w, y,
+		x + w, y + h,
+		x, y + h);
+
+	hint_engine::status_t status = hints_enabled_ ? hints_.result().status : hint_engine::status_t::idle;
+	switch (status) {
+		case hint_engine::status_t::pending: {
+			texture_generator::make_scratch_text("...");
+			glColor4f(.5, .5, .5, 1.);
+			break;
+		}
+		case hint_engine::status_t::found: {
+			texture_generator::make_scratch_text("?");
+			glColor4f(1., 1., .2, 1.);
+			break;
+		}
+		case hint_engine::status_t::none: {
+			texture_generator::make_scratch_text("-");
+			glColor4f(1., .2, .2, 1.);
+			break;
+		}
+		default: {
+			texture_generator::make_scratch_text("?");
+			glColor4f(.5, .5, .5, 1.);
+			break;
+		}
+	}
+
+	texture_generator::make_tex_quad2d(
+		texid_scratch,
+		x, y,
+		x + w, y,
+		x + w, y + h,
+		x, y + h);
+}
+
+void
+run_controller::draw_seek_bar(double global_phase) const
+{
+	if (run_state_ == run_state_t::not_running || trace_.end_time() <= 0.) {
+		return;
+	}
+
+	double x1 = bounds_.x1;
+	double x2 = bounds_.x1 + 7 * 32;
+	double y1 = bounds_.y1 + 36;
+	double y2 = bounds_.y1 + 44;
+	double f = get_current_animation_clock(global_phase) / trace_.end_time();
+	double xf = x1 + (x2 - x1) * std::max(0., std::min(f, 1.));
+
+	glColor4f(.2, .2, .2, 1.);
+	texture_generator::make_tex_quad2d(
+		texid_solid,
+		x1, y1,
+		x2, y1,
+		x2, y2,
+		x1, y2);
+
+	glColor4f(1., 1., .2, 1.);
+	texture_generator::make_tex_quad2d(
+		texid_solid,
+		x1, y1,
+		xf, y1,
+		xf, y2,
+		x1, y2);
+}
+
 run_controller::button_state_t
 run_controller::get_button_state(run_state_t kind) const
 {
@@ -835,27 +328,59 @@ run_controller::get_button_state(run_state_t kind) const
 }
 
 double
-run_controller::get_current_animation_clock(double now) const
+run_controller::get_clock_speed() const
 {
-	double clock_speed = 0.0;
+	bool fast = run_state_ == run_state_t::turbo || run_state_ == run_state_t::instant;
+	if (fast && animation_clock_base_ >= trace_.outcome_time()) {
+		return 1.0;
+	}
+
 	switch (run_state_) {
 		case run_state_t::run1x: {
-			clock_speed = 0.5;
-			break;
+			return 0.5;
 		}
 		case run_state_t::run2x: {
-			clock_speed = 1.0;
-			break;
+			return 1.0;
 		}
 		case run_state_t::run3x: {
-			clock_speed = 2.0;
-			break;
+			return 2.0;
+		}
+		case run_state_t::turbo: {
+			return 16.0;
 		}
 		default: {
-			clock_speed = 0.0;
+			/* instant seeks to the outcome, see animate */
+			return 0.0;
 		}
 	}
-	return animation_clock_base_ + (now - wall_clock_base_) * clock_speed;
+}
+
+double
+run_controller::get_current_animation_clock(double now) const
+{
+	return animation_clock_base_ + (now - wall_clock_base_) * get_clock_speed();
+}
+
+void
+run_controller::seek(double time, double now)
+{
+	animation_clock_base_ = std::max(0.0, std::min(time, trace_.end_time()));
+	wall_clock_base_ = now;
+}
+
+void
+run_controller::seek_to_bar(double x, double now)
+{
+	/* instant would go straight back to the outcome */
+	if (run_state_ == run_state_t::instant) {
+		animation_clock_base_ = get_current_animation_clock(now);
+		wall_clock_base_ = now;
+		run_state_ = run_state_t::paused;
+	}
+
+	double f = (x - bounds_.x1) / (7 * 32);
+	/* the run is over at its end time, stay just before */
+	seek(std::min(f, .999) * trace_.end_time(), now);
 }
 
 
@@ -890,27 +415,155 @@ run_controller::animate_idle(double now)
 	}
 }
 
+void
+run_controller::update_prediction()
+{
+	if (command_queue_->hover_revision() != predicted_hover_revision_) {
+		predicted_hover_revision_ = command_queue_->hover_revision();
+		command_program program;
+		if (command_queue_->compile_hover(program)) {
+			predictor_.predict(std::move(program));
+		} else {
+			predictor_.cancel();
+			board_view_->set_ghost_path({}, false);
+		}
+	}
+
+	if (predictor_.poll(prediction_)) {
+		board_view_->set_ghost_path(prediction_.path, prediction_.reaches_goal);
+	}
+}
+
+void
+run_controller::update_analysis()
+{
+	program_validator::result_t result = validator_.result();
+	if (result.failures == shown_failures_ && result.profile == shown_profile_) {
+		return;
+	}
+	shown_failures_ = result.failures;
+	shown_profile_ = result.profile;
+
+	/* heat relative to the hottest tile */
+	std::vector<std::pair<const command_point *, tile_tint_t>> tints;
+	if (result.profile) {
+		double hottest = 1.;
+		for (const auto & command : result.profile->commands) {
+			hottest = std::max(hottest, command.second);
+		}
+		for (const auto & command : result.profile->commands) {
+			tile_tint_t tint;
+			tint.r = 1.;
+			tint.g = .6;
+			tint.b = .1;
+			tint.a = .4 * command.second / hottest;
+			tint.crossed = command.second == 0;
+			tints.emplace_back(command.first, tint);
+		}
+	}
+
+	/* failures show instead of heat */
+	std::vector<std::pair<grid_pos_t, double>> cells;
+	if (result.failures) {
+		double total = result.failures->failures;
+		result.failures->cells.iterate([&cells, total](int x, int y, double count)
+		{
+			cells.emplace_back(grid_pos_t{x, y}, count / total);
+		});
+		for (const auto & command : result.failures->commands) {
+			tile_tint_t tint;
+			tint.r = 1.;
+			tint.g = .2;
+			tint.b = .2;
+			tint.a = .15 + .45 * (command.second / total);
+			auto i = std::find_if(tints.begin(), tints.end(),
+				[&command](const std::pair<const command_point *, tile_tint_t> & entry)
+				{
+					return entry.first == command.first;
+				});
+			if (i != tints.end()) {
+				i->second = tint;
+			} else {
+				tints.emplace_back(command.first, tint);
+			}
+		}
+	}
+
+	board_view_->set_failure_heatmap(std::move(cells));
+	command_queue_->set_tints(tints);
+}
+
+void
+run_controller::update_hint()
+{
+	if (!hints_enabled_) {
+		return;
+	}
+
+	if (!hint_requested_ || command_queue_->revision() != hinted_revision_) {
+		hint_requested_ = true;
+		hinted_revision_ = command_queue_->revision();
+		hint_shown_ = false;
+		command_queue_->clear_hint();
+		hints_.request(command_queue_->commands());
+	}
+
+	if (!hint_shown_) {
+		hint_engine::result_t result = hints_.result();
+		if (result.status == hint_engine::status_t::found) {
+			command_queue_->set_hint(result.kind, result.path());
+			hint_shown_ = true;
+		}
+	}
+}
+
+void
+run_controller::set_hints_enabled(bool enabled)
+{
+	hints_enabled_ = enabled;
+	if (!enabled) {
+		hints_.cancel();
+		command_queue_->clear_hint();
+		hint_requested_ = false;
+	}
+}
+
 void
 run_controller::animate(double now)
 {
+	if (command_queue_->revision() != validated_revision_) {
+		validated_revision_ = command_queue_->revision();
+		validator_.validate(command_queue_->commands());
+	}
+
 	if (run_state_ == run_state_t::not_running) {
+		update_prediction();
+		update_analysis();
+		update_hint();
 		animate_idle(now);
 		return;
 	}
 
+	/* Fast modes go on at normal speed once the outcome is
+	 * reached, instant ones right away. Showing the run at
+	 * any time costs the same (see run_trace::apply), so
+	 * however far the clock moved since the last frame, no
+	 * steps need to be caught up on. */
 	double animation_clock = get_current_animation_clock(now);
-	while (run_step_ && animation_clock > run_step_->end_time()) {
-		run_step_->end_animate(*board_view_);
-		run_step_->step(run_step_state_, run_step_);
+	bool fast = run_state_ == run_state_t::turbo || run_state_ == run_state_t::instant;
+	if (fast && animation_clock_base_ < trace_.outcome_time() &&
+		(run_state_ == run_state_t::instant || animation_clock >= trace_.outcome_time())) {
+		seek(trace_.outcome_time(), now);
+		animation_clock = animation_clock_base_;
 	}
-	if (run_step_) {
-		run_step_->animate(animation_clock - run_step_->start_time(), *board_view_);
+
+	if (animation_clock < trace_.end_time()) {
+		trace_.apply(animation_clock, *board_view_);
 	} else {
-		bool succeeded = run_step_state_.succeeded;
+		bool succeeded = trace_.succeeded();
 		handle_stop();
 		if (succeeded) {
 			success_();
-			run_step_state_.succeeded = false;
 		}
 	}
 }
@@ -922,13 +575,42 @@ run_controller::handle_start(double now)
 		return;
 	}
 
-	std::vector<std::size_t> alternatives = try_find_failing_alternative(puzzle_, &command_queue_->commands());
-
-	run_step_state_.initialize(*puzzle_, &command_queue_->commands());
-	run_step_ = run_step::make_initial(*puzzle_, run_step_state_, alternatives);
-	if (!run_step_) {
-		return;
+	/* the validator explores the program in the background,
+	 * usually it is done already; otherwise wait for it,
+	 * which runs ending after run_trace::max_steps bound */
+	if (validated_revision_ != command_queue_->revision()) {
+		validated_revision_ = command_queue_->revision();
+		validator_.validate(command_queue_->commands());
 	}
+	run_program_.compile(command_queue_->commands());
+	std::vector<std::size_t> alternatives;
+	program_validator::result_t validation = validator_.await_result();
+	if (validation.outcomes) {
+		alternatives = try_find_failing_alternative(*puzzle_, *validation.outcomes);
+		worst_steps_ = validation.worst_steps;
+	} else {
+		/* empty program, observes no alternative */
+		alternatives = try_find_failing_alternative(puzzle_, &command_queue_->commands());
+		worst_steps_ = 1;
+	}
+
+	predictor_.cancel();
+	board_view_->set_ghost_path({}, false);
+
+	/* shown again once the run stops */
+	board_view_->set_failure_heatmap({});
+	command_queue_->set_tints({});
+	shown_failures_.reset();
+	shown_profile_.reset();
+
+	/* asked again once the run stops */
+	hints_.cancel();
+	command_queue_->clear_hint();
+	hint_requested_ = false;
+
+	trace_.record(
+		*puzzle_, command_queue_->commands(), run_program_,
+		alternatives, get_alternative_opacity(now, 0));
 
 	run_state_ = run_state_t::run1x;
 
@@ -951,7 +633,8 @@ run_controller::handle_stop()
 	command_queue_->set_locked(false);
 	command_tile_repository_->set_locked(false);
 	board_view_->reset(*puzzle_);
-	run_step_.reset();
+	trace_.clear();
+	seeking_ = false;
 }
 
 void
@@ -959,67 +642,11 @@ run_controller::reset(puzzle * puz)
 {
 	puzzle_ = puz;
 	handle_stop();
+	validator_.set_puzzle(*puz);
+	predictor_.set_puzzle(*puz);
+	hints_.set_puzzle(*puz);
+	set_hints_enabled(false);
+	validated_revision_ = command_queue_->revision();
+	validator_.validate(command_queue_->commands());
 	board_view_->reset(*puz);
 }
-
-int
-simulate_execution(const puzzle * puz, const command_sequence * commands, const std::vector<std::size_t> & alternatives)
-{
-	run_step_state state;
-	state.initialize(*puz, commands);
-
-	return simulate_execution(*puz, state, alternatives);
-}
-
-int
-simulate_execution(const puzzle & puz, run_step_state & state, const std::vector<std::size_t> & alternatives)
-{
-	int nsteps = 0;
-
-	std::unique_ptr<run_step> step = run_step::make_initial(puz, state, alternatives);
-	if (!step) {
-		return nsteps;
-	}
-
-	while (step) {
-		if (typeid(*step) == typeid(finish_goal_run_step)) {
-			return std::numeric_limits<int>::max();
-		} else if (typeid(*step) == typeid(finish_fail_run_step)) {
-			return nsteps;
-		} else if (typeid(*step) == typeid(drop_run_step)) {
-			return nsteps;
-		} else if (typeid(*step) == typeid(command_run_step) || typeid(*step) == typeid(setup_run_step)) {
-			step->step(state, step);
-			++nsteps;
-		} else {
-			step.reset();
-		}
-	}
-	return nsteps;
-}
-
-std::vector<std::size_t>
-try_find_failing_alternative(
-	const puzzle * puz,
-	const command_sequence * commands)
-{
-	std::size_t num_alternatives = 1 << (puz->alternative_tiles.size());
-
-	std::vector<std::size_t> best_alternative;
-	int best_score = -1;
-	std::vector<std::size_t> alternatives(puz->alternative_tiles.size());
-
-	std::size_t offset = static_cast<size_t>(random());
-	for (std::size_t n = 0; n < num_alternatives; ++n) {
-		for (std::size_t k = 0; k < alternatives.size(); ++k) {
-			alternatives[k] = !!((n + offset) & (1<<k));
-		}
-		int score = simulate_execution(puz, commands, alternatives);
-		if (best_score == -1 || score < best_score) {
-			best_alternative = alternatives;
-			best_score = score;
-		}
-	}
-
-	return best_alternative;
-}
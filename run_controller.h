@@ -1,339 +1,22 @@
 #ifndef RUN_CONTROLLER_H
 #define RUN_CONTROLLER_H
 
+#include <cstdint>
 #include <functional>
+#include <memory>
 
+#include "alternative_explorer.h"
 #include "board_view.h"
 #include "command_tile_owner.h"
 #include "command_queue.h"
 #include "command_tile_repository.h"
+#include "path_predictor.h"
+#include "hint_engine.h"
+#include "program_validator.h"
+#include "run_engine.h"
+#include "run_trace.h"
 #include "tiles.h"
 
-struct run_step_state {
-	struct tile_t {
-		bool has_floor = false;
-		int obstacle = -1;
-	};
-
-	using grid_t = grid_tpl<tile_t>;
-
-	const command_sequence * seq;
-
-	grid_t grid;
-	grid_pos_t goal;
-	grid_coord_t robot;
-	bool succeeded = false;
-
-	std::unordered_map<int, grid_pos_t> obstacles;
-
-	std::unordered_map<const command_tile *, int> branch_states;
-
-	std::map<int, std::pair<grid_pos_t, grid_pos_t>> trigger_floors;
-
-	void
-	set_obstacle(int index, grid_pos_t pos);
-
-	void
-	clear_obstacle(int index);
-
-	void
-	initialize(const puzzle & puz, const command_sequence * init_seq);
-};
-
-struct dropping_object {
-	view_coord_t start;
-	double vx, vy, vz;
-};
-
-struct falling_obstacle {
-	view_coord_t start;
-	double vx, vy, vz;
-	double start_time;
-};
-
-class run_step {
-public:
-	virtual
-	~run_step();
-
-	inline explicit run_step(double start_time) noexcept : start_time_(start_time) {}
-
-	virtual void
-	step(
-		run_step_state & state,
-		std::unique_ptr<run_step> & next_step) = 0;
-
-	virtual void
-	animate(
-		double delta_time,
-		board_view & bv) const = 0;
-
-	virtual void
-	end_animate(
-		board_view & bv) const = 0;
-
-	virtual double
-	animation_duration() const noexcept = 0;
-
-	inline double
-	start_time() const noexcept { return start_time_; }
-
-	inline double
-	end_time() const noexcept { return start_time_ + animation_duration(); }
-
-	static std::unique_ptr<run_step>
-	make_initial(
-		const puzzle & puz,
-		const run_step_state & state,
-		const std::vector<std::size_t> & alternatives);
-
-protected:
-	inline void set_start_time(double start_time) noexcept { start_time_ = start_time; }
-
-private:
-	double start_time_;
-};
-
-class setup_run_step final : public run_step {
-public:
-	~setup_run_step() override;
-
-	setup_run_step(
-		double start_time,
-		const puzzle & puz,
-		const std::vector<std::size_t> & alternatives);
-
-	void
-	step(
-		run_step_state & state,
-		std::unique_ptr<run_step> & next_step) override;
-
-	void
-	animate(
-		double delta_time,
-		board_view & bv) const override;
-
-	void
-	end_animate(
-		board_view & bv) const override;
-
-	double
-	animation_duration() const noexcept override;
-
-private:
-	struct floor_tile_goal_t {
-		grid_pos_t pos;
-		board_view::tile_color_t color;
-		bool present;
-		double start_state;
-	};
-
-	std::vector<floor_tile_goal_t> floor_tiles_;
-};
-
-class command_run_step final : public run_step {
-public:
-	~command_run_step() override;
-
-	command_run_step(
-		double start_time,
-		command_sequence_path current_command,
-		run_step_state & rs,
-		std::unordered_map<int, falling_obstacle> falling_obstacles);
-
-	void
-	step(
-		run_step_state & state,
-		std::unique_ptr<run_step> & next_step) override;
-
-	void
-	animate(
-		double delta_time,
-		board_view & bv) const override;
-
-	void
-	end_animate(
-		board_view & bv) const override;
-
-	double
-	animation_duration() const noexcept override;
-
-private:
-	void
-	begin_step(run_step_state & rs, int used_sub_steps);
-
-	grid_coord_t
-	compute_target_coord(grid_coord_t robot) const;
-
-	bool
-	check_floor_ahead(const run_step_state & state, grid_coord_t robot) const;
-
-	void
-	animate_branch_states() const;
-
-	void
-	animate_beam(board_view & bv, double delta_time) const;
-
-	void
-	advance_command(run_step_state & state);
-
-	/* path in program to current command */
-	command_sequence_path current_path_;
-	/* current command point in program */
-	command_point * current_command_;
-	/* If current command is a repetition, then this
-	 * is the number of repeats left (including the current
-	 * one). If current command is a conditional, then
-	 * this is the alternative to take.
-	 * Otherwise, this field is meaningless. */
-	std::size_t current_branch_state_;
-	/* Number of substep for current command. It is
-	 * always zero for every single step command.
-	 * It is used to count the number of steps for
-	 * "multi-step forward" operations */
-	int used_sub_steps_;
-
-	grid_coord_t robot_coord_origin_;
-	grid_coord_t robot_coord_target_;
-	bool will_drop_;
-
-	/* id of obstacle moved, if any; -1 if nothing moved */
-	int move_obstacle_;
-	grid_pos_t obstacle_pos_origin_;
-	grid_pos_t obstacle_pos_target_;
-	bool obstacle_will_drop_;
-
-	/* whether a trap will be closed as consequence of this move */
-	bool closes_trap_;
-	grid_pos_t closed_trap_;
-
-	/* obstacles currently in free-fall */
-	std::unordered_map<int, falling_obstacle> falling_obstacles_;
-};
-
-class drop_run_step final : public run_step {
-public:
-	~drop_run_step() override;
-
-	drop_run_step(
-		double start_time,
-		const run_step_state & rs,
-		dropping_object dropping_robot,
-		std::unordered_map<int, falling_obstacle> falling_obstacles);
-
-	void
-	step(
-		run_step_state & state,
-		std::unique_ptr<run_step> & next_step) override;
-
-	void
-	animate(
-		double delta_time,
-		board_view & bv) const override;
-
-	void
-	end_animate(
-		board_view & bv) const override;
-
-	double
-	animation_duration() const noexcept override;
-
-private:
-	dropping_object dropping_robot_;
-
-	/* obstacles currently in free-fall */
-	std::unordered_map<int, falling_obstacle> falling_obstacles_;
-};
-
-class finish_goal_run_step final : public run_step {
-public:
-	~finish_goal_run_step() override;
-
-	finish_goal_run_step(
-		double start_time,
-		grid_coord_t end_coord,
-		std::unordered_map<int, falling_obstacle> falling_obstacles);
-
-	void
-	step(
-		run_step_state & state,
-		std::unique_ptr<run_step> & next_step) override;
-
-	void
-	animate(
-		double delta_time,
-		board_view & bv) const override;
-
-	void
-	end_animate(
-		board_view & bv) const override;
-
-	double
-	animation_duration() const noexcept override;
-
-private:
-	grid_coord_t end_coord_;
-
-	/* obstacles currently in free-fall */
-	std::unordered_map<int, falling_obstacle> falling_obstacles_;
-};
-
-class finish_fail_run_step final : public run_step {
-public:
-	~finish_fail_run_step() override;
-
-	finish_fail_run_step(
-		double start_time,
-		std::unordered_map<int, falling_obstacle> falling_obstacles);
-
-	void
-	step(
-		run_step_state & state,
-		std::unique_ptr<run_step> & next_step) override;
-
-	void
-	animate(
-		double delta_time,
-		board_view & bv) const override;
-
-	void
-	end_animate(
-		board_view & bv) const override;
-
-	double
-	animation_duration() const noexcept override;
-private:
-
-	/* obstacles currently in free-fall */
-	std::unordered_map<int, falling_obstacle> falling_obstacles_;
-};
-
-/* Simulates execution, returns number of steps after which
- * program fails, or numeric_limits<int>::max() on success. */
-int
-simulate_execution(
-	const puzzle * puz,
-	const command_sequence * commands,
-	const std::vector<std::size_t> & alternatives);
-
-/* Simulates execution, returns number of steps after which
- * program fails, or numeric_limits<int>::max() on success. */
-int
-simulate_execution(
-	const puzzle & puz,
-	run_step_state & state,
-	const std::vector<std::size_t> & alternatives);
-
-/* Tests program execution against all alternatives. If
- * an alternative fails, then return the shortest
- * failing alternative. Otherwise, return any succeeding
- * one.
- * Note: function picks at random. Not deterministic. */
-std::vector<std::size_t>
-try_find_failing_alternative(
-	const puzzle * puz,
-	const command_sequence * commands);
-
 class run_controller final : public command_tile_owner {
 public:
 	run_controller(
@@ -349,7 +32,12 @@ public:
 		paused = 1,
 		run1x = 2,
 		run2x = 3,
-		run3x = 4
+		run3x = 4,
+		/* program steps at 8 times run3x, outcome at normal
+		 * speed */
+		turbo = 5,
+		/* program steps skipped, outcome at normal speed */
+		instant = 6
 	};
 
 	std::unique_ptr<command_tile_drag>
@@ -385,11 +73,23 @@ public:
 	void
 	handle_button_press(double x, double y, double now);
 
+	/* While the button pressed on the seek bar is held,
+	 * seek to where the pointer is. */
+	void
+	handle_pointer_motion(double x, double y, double now);
+
+	void
+	handle_button_release();
+
 	void
 	reset(puzzle * puz);
 
 	inline run_state_t run_state() const noexcept { return run_state_; }
 
+	/* Steps the program last started takes in the worst
+	 * case over all alternatives, not counting setup. */
+	inline int worst_steps() const noexcept { return worst_steps_ - 1; }
+
 private:
 	enum class button_state_t {
 		disabled = 0,
@@ -400,15 +100,56 @@ private:
 	void
 	animate_idle(double now);
 
+	void
+	update_prediction();
+
+	/* Show what validation found out about the program:
+	 * where runs fail, on the board and on its tiles, and
+	 * how often tiles execute (heat), crossing out those
+	 * never executed. */
+	void
+	update_analysis();
+
+	/* Keep hint shown in command queue up to date with the
+	 * program, if hints are enabled. */
+	void
+	update_hint();
+
+	void
+	set_hints_enabled(bool enabled);
+
 	void
 	draw_button(double x, double y, run_state_t kind, button_state_t state) const;
 
+	void
+	draw_validation(double x, double y) const;
+
+	void
+	draw_hint_button(double x, double y) const;
+
+	/* Bar below the buttons showing how far the run has
+	 * progressed; pressing it seeks. */
+	void
+	draw_seek_bar(double global_phase) const;
+
+	/* Seek to the time on the seek bar at x. */
+	void
+	seek_to_bar(double x, double now);
+
 	button_state_t
 	get_button_state(run_state_t kind) const;
 
+	/* Animation seconds per wall clock second. */
+	double
+	get_clock_speed() const;
+
 	double
 	get_current_animation_clock(double now) const;
 
+	/* Continue run from given time. */
+	void
+	seek(double time, double now);
+
 	run_state_t run_state_;
 
 	puzzle * puzzle_;
@@ -420,8 +161,37 @@ private:
 	double wall_clock_base_;
 	double animation_clock_base_;
 
-	run_step_state run_step_state_;
-	std::unique_ptr<run_step> run_step_;
+	/* program last started, and steps it takes in the
+	 * worst case, counting setup */
+	command_program run_program_;
+	int worst_steps_ = 1;
+	/* run in progress, recorded when started */
+	run_trace trace_;
+	/* whether the button was pressed on the seek bar and is
+	 * still held */
+	bool seeking_ = false;
+
+	program_validator validator_;
+	/* revision of command queue last sent for validation */
+	std::uint64_t validated_revision_ = 0;
+	/* failures and profile shown, null if none */
+	std::shared_ptr<const failure_heatmap> shown_failures_;
+	std::shared_ptr<const execution_profile> shown_profile_;
+
+	path_predictor predictor_;
+	/* hover revision of command queue last sent for
+	 * prediction, and latest prediction shown */
+	std::uint64_t predicted_hover_revision_ = 0;
+	path_predictor::result_t prediction_;
+
+	hint_engine hints_;
+	bool hints_enabled_ = false;
+	/* whether a hint was requested for the program at
+	 * hinted_revision_ of the command queue, and whether
+	 * its result is shown */
+	bool hint_requested_ = false;
+	std::uint64_t hinted_revision_ = 0;
+	bool hint_shown_ = false;
 
 	bounds_t bounds_;
 
@@ -0,0 +1,623 @@
+#include "run_engine.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <type_traits>
+
+#include "alternative_explorer.h"
+
+constexpr int run_step_state::repeat_not_started;
+constexpr int run_step_state::max_board_size;
+constexpr std::size_t run_step_state::max_cells;
+constexpr std::size_t run_step_state::max_obstacles;
+constexpr std::size_t run_step_state::max_triggers;
+constexpr std::size_t run_step_state::max_loops;
+
+static_assert(std::is_trivially_copyable<run_step_state>::value, "run state must be copyable by memcpy");
+
+namespace {
+
+enum class hash_kind_t : std::uint64_t {
+	floor = 1,
+	obstacle = 2,
+	loop = 3,
+	robot = 4,
+	direction = 5,
+	program = 6
+};
+
+/* Random looking key for every item of state; computed by
+ * mixing (splitmix64 finalizer) rather than taken from a
+ * table, as the value ranges are large. */
+inline std::uint64_t
+zobrist_key(hash_kind_t kind, std::uint32_t a, std::uint32_t b) noexcept
+{
+	std::uint64_t x = (static_cast<std::uint64_t>(kind) << 56) ^ (std::uint64_t(a) << 32) ^ b;
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ull;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebull;
+	x ^= x >> 31;
+	return x;
+}
+
+/* Bounds of every cell that can have floor or an obstacle
+ * at some point. */
+void
+board_bounds(const puzzle & puz, grid_pos_t & min, grid_pos_t & max)
+{
+	min = puz.start.pos;
+	max = puz.start.pos;
+	auto extend = [&min, &max](grid_pos_t pos)
+	{
+		min.x = std::min(min.x, pos.x);
+		min.y = std::min(min.y, pos.y);
+		max.x = std::max(max.x, pos.x);
+		max.y = std::max(max.y, pos.y);
+	};
+	extend(puz.end);
+	puz.grid.iterate([&extend](int x, int y, floor_tile_t) { extend(grid_pos_t{x, y}); });
+	for (const auto & pos : puz.obstacles) {
+		extend(pos);
+	}
+	for (const auto & alternative : puz.alternative_tiles) {
+		extend(alternative.first);
+		extend(alternative.second);
+	}
+}
+
+}
+
+const char *
+run_step_state::exceeded_limit(const puzzle & puz)
+{
+	grid_pos_t min, max;
+	board_bounds(puz, min, max);
+	if (max.x - min.x >= max_board_size || max.y - min.y >= max_board_size) {
+		return "board too large";
+	}
+	if (puz.obstacles.size() > max_obstacles) {
+		return "too many obstacles";
+	}
+	std::size_t num_triggers = 0;
+	puz.grid.iterate([&num_triggers](int, int, floor_tile_t tile) { num_triggers += tile.trigger_id > 0; });
+	if (num_triggers > max_triggers) {
+		return "too many triggers";
+	}
+	std::size_t num_repeats = 0;
+	for (const auto & tile : puz.tiles) {
+		num_repeats += command_tile(tile.first, 0.).is_repeat() ? tile.second : 0;
+	}
+	if (num_repeats > max_loops) {
+		return "too many repeat tiles";
+	}
+	return nullptr;
+}
+
+void
+run_step_state::set_cell(int index, cell_t c) noexcept
+{
+	cell_t old = cells_[index];
+	cell_t changed = (old ^ c) & (floor_bit | obstacle_bits);
+	if (changed & floor_bit) {
+		board_hash_ ^= zobrist_key(hash_kind_t::floor, index, 0);
+	}
+	if (changed & obstacle_bits) {
+		if (cell_obstacle(old) != -1) {
+			board_hash_ ^= zobrist_key(hash_kind_t::obstacle, index, cell_obstacle(old));
+		}
+		if (cell_obstacle(c) != -1) {
+			board_hash_ ^= zobrist_key(hash_kind_t::obstacle, index, cell_obstacle(c));
+		}
+	}
+	cells_[index] = c;
+}
+
+void
+run_step_state::set_loop_counter(std::size_t loop, int value) noexcept
+{
+	/* counters of loops not entered do not contribute */
+	int & counter = loop_counters_[loop];
+	if (counter != repeat_not_started) {
+		loops_hash_ ^= zobrist_key(hash_kind_t::loop, loop, counter);
+	}
+	if (value != repeat_not_started) {
+		loops_hash_ ^= zobrist_key(hash_kind_t::loop, loop, value);
+	}
+	counter = value;
+}
+
+std::uint64_t
+run_step_state::hash() const noexcept
+{
+	return board_hash() ^ loops_hash_ ^ zobrist_key(hash_kind_t::program, pc_, next_sub_step_);
+}
+
+std::uint64_t
+run_step_state::board_hash() const noexcept
+{
+	return board_hash_
+		^ zobrist_key(hash_kind_t::robot, robot.pos.x, robot.pos.y)
+		^ zobrist_key(hash_kind_t::direction, static_cast<int>(robot.dir.angle()), 0);
+}
+
+void
+run_step_state::set_obstacle(int index, grid_pos_t pos)
+{
+	int from = obstacles_[index];
+	if (from >= 0 && cell_obstacle(cells_[from]) == index) {
+		set_cell(from, cells_[from] & ~obstacle_bits);
+	}
+	int to = cell_index(pos.x, pos.y);
+	obstacles_[index] = to;
+	set_cell(to, (cells_[to] & ~obstacle_bits) | cell_t((index + 1) << obstacle_shift));
+}
+
+void
+run_step_state::clear_obstacle(int index)
+{
+	int from = obstacles_[index];
+	if (from >= 0 && cell_obstacle(cells_[from]) == index) {
+		set_cell(from, cells_[from] & ~obstacle_bits);
+	}
+	obstacles_[index] = -1;
+}
+
+run_step_state::tile_t
+run_step_state::tile(grid_pos_t pos) const noexcept
+{
+	cell_t c = cell(pos.x, pos.y);
+	tile_t tile;
+	tile.has_floor = c & floor_bit;
+	tile.obstacle = cell_obstacle(c);
+	return tile;
+}
+
+void
+run_step_state::set_tile(grid_pos_t pos, const tile_t & tile) noexcept
+{
+	int index = cell_index(pos.x, pos.y);
+	cell_t c = cells_[index] & ~(floor_bit | obstacle_bits);
+	c |= (tile.has_floor ? floor_bit : 0) | cell_t((tile.obstacle + 1) << obstacle_shift);
+	set_cell(index, c);
+}
+
+void
+run_step_state::set_floor(grid_pos_t pos) noexcept
+{
+	int index = cell_index(pos.x, pos.y);
+	set_cell(index, cells_[index] | floor_bit);
+}
+
+void
+run_step_state::erase(grid_pos_t pos) noexcept
+{
+	int index = cell_index(pos.x, pos.y);
+	if (index >= 0) {
+		set_cell(index, cells_[index] & ~(floor_bit | obstacle_bits));
+	}
+}
+
+bool
+run_step_state::is_trap(grid_pos_t pos) const noexcept
+{
+	return cell(pos.x, pos.y) & trap_bit;
+}
+
+void
+run_step_state::initialize(const puzzle & puz, const command_program * init_program)
+{
+	program = init_program;
+	robot.pos = puz.start.pos;
+	robot.dir = puz.start.dir;
+	goal = puz.end;
+
+	/* puzzles are checked when parsed, see
+	 * exceeded_limit */
+	grid_pos_t min, max;
+	board_bounds(puz, min, max);
+	assert(max.x - min.x < max_board_size && max.y - min.y < max_board_size);
+	assert(puz.obstacles.size() <= max_obstacles);
+	assert(!program || program->num_loops() <= max_loops);
+	origin_ = min;
+	width_ = max.x - min.x + 1;
+	height_ = max.y - min.y + 1;
+	std::fill(cells_, cells_ + width_ * height_, 0);
+	std::fill(loop_counters_, loop_counters_ + max_loops, repeat_not_started);
+	board_hash_ = 0;
+	loops_hash_ = 0;
+
+	/* triggers are numbered by puzzle, find the trap door
+	 * of every one of them and give it a slot */
+	std::map<int, std::pair<int, int>> trigger_cells;
+	puz.grid.iterate([this, &trigger_cells](int x, int y, floor_tile_t tile)
+	{
+		int index = cell_index(x, y);
+		if (tile.trigger_id >= 0) {
+			set_cell(index, cells_[index] | floor_bit);
+		}
+		if (tile.trigger_id > 0) {
+			trigger_cells.emplace(tile.trigger_id, std::make_pair(-1, -1)).first->second.first = index;
+		}
+		if (tile.trigger_id < 0) {
+			cells_[index] |= trap_bit;
+			trigger_cells.emplace(-tile.trigger_id, std::make_pair(-1, -1)).first->second.second = index;
+		}
+	});
+	std::size_t num_triggers = 0;
+	for (const auto & trigger : trigger_cells) {
+		if (trigger.second.first >= 0 && trigger.second.second >= 0) {
+			assert(num_triggers < max_triggers);
+			triggers_[num_triggers] = trigger.second.second;
+			cells_[trigger.second.first] |= cell_t((num_triggers + 1) << trigger_shift);
+			++num_triggers;
+		}
+	}
+
+	std::fill(obstacles_, obstacles_ + max_obstacles, -1);
+	for (std::size_t index = 0; index < puz.obstacles.size(); ++index) {
+		set_obstacle(index, puz.obstacles[index]);
+	}
+
+	pc_ = 0;
+	furthest_pc_ = 0;
+}
+
+void
+run_step_state::change_program(const command_program * new_program) noexcept
+{
+	/* loops added or removed by the change are all after
+	 * the instructions examined so far, and not entered */
+	for (std::size_t n = new_program->num_loops(); n < max_loops; ++n) {
+		set_loop_counter(n, repeat_not_started);
+	}
+	program = new_program;
+}
+
+void
+run_step_state::apply_alternatives(const puzzle & puz, const std::vector<std::size_t> & alternatives)
+{
+	for (std::size_t n = 0; n < puz.alternative_tiles.size(); ++n) {
+		std::size_t option = n >= alternatives.size() ? 0 : alternatives[n];
+		const grid_pos_t & first = puz.alternative_tiles[n].first;
+		const grid_pos_t & second = puz.alternative_tiles[n].second;
+		if (option == 0) {
+			set_floor(first);
+			erase(second);
+		} else {
+			erase(first);
+			set_floor(second);
+		}
+	}
+}
+
+bool
+run_step_state::start_program()
+{
+	if (!enter_program()) {
+		return false;
+	}
+
+	begin_step();
+	return true;
+}
+
+run_step_state::step_result_t
+run_step_state::complete_step()
+{
+	step_result_t result = finish_step();
+	if (result == step_result_t::running) {
+		begin_step();
+	}
+	return result;
+}
+
+bool
+run_step_state::enter_program()
+{
+	pc_ = 0;
+	next_sub_step_ = 0;
+	furthest_pc_ = 0;
+	advance_command();
+	return (*program)[pc_].op != command_instruction::opcode_t::end;
+}
+
+run_step_state::step_result_t
+run_step_state::finish_step()
+{
+	const run_step_info & info = current_step_;
+	if (info.will_drop) {
+		return step_result_t::dropped;
+	}
+
+	robot = info.robot_target;
+
+	if (info.move_obstacle != -1) {
+		if (!info.obstacle_will_drop) {
+			set_obstacle(info.move_obstacle, info.obstacle_target);
+		} else {
+			clear_obstacle(info.move_obstacle);
+		}
+	}
+
+	if (info.closes_trap) {
+		set_floor(info.closed_trap);
+	}
+
+	if (robot.pos == goal) {
+		return step_result_t::reached_goal;
+	}
+
+	const command_instruction & instr = (*program)[pc_];
+	if (instr.op != command_instruction::opcode_t::forward || info.used_sub_steps + 1 >= instr.count) {
+		if (instr.op == command_instruction::opcode_t::conditional && info.branch_state != 0) {
+			pc_ = instr.target;
+		} else {
+			++pc_;
+		}
+		advance_command();
+		if ((*program)[pc_].op == command_instruction::opcode_t::end) {
+			return step_result_t::program_end;
+		}
+		next_sub_step_ = 0;
+	} else {
+		next_sub_step_ = info.used_sub_steps + 1;
+	}
+
+	return step_result_t::running;
+}
+
+std::size_t
+run_step_state::next_step_reads(grid_pos_t cells[2]) const
+{
+	grid_coord_t target = compute_target_coord(robot);
+	std::size_t count = 0;
+	cells[count++] = target.pos;
+
+	/* either the cell an obstacle is pushed to, or the cell
+	 * inspected by a conditional; both are the cell ahead,
+	 * as conditionals do not turn */
+	if (cell_obstacle(cell(target.pos.x, target.pos.y)) != -1 || (*program)[pc_].op == command_instruction::opcode_t::conditional) {
+		grid_vec_t v = robot.dir.vec();
+		cells[count++] = grid_pos_t{target.pos.x + v.dx, target.pos.y + v.dy};
+	}
+
+	return count;
+}
+
+void
+run_step_state::advance_command()
+{
+	/* skip over control flow to the next instruction that
+	 * takes a step */
+	for (;;) {
+		furthest_pc_ = std::max(furthest_pc_, pc_);
+		const command_instruction & instr = (*program)[pc_];
+		switch (instr.op) {
+			case command_instruction::opcode_t::jump: {
+				pc_ = instr.target;
+				break;
+			}
+			case command_instruction::opcode_t::loop_end: {
+				if (loop_counters_[instr.loop] != 0) {
+					pc_ = instr.target;
+					return;
+				}
+				++pc_;
+				break;
+			}
+			default: {
+				return;
+			}
+		}
+	}
+}
+
+void
+run_step_state::begin_step()
+{
+	run_step_info & info = current_step_;
+
+	info.used_sub_steps = next_sub_step_;
+	info.robot_origin = robot;
+	info.robot_target = compute_target_coord(info.robot_origin);
+	cell_t target = cell(info.robot_target.pos.x, info.robot_target.pos.y);
+	info.will_drop = !(target & floor_bit);
+	info.closes_trap = false;
+
+	info.move_obstacle = cell_obstacle(target);
+	if (info.move_obstacle != -1) {
+		info.obstacle_origin = info.robot_target.pos;
+		info.obstacle_target = info.obstacle_origin;
+		grid_vec_t v = robot.dir.vec();
+		info.obstacle_target.x += v.dx;
+		info.obstacle_target.y += v.dy;
+
+		cell_t o_target = cell(info.obstacle_target.x, info.obstacle_target.y);
+		info.obstacle_will_drop = !(o_target & floor_bit);
+
+		if (!info.obstacle_will_drop && cell_obstacle(o_target) != -1) {
+			info.robot_target = info.robot_origin;
+			info.move_obstacle = -1;
+		}
+
+		int trigger = (o_target >> trigger_shift) & slot_mask;
+		if (trigger) {
+			info.closed_trap = cell_pos(triggers_[trigger - 1]);
+			info.closes_trap = true;
+		}
+	}
+
+	const command_instruction & instr = (*program)[pc_];
+	if (instr.op == command_instruction::opcode_t::repeat) {
+		for (std::size_t n = instr.loop + 1; n < instr.nested_loops_end; ++n) {
+			set_loop_counter(n, repeat_not_started);
+		}
+		int repetitions_left = loop_counters_[instr.loop];
+		if (repetitions_left == repeat_not_started) {
+			repetitions_left = instr.count;
+		}
+		info.branch_state = repetitions_left;
+		set_loop_counter(instr.loop, repetitions_left - 1);
+	} else if (instr.op == command_instruction::opcode_t::conditional) {
+		info.branch_state = check_floor_ahead(info.robot_target) ? 0 : 1;
+	}
+}
+
+grid_coord_t
+run_step_state::compute_target_coord(grid_coord_t robot) const
+{
+	switch ((*program)[pc_].op) {
+		case command_instruction::opcode_t::left: {
+			robot.dir = robot.dir.left();
+			break;
+		}
+		case command_instruction::opcode_t::right: {
+			robot.dir = robot.dir.right();
+			break;
+		}
+		case command_instruction::opcode_t::forward: {
+			grid_vec_t v = robot.dir.vec();
+			robot.pos.x += v.dx;
+			robot.pos.y += v.dy;
+			break;
+		}
+		default: {
+			break;
+		}
+	}
+
+	return robot;
+}
+
+bool
+run_step_state::check_floor_ahead(grid_coord_t robot) const
+{
+	grid_vec_t v = robot.dir.vec();
+	robot.pos.x += v.dx;
+	robot.pos.y += v.dy;
+	return cell(robot.pos.x, robot.pos.y) & floor_bit;
+}
+
+void
+get_alternative_assignment(
+	const puzzle & puz,
+	std::size_t bits,
+	std::vector<std::size_t> & alternatives)
+{
+	alternatives.resize(puz.alternative_tiles.size());
+	for (std::size_t k = 0; k < alternatives.size(); ++k) {
+		alternatives[k] = (bits >> k) & 1;
+	}
+}
+
+int
+simulate_execution(
+	const puzzle * puz,
+	const command_sequence * commands,
+	const std::vector<std::size_t> & alternatives,
+	bool stop_hopeless)
+{
+	command_program program;
+	program.compile(*commands);
+
+	run_step_state state;
+	state.initialize(*puz, &program);
+
+	return simulate_execution(*puz, state, alternatives, stop_hopeless);
+}
+
+int
+simulate_execution(
+	const puzzle & puz,
+	run_step_state & state,
+	const std::vector<std::size_t> & alternatives,
+	bool stop_hopeless)
+{
+	simulation_result result = run_simulation(puz, state, alternatives, stop_hopeless);
+	return result.succeeded() ? std::numeric_limits<int>::max() : result.steps;
+}
+
+simulation_result
+run_simulation(
+	const puzzle & puz,
+	run_step_state & state,
+	const std::vector<std::size_t> & alternatives,
+	bool stop_hopeless,
+	int max_steps)
+{
+	simulation_result result;
+	/* setting up alternatives counts as first step */
+	result.steps = 1;
+
+	state.apply_alternatives(puz, alternatives);
+	if (!state.start_program()) {
+		result.outcome = simulation_result::outcome_t::program_end;
+		return result;
+	}
+
+	for (;;) {
+		++result.steps;
+		switch (state.complete_step()) {
+			case run_step_state::step_result_t::running: {
+				if (stop_hopeless && puz.distances.hopeless(state)) {
+					result.outcome = simulation_result::outcome_t::hopeless;
+					return result;
+				}
+				if (result.steps >= max_steps) {
+					result.outcome = simulation_result::outcome_t::step_limit;
+					return result;
+				}
+				break;
+			}
+			case run_step_state::step_result_t::reached_goal: {
+				result.outcome = simulation_result::outcome_t::reached_goal;
+				return result;
+			}
+			case run_step_state::step_result_t::dropped: {
+				result.outcome = simulation_result::outcome_t::dropped;
+				return result;
+			}
+			case run_step_state::step_result_t::program_end: {
+				result.outcome = simulation_result::outcome_t::program_end;
+				return result;
+			}
+		}
+	}
+}
+
+std::vector<std::size_t>
+try_find_failing_alternative(
+	const puzzle * puz,
+	const command_sequence * commands)
+{
+	command_program program;
+	program.compile(*commands);
+
+	alternative_outcomes outcomes;
+	explore_alternatives(*puz, program, outcomes);
+
+	return try_find_failing_alternative(*puz, outcomes);
+}
+
+std::vector<std::size_t>
+try_find_failing_alternative(
+	const puzzle & puz,
+	const alternative_outcomes & outcomes)
+{
+	/* Follow decisions towards lowest score, choosing at
+	 * random where both options lead there. Pairs not
+	 * decided along the path do not matter and are chosen
+	 * at random as well. */
+	std::vector<std::size_t> alternatives(puz.alternative_tiles.size());
+	for (auto & option : alternatives) {
+		option = random() & 1;
+	}
+
+	outcomes.lowest_assignment(alternatives);
+
+	return alternatives;
+}
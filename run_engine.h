@@ -0,0 +1,370 @@
+#ifndef RUN_ENGINE_H
+#define RUN_ENGINE_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "command_program.h"
+#include "grid.h"
+#include "puzzle.h"
+#include "tiles.h"
+
+class alternative_outcomes;
+
+/* Everything that is known about a single execution step
+ * once it has begun: where robot and obstacles move to,
+ * and whether anything falls off the board. This is all
+ * that is needed to animate the step. */
+struct run_step_info {
+	grid_coord_t robot_origin;
+	grid_coord_t robot_target;
+	bool will_drop = false;
+
+	/* id of obstacle moved, if any; -1 if nothing moved */
+	int move_obstacle = -1;
+	grid_pos_t obstacle_origin;
+	grid_pos_t obstacle_target;
+	bool obstacle_will_drop = false;
+
+	/* whether a trap will be closed as consequence of this move */
+	bool closes_trap = false;
+	grid_pos_t closed_trap;
+
+	/* If current command is a repetition, then this
+	 * is the number of repeats left (including the current
+	 * one). If current command is a conditional, then
+	 * this is the alternative to take.
+	 * Otherwise, this field is meaningless. */
+	int branch_state = 0;
+
+	/* Number of substep for current command. It is
+	 * always zero for every single step command.
+	 * It is used to count the number of steps for
+	 * "multi-step forward" operations */
+	int used_sub_steps = 0;
+};
+
+/* Headless execution engine: holds the board and program
+ * state of a run, and implements the game rules. It is
+ * shared by the animated run (see run_controller) and
+ * by simulate_execution. Once initialized, stepping
+ * through a program performs no heap allocation.
+ *
+ * The board is a bounded flat array of cells covering the
+ * puzzle, and all state lives in fixed size arrays, so
+ * copying a state (to fork or checkpoint a run) is a single
+ * memcpy. Cells outside the bounds have no floor.
+ *
+ * A Zobrist style hash of the state is kept up to date
+ * while stepping, to recognize identical states (see
+ * transposition_table). */
+struct run_step_state {
+	/* contents of a single cell */
+	struct tile_t {
+		bool has_floor = false;
+		int obstacle = -1;
+	};
+
+	enum class step_result_t {
+		/* next step has begun */
+		running = 0,
+		/* robot has stepped off the board */
+		dropped = 1,
+		/* robot has reached the goal */
+		reached_goal = 2,
+		/* end of program reached without reaching goal */
+		program_end = 3
+	};
+
+	/* marks repetition counters of loops not currently entered */
+	static constexpr int repeat_not_started = -0x7fffffff;
+
+	/* capacity limits; puzzles and programs must fit */
+	static constexpr int max_board_size = 32;
+	static constexpr std::size_t max_cells = max_board_size * max_board_size;
+	static constexpr std::size_t max_obstacles = 31;
+	static constexpr std::size_t max_triggers = 31;
+	static constexpr std::size_t max_loops = command_program::max_loops;
+
+	/* Limit of given puzzle that is exceeded, nullptr if it
+	 * fits: its board, obstacles and triggers, and programs
+	 * using all the repeats it provides. */
+	static const char *
+	exceeded_limit(const puzzle & puz);
+
+	const command_program * program;
+
+	grid_pos_t goal;
+	grid_coord_t robot;
+	bool succeeded = false;
+
+	void
+	set_obstacle(int index, grid_pos_t pos);
+
+	void
+	clear_obstacle(int index);
+
+	/* Contents of cell at given position. */
+	tile_t
+	tile(grid_pos_t pos) const noexcept;
+
+	/* Replace contents of cell, position must be on the
+	 * board. Only the cell changes, obstacle positions are
+	 * left as they are. */
+	void
+	set_tile(grid_pos_t pos, const tile_t & tile) noexcept;
+
+	/* Put floor into cell, position must be on the board. */
+	void
+	set_floor(grid_pos_t pos) noexcept;
+
+	/* Remove floor and obstacle from cell. */
+	void
+	erase(grid_pos_t pos) noexcept;
+
+	/* Whether cell is a trap door (closed or not). */
+	bool
+	is_trap(grid_pos_t pos) const noexcept;
+
+	void
+	initialize(const puzzle & puz, const command_program * init_program);
+
+	/* Switch to a program that only differs from the current
+	 * one after the instructions examined so far, see
+	 * furthest_pc. Loops not entered keep their counters. */
+	void
+	change_program(const command_program * new_program) noexcept;
+
+	/* Put one tile of every alternative pair into place. */
+	void
+	apply_alternatives(const puzzle & puz, const std::vector<std::size_t> & alternatives);
+
+	/* Position at first command of program and begin its first
+	 * step. Returns false if program is empty. */
+	bool
+	start_program();
+
+	/* Complete the step that is currently in progress, and
+	 * begin the next one (if any). */
+	step_result_t
+	complete_step();
+
+	/* The following split complete_step into its parts, for
+	 * callers that need to intervene between finishing one
+	 * step and beginning the next. */
+
+	/* Position at first command of program without beginning
+	 * its step. Returns false if program is empty. */
+	bool
+	enter_program();
+
+	/* Complete the step that is currently in progress, and
+	 * position at the next one (without beginning it). */
+	step_result_t
+	finish_step();
+
+	/* Begin step at current position. */
+	void
+	begin_step();
+
+	/* Cells whose floor is going to be inspected when
+	 * beginning next step; returns number of cells. */
+	std::size_t
+	next_step_reads(grid_pos_t cells[2]) const;
+
+	/* Command whose step is currently in progress, and the
+	 * instruction it was compiled to. */
+	inline command_point *
+	current_command() const noexcept { return program->point(pc_); }
+
+	inline std::size_t
+	pc() const noexcept { return pc_; }
+
+	/* Step currently in progress. */
+	inline const run_step_info &
+	current_step() const noexcept { return current_step_; }
+
+	/* Highest program counter examined since entering the
+	 * program. Execution so far only depends on instructions
+	 * up to and including this one. */
+	inline std::size_t
+	furthest_pc() const noexcept { return furthest_pc_; }
+
+	/* Repetitions left for given loop, indexed by loop
+	 * counter index. */
+	inline int
+	loop_counter(std::size_t loop) const noexcept { return loop_counters_[loop]; }
+
+	/* Hash of robot position and direction, program
+	 * position, loop counters, floor and obstacles. States
+	 * that will behave identically from here on have equal
+	 * hashes, if both are taken at the same point (e.g. after
+	 * finish_step). Which obstacle is where is included, so
+	 * swapping two obstacles changes the hash. */
+	std::uint64_t
+	hash() const noexcept;
+
+	/* Hash of robot, floor and obstacles only, leaving out
+	 * where the program is. */
+	std::uint64_t
+	board_hash() const noexcept;
+
+private:
+	using cell_t = std::uint16_t;
+
+	/* cell layout: floor bit, trap bit, then obstacle and
+	 * trigger slots plus one (zero for none) */
+	static constexpr cell_t floor_bit = 1 << 0;
+	static constexpr cell_t trap_bit = 1 << 1;
+	static constexpr int obstacle_shift = 2;
+	static constexpr int trigger_shift = 7;
+	static constexpr cell_t slot_mask = 31;
+	static constexpr cell_t obstacle_bits = slot_mask << obstacle_shift;
+
+	/* index of cell at position, -1 if off the board */
+	inline int
+	cell_index(int x, int y) const noexcept
+	{
+		unsigned int dx = x - origin_.x;
+		unsigned int dy = y - origin_.y;
+		return dx < width_ && dy < height_ ? int(dy * width_ + dx) : -1;
+	}
+
+	inline cell_t
+	cell(int x, int y) const noexcept
+	{
+		int index = cell_index(x, y);
+		return index < 0 ? 0 : cells_[index];
+	}
+
+	inline grid_pos_t
+	cell_pos(int index) const noexcept
+	{
+		return grid_pos_t{origin_.x + int(index % width_), origin_.y + int(index / width_)};
+	}
+
+	static inline int
+	cell_obstacle(cell_t c) noexcept
+	{
+		return int((c >> obstacle_shift) & slot_mask) - 1;
+	}
+
+	/* Change cell / loop counter and update hash. */
+	void
+	set_cell(int index, cell_t c) noexcept;
+
+	void
+	set_loop_counter(std::size_t loop, int value) noexcept;
+
+	grid_coord_t
+	compute_target_coord(grid_coord_t robot) const;
+
+	bool
+	check_floor_ahead(grid_coord_t robot) const;
+
+	void
+	advance_command();
+
+	/* program counter of current command */
+	std::size_t pc_ = 0;
+	/* sub-step of current command to begin next */
+	int next_sub_step_ = 0;
+	std::size_t furthest_pc_ = 0;
+	run_step_info current_step_;
+
+	/* position of first cell, and board dimensions */
+	grid_pos_t origin_ = {0, 0};
+	unsigned int width_ = 0, height_ = 0;
+	cell_t cells_[max_cells];
+	/* cell index of every obstacle, -1 once dropped */
+	std::int16_t obstacles_[max_obstacles];
+	/* cell index of the trap closed by every trigger */
+	std::int16_t triggers_[max_triggers];
+	/* repetitions left for every loop in program; unused
+	 * entries are always repeat_not_started */
+	int loop_counters_[max_loops];
+	/* hashes of cells and of loop counters */
+	std::uint64_t board_hash_ = 0;
+	std::uint64_t loops_hash_ = 0;
+};
+
+/* Decode alternative assignment from bit mask: bit k
+ * selects tile of alternative pair k. */
+void
+get_alternative_assignment(
+	const puzzle & puz,
+	std::size_t bits,
+	std::vector<std::size_t> & alternatives);
+
+/* How a simulated run ended, and after how many steps
+ * (setting up alternatives counting as the first). */
+struct simulation_result {
+	enum class outcome_t : std::uint8_t {
+		reached_goal = 0,
+		dropped = 1,
+		program_end = 2,
+		/* robot can no longer reach the goal, see
+		 * stop_hopeless */
+		hopeless = 3,
+		/* max_steps taken without any of the above */
+		step_limit = 4
+	};
+
+	outcome_t outcome = outcome_t::program_end;
+	int steps = 0;
+
+	inline bool
+	succeeded() const noexcept { return outcome == outcome_t::reached_goal; }
+};
+
+/* Simulates execution of program state was initialized
+ * with, see simulate_execution below. Stops after max_steps
+ * steps, which programs looping forever (rep0) need. */
+simulation_result
+run_simulation(
+	const puzzle & puz,
+	run_step_state & state,
+	const std::vector<std::size_t> & alternatives,
+	bool stop_hopeless = false,
+	int max_steps = std::numeric_limits<int>::max());
+
+/* Simulates execution, returns number of steps after which
+ * program fails, or numeric_limits<int>::max() on success.
+ * With stop_hopeless, the run fails as soon as the robot
+ * cannot reach the goal any more (see goal_distance),
+ * rather than when it drops or the program ends; success
+ * or failure is the same, but the count is lower. */
+int
+simulate_execution(
+	const puzzle * puz,
+	const command_sequence * commands,
+	const std::vector<std::size_t> & alternatives,
+	bool stop_hopeless = false);
+
+int
+simulate_execution(
+	const puzzle & puz,
+	run_step_state & state,
+	const std::vector<std::size_t> & alternatives,
+	bool stop_hopeless = false);
+
+/* Tests program execution against all alternatives. If
+ * an alternative fails, then return the shortest
+ * failing alternative. Otherwise, return any succeeding
+ * one. Alternatives are only forked where the program
+ * observes them, see explore_alternatives.
+ * Note: function picks at random. Not deterministic. */
+std::vector<std::size_t>
+try_find_failing_alternative(
+	const puzzle * puz,
+	const command_sequence * commands);
+
+/* As above, but picks from outcomes of an exploration
+ * that has already been carried out. */
+std::vector<std::size_t>
+try_find_failing_alternative(
+	const puzzle & puz,
+	const alternative_outcomes & outcomes);
+
+#endif
@@ -0,0 +1,392 @@
+#include "run_trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+constexpr std::size_t run_trace::keyframe_interval;
+constexpr std::size_t run_trace::max_steps;
+
+namespace {
+
+view_coord_t
+to_view_coord(const grid_coord_t & coord)
+{
+	view_coord_t  result;
+	result.x = coord.pos.x;
+	result.y = coord.pos.y;
+	result.z = 0.;
+	result.angle = coord.dir.angle();
+	result.tilt = 0.;
+	return result;
+}
+
+}
+
+void
+run_trace::record(
+	const puzzle & puz,
+	const command_sequence & commands,
+	const command_program & program,
+	const std::vector<std::size_t> & alternatives,
+	double idle_opacity)
+{
+	clear();
+
+	add_points(commands);
+	std::unordered_map<const command_point *, std::uint16_t> point_index;
+	for (std::size_t n = 0; n < points_.size(); ++n) {
+		point_index[points_[n].cpt] = n;
+	}
+
+	for (std::size_t n = 0; n < puz.alternative_tiles.size(); ++n) {
+		std::size_t option = n >= alternatives.size() ? 0 : alternatives[n];
+
+		floor_tiles_.push_back({
+			puz.alternative_tiles[n].first,
+			board_view::get_alternative_tile_color(n),
+			(option == 0),
+			idle_opacity
+		});
+
+		floor_tiles_.push_back({
+			puz.alternative_tiles[n].second,
+			board_view::get_alternative_tile_color(n),
+			(option == 1),
+			1 - idle_opacity
+		});
+	}
+
+	/* execute the program */
+	run_step_state state;
+	state.initialize(puz, &program);
+
+	double time = floor_tiles_.empty() ? 0.0 : 1.0;
+	steps_.push_back({step_kind_t::setup, 0, 0.0, time, run_step_info()});
+
+	state.apply_alternatives(puz, alternatives);
+	if (state.start_program()) {
+		for (;;) {
+			const run_step_info & info = state.current_step();
+			step_t step = {
+				step_kind_t::command,
+				point_index[state.current_command()],
+				time,
+				info.will_drop ? 0.5 : 1.0,
+				info
+			};
+			steps_.push_back(step);
+
+			if (info.move_obstacle != -1 && info.obstacle_will_drop) {
+				const grid_coord_t & origin = info.robot_origin;
+				const grid_coord_t & target = info.robot_target;
+				double x = .5 * (info.obstacle_origin.x + info.obstacle_target.x);
+				double y = .5 * (info.obstacle_origin.y + info.obstacle_target.y);
+				double z = 0;
+				double angle = origin.dir.angle() + origin.dir.delta_angle(target.dir) * .5;
+				double vx = (info.obstacle_target.x - info.obstacle_origin.x);
+				double vy = (info.obstacle_target.y - info.obstacle_origin.y);
+				double vz = 0;
+
+				falls_.push_back(fall_t{
+					info.move_obstacle, {x, y, z, angle, 0.}, vx, vy, vz, time + .5
+				});
+			}
+			if (info.closes_trap) {
+				/* pushes towards the trigger (even blocked
+				 * ones) close the trap again; it is only shown
+				 * closing the first time */
+				auto closed = std::find_if(trap_closures_.begin(), trap_closures_.end(),
+					[&info](const trap_closure_t & closure) { return closure.pos == info.closed_trap; });
+				if (closed == trap_closures_.end()) {
+					trap_closures_.push_back({info.closed_trap, time});
+				} else {
+					steps_.back().info.closes_trap = false;
+				}
+			}
+
+			run_step_state::step_result_t result = state.complete_step();
+			if (result == run_step_state::step_result_t::running && steps_.size() < max_steps) {
+				time += 1.0;
+				continue;
+			}
+
+			step.start_time = time + step.duration;
+			step.duration = 3.0;
+			switch (result) {
+				case run_step_state::step_result_t::dropped: {
+					step.kind = step_kind_t::dropped;
+					break;
+				}
+				case run_step_state::step_result_t::reached_goal: {
+					step.kind = step_kind_t::reached_goal;
+					succeeded_ = true;
+					break;
+				}
+				default: {
+					step.kind = step_kind_t::program_end;
+					break;
+				}
+			}
+			steps_.push_back(step);
+			break;
+		}
+	}
+
+	/* keyframes */
+	keyframe_t keyframe;
+	keyframe.robot = grid_coord_t{puz.start.pos, puz.start.dir};
+	keyframe.obstacles = puz.obstacles;
+	for (const auto & point : points_) {
+		const command_tile & tile = point.cpt->tile();
+		keyframe.tiles.push_back({command_tile::state_t::normal, tile.num_repetitions()});
+	}
+	for (std::size_t n = 0; n < steps_.size(); ++n) {
+		if (n % keyframe_interval == 0) {
+			keyframes_.push_back(keyframe);
+		}
+		end_step(steps_[n], keyframe);
+	}
+
+	std::size_t n = 0;
+	std::size_t num_half_seconds = static_cast<std::size_t>(end_time() * 2) + 1;
+	for (std::size_t k = 0; k < num_half_seconds; ++k) {
+		while (n + 1 < steps_.size() && steps_[n + 1].start_time <= k * .5) {
+			++n;
+		}
+		step_at_half_second_.push_back(n);
+	}
+}
+
+void
+run_trace::clear()
+{
+	steps_.clear();
+	step_at_half_second_.clear();
+	keyframes_.clear();
+	points_.clear();
+	floor_tiles_.clear();
+	falls_.clear();
+	trap_closures_.clear();
+	succeeded_ = false;
+}
+
+void
+run_trace::apply(double time, board_view & bv) const
+{
+	if (empty()) {
+		return;
+	}
+
+	time = std::max(0.0, time);
+	std::size_t half_second = std::min(
+		static_cast<std::size_t>(time * 2), step_at_half_second_.size() - 1);
+	std::size_t n = step_at_half_second_[half_second];
+	while (n + 1 < steps_.size() && steps_[n + 1].start_time <= time) {
+		++n;
+	}
+	const step_t & step = steps_[n];
+	double delta_time = std::min(time - step.start_time, step.duration);
+
+	/* state at beginning of step */
+	keyframe_t state = keyframes_[n / keyframe_interval];
+	for (std::size_t k = n - n % keyframe_interval; k < n; ++k) {
+		end_step(steps_[k], state);
+	}
+
+	bv.set_robot_pos(state.robot.pos.x, state.robot.pos.y, 0., state.robot.dir.angle(), 0., 0.);
+	bv.set_robot_beam(board_view::robot_beam_t::off);
+	for (std::size_t k = 0; k < state.obstacles.size(); ++k) {
+		bv.set_obstacle_pos(k, state.obstacles[k].x, state.obstacles[k].y, 0., 0., 0.);
+	}
+	for (const auto & closure : trap_closures_) {
+		bv.modify_floor(closure.pos.x, closure.pos.y).opened = closure.start_time < step.start_time ? 0.0 : 1.0;
+	}
+	if (n != 0) {
+		animate_setup(steps_[0].duration, bv);
+	}
+
+	if (step.kind == step_kind_t::command) {
+		if (delta_time > 0.5) {
+			set_branch_states(step, state.tiles);
+		}
+		state.tiles[step.point].state = command_tile::state_t::flashing;
+	}
+	for (std::size_t k = 0; k < points_.size(); ++k) {
+		command_tile & tile = points_[k].cpt->tile();
+		tile.set_state(state.tiles[k].state);
+		tile.set_repetitions_left(state.tiles[k].repetitions_left);
+	}
+
+	animate_step(step, delta_time, bv);
+	animate_falls(time, bv);
+}
+
+void
+run_trace::add_points(const command_sequence & seq)
+{
+	for (const auto & cpt : seq) {
+		std::size_t index = points_.size();
+		points_.push_back({cpt.get(), {0, 0}, {0, 0}});
+		for (std::size_t n = 0; n < cpt->num_branches(); ++n) {
+			points_[index].branch_begin[n] = points_.size();
+			add_points(cpt->branch(n));
+			points_[index].branch_end[n] = points_.size();
+		}
+	}
+}
+
+void
+run_trace::end_step(const step_t & step, keyframe_t & state) const
+{
+	if (step.kind != step_kind_t::command) {
+		return;
+	}
+
+	const run_step_info & info = step.info;
+	if (!info.will_drop) {
+		state.robot = info.robot_target;
+	}
+	if (info.move_obstacle != -1) {
+		state.obstacles[info.move_obstacle] = info.obstacle_target;
+	}
+
+	set_branch_states(step, state.tiles);
+
+	const command_tile & tile = points_[step.point].cpt->tile();
+	tile_state_t & tile_state = state.tiles[step.point];
+	if (tile.is_repeat() && info.branch_state > 1) {
+		tile_state = {command_tile::state_t::normal, info.branch_state - 1};
+	} else if (tile.is_repeat()) {
+		tile_state = {command_tile::state_t::depleted, tile.num_repetitions()};
+	} else {
+		tile_state.state = command_tile::state_t::depleted;
+	}
+}
+
+void
+run_trace::set_branch_states(const step_t & step, std::vector<tile_state_t> & tiles) const
+{
+	const point_t & point = points_[step.point];
+	const command_tile & tile = point.cpt->tile();
+	int branch_state = step.info.branch_state;
+
+	if (tile.is_repeat()) {
+		for (std::size_t k = point.branch_begin[0]; k < point.branch_end[0]; ++k) {
+			tiles[k] = {command_tile::state_t::normal, points_[k].cpt->tile().num_repetitions()};
+		}
+		tiles[step.point].repetitions_left = branch_state - 1;
+	} else if (tile.is_conditional()) {
+		/* fuse out the branch we do not want to take */
+		std::size_t branch = 1 - branch_state;
+		for (std::size_t k = point.branch_begin[branch]; k < point.branch_end[branch]; ++k) {
+			tiles[k] = {command_tile::state_t::depleted, points_[k].cpt->tile().num_repetitions()};
+		}
+	}
+}
+
+void
+run_trace::animate_step(const step_t & step, double delta_time, board_view & bv) const
+{
+	const run_step_info & info = step.info;
+
+	switch (step.kind) {
+		case step_kind_t::setup: {
+			animate_setup(delta_time, bv);
+			break;
+		}
+		case step_kind_t::command: {
+			double f_target = delta_time;
+			double f_origin = 1 - f_target;
+
+			double x = info.robot_origin.pos.x * f_origin + info.robot_target.pos.x * f_target;
+			double y = info.robot_origin.pos.y * f_origin + info.robot_target.pos.y * f_target;
+			double z = 0;
+			double angle = info.robot_origin.dir.angle() + info.robot_origin.dir.delta_angle(info.robot_target.dir) * f_target;
+
+			const command_tile & tile = points_[step.point].cpt->tile();
+			double wheel_angle = tile.is_conditional() || tile.is_repeat() ? 0.0 : delta_time * M_PI * 2 * 2;
+			bv.set_robot_pos(x, y, z, angle, 0., wheel_angle);
+
+			if (tile.is_conditional() &&
+				((delta_time >= .2 && delta_time < .4) || (delta_time >= .6 && delta_time <= .8))) {
+				bv.set_robot_beam(info.branch_state ? board_view::robot_beam_t::hits_nothing : board_view::robot_beam_t::hits_floor);
+			}
+
+			if (info.move_obstacle != -1) {
+				double x = info.obstacle_origin.x * f_origin + info.obstacle_target.x * f_target;
+				double y = info.obstacle_origin.y * f_origin + info.obstacle_target.y * f_target;
+				double z = 0;
+				bv.set_obstacle_pos(info.move_obstacle, x, y, z, 0., 0.);
+			}
+
+			if (info.closes_trap) {
+				bv.modify_floor(info.closed_trap.x, info.closed_trap.y).opened = std::min(1.0, 2 * f_origin);
+			}
+			break;
+		}
+		case step_kind_t::dropped: {
+			const grid_coord_t & origin = info.robot_origin;
+			const grid_coord_t & target = info.robot_target;
+			double vx = (target.pos.x - origin.pos.x);
+			double vy = (target.pos.y - origin.pos.y);
+			double x = .5 * (origin.pos.x + target.pos.x) + vx * delta_time;
+			double y = .5 * (origin.pos.y + target.pos.y) + vy * delta_time;
+			double z = - .5 * delta_time * delta_time * 8;
+			double angle = origin.dir.angle() + origin.dir.delta_angle(target.dir) * .5;
+			double tilt = delta_time * 240;
+
+			bv.set_robot_pos(x, y, z, angle, tilt, 0.);
+			break;
+		}
+		case step_kind_t::reached_goal: {
+			view_coord_t coord = to_view_coord(info.robot_target);
+			coord.angle += delta_time * 240;
+
+			bv.set_robot_pos(coord.x, coord.y, coord.z, coord.angle, 0., 0.);
+			break;
+		}
+		case step_kind_t::program_end: {
+			break;
+		}
+	}
+}
+
+void
+run_trace::animate_setup(double delta_time, board_view & bv) const
+{
+	double duration = steps_[0].duration;
+	double f_end = duration ? delta_time / duration : 0.0;
+	double f_start = 1 - f_end;
+	for (const auto & floor_tile : floor_tiles_) {
+		if (f_end < 1.0) {
+			double start_state = floor_tile.start_state;
+			double end_state = floor_tile.present ? 1.0 : 0.0;
+			board_view::tile_color_t color = floor_tile.color;
+			color.a = f_start * start_state + f_end * end_state;
+			bv.modify_floor(floor_tile.pos.x, floor_tile.pos.y).color = color;
+		} else if (floor_tile.present) {
+			bv.modify_floor(floor_tile.pos.x, floor_tile.pos.y).color = floor_tile.color;
+		} else {
+			bv.clear_floor(floor_tile.pos.x, floor_tile.pos.y);
+		}
+	}
+}
+
+void
+run_trace::animate_falls(double time, board_view & bv) const
+{
+	for (const auto & fall : falls_) {
+		if (fall.start_time > time) {
+			continue;
+		}
+		double delta_time = time - fall.start_time;
+		double x = fall.start.x + fall.vx * delta_time;
+		double y = fall.start.y + fall.vy * delta_time;
+		double z = fall.start.z + fall.vz * delta_time - .5 * delta_time * delta_time * 8;
+		double angle = fall.start.angle;
+		double tilt = delta_time * 240;
+
+		bv.set_obstacle_pos(fall.obstacle, x, y, z, angle, tilt);
+	}
+}
@@ -0,0 +1,171 @@
+#ifndef RUN_TRACE_H
+#define RUN_TRACE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "board_view.h"
+#include "command_program.h"
+#include "puzzle.h"
+#include "run_engine.h"
+#include "tiles.h"
+
+/* Recorded run of a program, for playback. The program is
+ * executed once, when recording; the trace then holds every
+ * step (as computed by the run engine, see run_step_info)
+ * with the time it begins, the obstacles falling off and
+ * traps closing as events, and keyframes with the state of
+ * robot, obstacles and program tiles at the beginning of
+ * every keyframe_interval-th step.
+ *
+ * What is shown at any point in time is a function of trace
+ * and time only (see apply): the keyframe before it is
+ * taken, at most keyframe_interval steps are ended on top
+ * of it, and the step in progress is animated. So seeking
+ * costs the same anywhere in a run, however long, and never
+ * executes the program again. */
+class run_trace {
+public:
+	static constexpr std::size_t keyframe_interval = 16;
+
+	/* Programs looping forever (rep0) never end; runs are
+	 * only recorded up to this many steps, and shown ending
+	 * there as if the program had ended. */
+	static constexpr std::size_t max_steps = 10000;
+
+	/* Run program compiled from commands on puzzle, with
+	 * given alternatives, and record it. Setting up the
+	 * alternatives starts at time 0 and takes one second
+	 * (none if there are no alternatives); idle_opacity is
+	 * the opacity the first tile of every alternative pair
+	 * is shown with at that time, the second one being
+	 * shown with the rest. */
+	void
+	record(
+		const puzzle & puz,
+		const command_sequence & commands,
+		const command_program & program,
+		const std::vector<std::size_t> & alternatives,
+		double idle_opacity);
+
+	void
+	clear();
+
+	inline bool
+	empty() const noexcept { return steps_.empty(); }
+
+	/* Show board and program tiles as they are at given
+	 * time since the start of the run. */
+	void
+	apply(double time, board_view & bv) const;
+
+	/* Time the step showing the outcome of the run (robot
+	 * reached goal, dropped off, or program ended) begins,
+	 * and time the run is over. */
+	inline double
+	outcome_time() const noexcept { return empty() ? 0.0 : steps_.back().start_time; }
+
+	inline double
+	end_time() const noexcept { return empty() ? 0.0 : steps_.back().start_time + steps_.back().duration; }
+
+	inline bool
+	succeeded() const noexcept { return succeeded_; }
+
+private:
+	enum class step_kind_t : std::uint8_t {
+		setup = 0,
+		command = 1,
+		dropped = 2,
+		reached_goal = 3,
+		program_end = 4
+	};
+
+	struct step_t {
+		step_kind_t kind;
+		/* index into points_ of command taken */
+		std::uint16_t point;
+		double start_time;
+		double duration;
+		/* step of command taken, or of the command in whose
+		 * step the robot dropped off; for reached_goal, the
+		 * last step */
+		run_step_info info;
+	};
+
+	struct point_t {
+		command_point * cpt;
+		/* range of points_ within every branch */
+		std::uint16_t branch_begin[2];
+		std::uint16_t branch_end[2];
+	};
+
+	struct tile_state_t {
+		command_tile::state_t state;
+		int repetitions_left;
+	};
+
+	/* state before beginning a step */
+	struct keyframe_t {
+		grid_coord_t robot;
+		std::vector<grid_pos_t> obstacles;
+		std::vector<tile_state_t> tiles;
+	};
+
+	struct floor_tile_t {
+		grid_pos_t pos;
+		board_view::tile_color_t color;
+		bool present;
+		double start_state;
+	};
+
+	struct fall_t {
+		int obstacle;
+		view_coord_t start;
+		double vx, vy, vz;
+		double start_time;
+	};
+
+	struct trap_closure_t {
+		grid_pos_t pos;
+		double start_time;
+	};
+
+	void
+	add_points(const command_sequence & seq);
+
+	/* Change state as at the end of step. */
+	void
+	end_step(const step_t & step, keyframe_t & state) const;
+
+	/* Change tiles within branches of the command taken in
+	 * step, as once it has chosen its branch: repetitions
+	 * replenish their body, conditionals fuse out the branch
+	 * not taken. */
+	void
+	set_branch_states(const step_t & step, std::vector<tile_state_t> & tiles) const;
+
+	void
+	animate_step(const step_t & step, double delta_time, board_view & bv) const;
+
+	void
+	animate_setup(double delta_time, board_view & bv) const;
+
+	void
+	animate_falls(double time, board_view & bv) const;
+
+	std::vector<step_t> steps_;
+	/* for every half second of the run, the last step that
+	 * began by then; steps other than setup last at least
+	 * half a second, so the step at any time is at most two
+	 * further */
+	std::vector<std::uint32_t> step_at_half_second_;
+	std::vector<keyframe_t> keyframes_;
+
+	std::vector<point_t> points_;
+	std::vector<floor_tile_t> floor_tiles_;
+	std::vector<fall_t> falls_;
+	std::vector<trap_closure_t> trap_closures_;
+	bool succeeded_ = false;
+};
+
+#endif
@@ -0,0 +1,318 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "alternative_explorer.h"
+#include "batch_simulation.h"
+#include "program_solver.h"
+#include "puzzle.h"
+#include "worker_pool.h"
+
+/* Searches solutions for built-in puzzles, without any
+ * display. Prints one JSON object per level:
+ *
+ * {"level": 3, "status": "solved", "tiles": 4, ...}
+ *
+ * status is one of "solved", "unsolvable" (no program within
+ * the tile budget works) or "timeout" (search not finished
+ * within the time limit, which is a minute unless given).
+ * Exits with status 1 if any level was not solved.
+ *
+ * In check mode any solution will do: straight-line
+ * programs are tried first, and only if there is none the
+ * full search runs. A timing report goes to stderr.
+ *
+ * With -v every solution found is run again afterwards,
+ * once for every way its runs can end under the floor
+ * alternatives of its puzzle (see alternative_outcomes::
+ * path_assignments), as one batch across all threads (see
+ * simulate_batch); levels with a solution that fails and
+ * the throughput go to stderr, and any failure makes the
+ * exit status 1. */
+
+namespace {
+
+const char *
+tile_name(command_tile::kind_t kind)
+{
+	switch (kind) {
+		case command_tile::kind_t::left: return "left";
+		case command_tile::kind_t::right: return "right";
+		case command_tile::kind_t::fwd1: return "fwd1";
+		case command_tile::kind_t::fwd2: return "fwd2";
+		case command_tile::kind_t::fwd3: return "fwd3";
+		case command_tile::kind_t::conditional: return "conditional";
+		case command_tile::kind_t::rep0: return "rep0";
+		case command_tile::kind_t::rep1: return "rep1";
+		case command_tile::kind_t::rep2: return "rep2";
+		case command_tile::kind_t::rep3: return "rep3";
+		case command_tile::kind_t::rep4: return "rep4";
+		case command_tile::kind_t::rep5: return "rep5";
+		default: return "?";
+	}
+}
+
+/* Tile names in program order, branches in parentheses,
+ * e.g. "fwd1 rep2(left fwd2) conditional(fwd1)()". */
+std::string
+describe(const command_sequence & seq)
+{
+	std::string result;
+	for (const auto & cpt : seq) {
+		if (!result.empty()) {
+			result += ' ';
+		}
+		result += tile_name(cpt->tile().kind());
+		for (std::size_t n = 0; n < cpt->num_branches(); ++n) {
+			result += '(' + describe(cpt->branch(n)) + ')';
+		}
+	}
+	return result;
+}
+
+/* Solutions found, to be verified once all levels are
+ * searched. */
+class verifier {
+public:
+	void
+	add(std::size_t level, const puzzle & puz, const std::vector<command_sequence> & solutions)
+	{
+		for (const auto & solution : solutions) {
+			solutions_.emplace_back(solution);
+			programs_.emplace_back();
+			programs_.back().compile(solutions_.back());
+
+			alternative_outcomes outcomes;
+			explore_alternatives(puz, programs_.back(), outcomes);
+			for (auto & alternatives : outcomes.path_assignments(puz.alternative_tiles.size())) {
+				simulation_job job;
+				job.puz = &puz;
+				job.program = &programs_.back();
+				job.alternatives = std::move(alternatives);
+				jobs_.push_back(std::move(job));
+				levels_.push_back(level);
+			}
+		}
+	}
+
+	/* Returns number of simulations that failed. */
+	std::size_t
+	run(worker_pool & pool)
+	{
+		batch_simulation_result result = simulate_batch(jobs_, &pool);
+
+		std::size_t num_failed = 0;
+		for (std::size_t n = 0; n < jobs_.size(); ++n) {
+			if (!result.results[n].succeeded()) {
+				fprintf(stderr, "level %zu: solution fails after %d steps\n", levels_[n], result.results[n].steps);
+				++num_failed;
+			}
+		}
+		fprintf(stderr, "verified %zu solutions in %zu simulations, %zu failed, %llu steps, %.6f seconds, %.0f simulations per second\n",
+			programs_.size(), jobs_.size(), num_failed,
+			static_cast<unsigned long long>(result.simulated_steps), result.seconds, result.jobs_per_second);
+		return num_failed;
+	}
+
+private:
+	/* deques, since jobs point to the programs, and these
+	 * to the tiles of their solutions */
+	std::deque<command_sequence> solutions_;
+	std::deque<command_program> programs_;
+	std::vector<simulation_job> jobs_;
+	std::vector<std::size_t> levels_;
+};
+
+/* Result of checking a level: first search that found a
+ * solution, or the last one, with counts of both. */
+solver_result
+check_level(const puzzle & puz, const solver_options & options, bool & straight_line)
+{
+	solver_options straight_options = options;
+	straight_options.straight_line = true;
+	solver_result straight = solve_puzzle(puz, straight_options);
+	straight_line = !straight.solutions.empty();
+	if (straight_line) {
+		return straight;
+	}
+
+	solver_result result = solve_puzzle(puz, options);
+	result.nodes += straight.nodes;
+	result.simulated_steps += straight.simulated_steps;
+	result.seconds += straight.seconds;
+	return result;
+}
+
+const char *
+status_name(const solver_result & result)
+{
+	return !result.solutions.empty() ? "solved" : result.complete ? "unsolvable" : "timeout";
+}
+
+void
+print_result(std::size_t level, const solver_result & result)
+{
+	double states_per_second = result.seconds > 0. ? result.nodes / result.seconds : 0.;
+
+	printf("{\"level\": %zu, \"status\": \"%s\"", level, status_name(result));
+	if (!result.solutions.empty()) {
+		printf(", \"tiles\": %zu, \"steps\": %d", result.solutions.front().num_tiles(), result.steps);
+	}
+	printf(", \"complete\": %s", result.complete ? "true" : "false");
+	printf(", \"nodes\": %llu, \"simulated_steps\": %llu, \"seconds\": %.6f, \"states_per_second\": %.0f",
+		static_cast<unsigned long long>(result.nodes),
+		static_cast<unsigned long long>(result.simulated_steps),
+		result.seconds, states_per_second);
+
+	printf(", \"depth_nodes\": [");
+	for (std::size_t n = 0; n < result.depth_nodes.size(); ++n) {
+		printf("%s%llu", n ? ", " : "", static_cast<unsigned long long>(result.depth_nodes[n]));
+	}
+	printf("], \"depth_seconds\": [");
+	for (std::size_t n = 0; n < result.depth_seconds.size(); ++n) {
+		printf("%s%.6f", n ? ", " : "", result.depth_seconds[n]);
+	}
+	printf("], \"solutions\": [");
+	for (std::size_t n = 0; n < result.solutions.size(); ++n) {
+		printf("%s\"%s\"", n ? ", " : "", describe(result.solutions[n]).c_str());
+	}
+	printf("]}\n");
+	fflush(stdout);
+}
+
+/* seconds a search may take unless -t is given */
+constexpr double default_time_limit = 60.;
+
+void
+usage(const char * argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [-a|-c|-f] [-s] [-v] [-j threads] [-t seconds] [-m tiles] [level...]\n"
+		"  -a          report all solutions with the fewest tiles\n"
+		"  -c          check mode: accept any solution, report timing\n"
+		"  -f          look for fewest steps instead of fewest tiles\n"
+		"  -s          only try programs without repeats or conditionals\n"
+		"  -v          verify solutions under all alternatives\n"
+		"  -j threads  number of search threads (default: all cores)\n"
+		"  -t seconds  give up on a search after this time (default: %.0f, 0: never)\n"
+		"  -m tiles    largest number of tiles to try\n"
+		"Levels are numbered from 0; default is all levels.\n",
+		argv0, default_time_limit);
+}
+
+}
+
+int main(int argc, char ** argv)
+{
+	solver_options options;
+	options.time_limit = default_time_limit;
+	std::size_t num_threads = 0;
+	bool check = false;
+	bool verify = false;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "acfsvj:t:m:")) != -1) {
+		switch (opt) {
+			case 'a': {
+				options.find_all = true;
+				break;
+			}
+			case 'c': {
+				check = true;
+				break;
+			}
+			case 'f': {
+				options.fewest_steps = true;
+				break;
+			}
+			case 's': {
+				options.straight_line = true;
+				break;
+			}
+			case 'v': {
+				verify = true;
+				break;
+			}
+			case 'j': {
+				num_threads = strtoul(optarg, nullptr, 10);
+				break;
+			}
+			case 't': {
+				options.time_limit = strtod(optarg, nullptr);
+				break;
+			}
+			case 'm': {
+				options.max_tiles = strtoul(optarg, nullptr, 10);
+				break;
+			}
+			default: {
+				usage(argv[0]);
+				return 2;
+			}
+		}
+	}
+
+	const std::vector<puzzle> & puzzles = get_puzzles();
+
+	std::vector<std::size_t> levels;
+	for (int n = optind; n < argc; ++n) {
+		char * end;
+		unsigned long level = strtoul(argv[n], &end, 10);
+		if (*end || level >= puzzles.size()) {
+			fprintf(stderr, "%s: no level %s, there are %zu\n", argv[0], argv[n], puzzles.size());
+			return 2;
+		}
+		levels.push_back(level);
+	}
+	if (levels.empty()) {
+		for (std::size_t level = 0; level < puzzles.size(); ++level) {
+			levels.push_back(level);
+		}
+	}
+
+	worker_pool pool(num_threads);
+	options.pool = &pool;
+
+	if (check) {
+		options.find_all = false;
+		options.fewest_steps = false;
+		fprintf(stderr, "level  status      tiles  straight     nodes   seconds\n");
+	}
+
+	std::size_t num_failed = 0;
+	double total_seconds = 0.;
+	verifier verified;
+	for (std::size_t level : levels) {
+		bool straight_line = options.straight_line;
+		solver_result result = check && !straight_line ?
+			check_level(puzzles[level], options, straight_line) :
+			solve_puzzle(puzzles[level], options);
+		print_result(level, result);
+
+		num_failed += result.solutions.empty() ? 1 : 0;
+		total_seconds += result.seconds;
+		if (verify) {
+			verified.add(level, puzzles[level], result.solutions);
+		}
+		if (check) {
+			fprintf(stderr, "%5zu  %-10s  %5zu  %-8s  %8llu  %8.3f\n",
+				level, status_name(result),
+				result.solutions.empty() ? std::size_t(0) : result.solutions.front().num_tiles(),
+				straight_line ? "yes" : "no",
+				static_cast<unsigned long long>(result.nodes), result.seconds);
+		}
+	}
+
+	if (check) {
+		fprintf(stderr, "%zu levels, %zu not solved, %.3f seconds\n", levels.size(), num_failed, total_seconds);
+	}
+	if (verify) {
+		num_failed += verified.run(pool);
+	}
+
+	return num_failed ? 1 : 0;
+}
@@ -59,6 +59,8 @@ std::map<int, std::function<void(cairo_t *)>> get_texture_generator_map()
 		{texid_button_run1x, draw_run_button},
 		{texid_button_run2x, draw_run2_button},
 		{texid_button_run3x, draw_run3_button},
+		{texid_button_turbo, draw_turbo_button},
+		{texid_button_instant, draw_instant_button},
 
 		{texid_solid, draw_solid},
 		{texid_cross, draw_cross},
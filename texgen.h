@@ -109,6 +109,9 @@ static constexpr int texid_exit_icon = 25;
 
 static constexpr int texid_scratch = 26;
 
+static constexpr int texid_button_turbo = 27;
+static constexpr int texid_button_instant = 28;
+
 static constexpr int texid_blur_offset = 32;
 
 #endif
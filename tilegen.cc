@@ -469,6 +469,45 @@ draw_run3_button(cairo_t * c)
 	execute_commands(cmds, sizeof(cmds) / sizeof(cmds[0]), c);
 }
 
+void
+draw_turbo_button(cairo_t * c)
+{
+	static const draw_command cmds[] = {
+		{'m', 0.15, 0.3},
+		{'l', 0.35, 0.3},
+		{'l', 0.55, 0.5},
+		{'l', 0.35, 0.7},
+		{'l', 0.15, 0.7},
+		{'l', 0.35, 0.5},
+		{'z'},
+		{'m', 0.45, 0.3},
+		{'l', 0.65, 0.3},
+		{'l', 0.85, 0.5},
+		{'l', 0.65, 0.7},
+		{'l', 0.45, 0.7},
+		{'l', 0.65, 0.5},
+		{'z'},
+	};
+	execute_commands(cmds, sizeof(cmds) / sizeof(cmds[0]), c);
+}
+
+void
+draw_instant_button(cairo_t * c)
+{
+	static const draw_command cmds[] = {
+		{'m', 0.25, 0.3},
+		{'l', 0.6, 0.5},
+		{'l', 0.25, 0.7},
+		{'z'},
+		{'m', 0.65, 0.3},
+		{'l', 0.75, 0.3},
+		{'l', 0.75, 0.7},
+		{'l', 0.65, 0.7},
+		{'z'},
+	};
+	execute_commands(cmds, sizeof(cmds) / sizeof(cmds[0]), c);
+}
+
 void
 draw_cross(cairo_t * c)
 {
@@ -64,6 +64,12 @@ draw_run2_button(cairo_t * c);
 void
 draw_run3_button(cairo_t * c);
 
+void
+draw_turbo_button(cairo_t * c);
+
+void
+draw_instant_button(cairo_t * c);
+
 void
 draw_cross(cairo_t * c);
 
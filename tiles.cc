@@ -1,11 +1,6 @@
 #include "tiles.h"
 
 #include <math.h>
-#include <GL/gl.h>
-
-#include <chrono>
-
-#include "texgen.h"
 
 /*******************************************************************************
  * elastic_object */
@@ -53,40 +48,6 @@ command_tile::command_tile(kind_t kind, double phase)
 	replenish();
 }
 
-void
-command_tile::draw(double global_phase, const tile_display_args_t & display_args) const
-{
-	double w = .5 * display_args.tile_size;
-	glEnable(GL_TEXTURE_2D);
-
-	glColor4f(1., 1., 1., 1.);
-	texture_generator::make_tex_quad2d(
-		0,
-		x() - w, y() - w,
-		x() + w, y() - w,
-		x() + w, y() + w,
-		x() - w, y() + w);
-
-	int tex_index = get_tex_index();
-
-	gl_main_color(global_phase);
-	texture_generator::make_tex_quad2d(
-		tex_index,
-		x() - w, y() - w,
-		x() + w, y() - w,
-		x() + w, y() + w,
-		x() - w, y() + w);
-
-	if (gl_glow_color(global_phase)) {
-		texture_generator::make_tex_quad2d(
-			texture_generator::get_blur_texture(tex_index),
-			x() - w, y() - w,
-			x() + w, y() - w,
-			x() + w, y() + w,
-			x() - w, y() + w);
-	}
-}
-
 void
 command_tile::replenish()
 {
@@ -114,93 +75,6 @@ command_tile::num_repetitions() const noexcept
 	}
 }
 
-int
-command_tile::get_tex_index() const noexcept
-{
-	switch (kind()) {
-		case kind_t::left: {
-			return texid_left;
-		}
-		case kind_t::right: {
-			return texid_right;
-		}
-		case kind_t::fwd1: {
-			return texid_fwd1;
-		}
-		case kind_t::fwd2: {
-			return texid_fwd2;
-		}
-		case kind_t::fwd3: {
-			return texid_fwd3;
-		}
-		case kind_t::conditional: {
-			return texid_conditional;
-		}
-		default : {
-			/* repetitions */
-			return texid_rep0 + repetitions_left_;
-		}
-	}
-}
-
-void
-command_tile::gl_main_color(double global_phase) const
-{
-	double intensity = get_intensity(global_phase);
-	switch (state_) {
-		case state_t::normal: {
-			glColor4f(0.2, .52 + 0.16 * intensity, 0., 1.);
-			break;
-		}
-		case state_t::flashing: {
-			glColor4f(0.6 + 0.2 * intensity, 0.6 + 0.2 * intensity, 0.2 * intensity, 1.);
-			break;
-		}
-		case state_t::depleted: {
-			glColor4f(.2, .2, .2, 1.);
-			break;
-		}
-	}
-}
-
-bool
-command_tile::gl_glow_color(double global_phase) const
-{
-	double intensity = get_intensity(global_phase);
-	switch (state_) {
-		case state_t::normal: {
-			glColor4f(0.2, .8, 0., 0.64 * intensity);
-			return true;
-		}
-		case state_t::flashing: {
-			glColor4f(1., 1., 0., 0.8 * intensity);
-			return true;
-		}
-		default:
-		case state_t::depleted: {
-			glColor4f(0, 0, 0, 0);
-			return false;
-		}
-	}
-}
-
-double
-command_tile::get_intensity(double global_phase) const
-{
-	switch (state_) {
-		case state_t::normal: {
-			return .5 + .5 * sin(phase_ + global_phase);
-		}
-		case state_t::flashing: {
-			return .5 + .5 * sin(phase_ + 4 * global_phase);
-		}
-		case state_t::depleted:
-		default: {
-			return 1.;
-		}
-	}
-}
-
 /*******************************************************************************
  * command_sequence_path */
 
@@ -270,26 +144,6 @@ command_sequence::command_sequence(const command_sequence & other)
 	}
 }
 
-void
-command_sequence::draw_flows(double global_phase, const tile_display_args_t & display_args) const
-{
-	bool first = true;
-	std::pair<double, double> last;
-	for (const auto & cpt: *this) {
-		if (!first) {
-			std::pair<double, double> current = cpt->get_inflow_point();
-			draw_flow(
-				last.first, last.second,
-				current.first, current.second,
-				display_args.flow_scale, display_args.flow_width,
-				global_phase);
-		}
-		last = cpt->get_outflow_point();
-		first = false;
-		cpt->draw_flows(global_phase, display_args);
-	}
-}
-
 std::pair<double, double>
 command_sequence::get_inflow_point() const
 {
@@ -302,12 +156,17 @@ command_sequence::get_outflow_point() const
 	return elements.back()->get_outflow_point();
 }
 
-void
-command_sequence::draw(double global_phase, const tile_display_args_t & display_args) const
+command_sequence::size_type
+command_sequence::num_tiles() const noexcept
 {
+	size_type count = 0;
 	for (const auto & cpt : *this) {
-		cpt->draw(global_phase, display_args);
+		++count;
+		for (std::size_t n = 0; n < cpt->num_branches(); ++n) {
+			count += cpt->branch(n).num_tiles();
+		}
 	}
+	return count;
 }
 
 void
@@ -523,79 +382,6 @@ command_point::extract_tile() && noexcept
 	return std::move(tile_);
 }
 
-void
-command_point::draw_flows(double global_phase, const tile_display_args_t & display_args) const
-{
-	if (tile().kind() == command_tile::kind_t::conditional) {
-		if (branch(0).empty()) {
-			draw_flow({
-				{tile().x(), tile().y()},
-				{flow_points_[0].x(), flow_points_[0].y()},
-				{flow_points_[2].x(), flow_points_[0].y()},
-				{flow_points_[2].x(), flow_points_[2].y()}
-			}, display_args.flow_scale, display_args.flow_width, global_phase);
-		} else {
-			draw_flow({
-				{tile().x(), tile().y()},
-				{flow_points_[0].x(), flow_points_[0].y()},
-				branch(0).get_inflow_point(),
-			}, display_args.flow_scale, display_args.flow_width, global_phase);
-			draw_flow({
-				branch(0).get_outflow_point(),
-				{flow_points_[2].x(), flow_points_[0].y()},
-				{flow_points_[2].x(), flow_points_[2].y()}
-			}, display_args.flow_scale, display_args.flow_width, global_phase);
-		}
-		if (branch(1).empty()) {
-			draw_flow({
-				{tile().x(), tile().y()},
-				{flow_points_[1].x(), flow_points_[1].y()},
-				{flow_points_[2].x(), flow_points_[1].y()},
-				{flow_points_[2].x(), flow_points_[2].y()}
-			}, display_args.flow_scale, display_args.flow_width, global_phase);
-		} else {
-			draw_flow({
-				{tile().x(), tile().y()},
-				{flow_points_[1].x(), flow_points_[1].y()},
-				branch(1).get_inflow_point(),
-			}, display_args.flow_scale, display_args.flow_width, global_phase);
-			draw_flow({
-				branch(1).get_outflow_point(),
-				{flow_points_[2].x(), flow_points_[1].y()},
-				{flow_points_[2].x(), flow_points_[2].y()}
-			}, display_args.flow_scale, display_args.flow_width, global_phase);
-		}
-	} else if (tile().kind() > command_tile::kind_t::conditional) {
-		if (branch(0).empty()) {
-			draw_flow({
-				{tile().x(), tile().y()},
-				{flow_points_[0].x(), flow_points_[0].y()},
-				{flow_points_[2].x(), flow_points_[0].y()},
-				{flow_points_[2].x(), flow_points_[1].y()},
-				{flow_points_[1].x(), flow_points_[1].y()},
-				{tile().x(), tile().y()}
-			}, display_args.flow_scale, display_args.flow_width, global_phase);
-		} else {
-			draw_flow({
-				{tile().x(), tile().y()},
-				{flow_points_[0].x(), flow_points_[0].y()},
-				branch(0).get_inflow_point()
-			}, display_args.flow_scale, display_args.flow_width, global_phase);
-			draw_flow({
-				branch(0).get_outflow_point(),
-				{flow_points_[2].x(), flow_points_[0].y()},
-				{flow_points_[2].x(), flow_points_[1].y()},
-				{flow_points_[1].x(), flow_points_[1].y()},
-				{tile().x(), tile().y()}
-			}, display_args.flow_scale, display_args.flow_width, global_phase);
-		}
-	}
-
-	for (std::size_t n = 0; n < num_branches(); ++n) {
-		branch(n).draw_flows(global_phase, display_args);
-	}
-}
-
 std::pair<double, double>
 command_point::get_inflow_point() const
 {
@@ -612,15 +398,6 @@ command_point::get_outflow_point() const
 	}
 }
 
-void
-command_point::draw(double global_phase, const tile_display_args_t & display_args) const
-{
-	tile().draw(global_phase, display_args);
-	for (std::size_t n = 0; n < num_branches(); ++n) {
-		branch(n).draw(global_phase, display_args);
-	}
-}
-
 void
 command_point::animate(double now) const
 {
@@ -900,199 +677,3 @@ tile_by_path(
 	}
 	return nullptr;
 }
-
-namespace {
-
-void gl_flow_color(double phase)
-{
-	glColor3f(.5 * (phase + 0.5), 0., .5 * (phase + 0.5));
-}
-
-}
-
-#if 0
-void
-draw_flow(
-	double x1, double y1,
-	double x2, double y2,
-	double scale,
-	double phase)
-{
-	phase = 1.0 - phase + floor(phase);
-	double dx = x2 - x1;
-	double dy = y2 - y1;
-	double d = sqrt(dx * dx + dy * dy);
-	if (!d) {
-		return;
-	}
-
-	double udx = dx / d;
-	double udy = dy / d;
-	double sdx = scale * udx;
-	double sdy = scale * udy;
-
-	double nx = udy * 2;
-	double ny = -udx * 2;
-
-	glBegin(GL_QUADS);
-	texture_generator::make_solid_tex_coord();
-
-	double p = 0.0;
-	if (phase) {
-		double l = std::min(1.0, d / scale + phase);
-		double w = l - phase;
-		gl_flow_color(phase);
-		glVertex2f(x1 + nx, y1 + ny);
-		glVertex2f(x1 - nx, y1 - ny);
-		gl_flow_color(l);
-		glVertex2f(x1 + sdx * w - nx, y1 + sdy * w - ny);
-		glVertex2f(x1 + sdx * w + nx, y1 + sdy * w + ny);
-		p += w;
-	}
-
-	while (p + 1 < d / scale) {
-		gl_flow_color(0.);
-		glVertex2f(x1 + sdx * p + nx, y1 + sdy * p + ny);
-		glVertex2f(x1 + sdx * p - nx, y1 + sdy * p - ny);
-		gl_flow_color(1.0);
-		p += 1.0;
-		glVertex2f(x1 + sdx * p - nx, y1 + sdy * p - ny);
-		glVertex2f(x1 + sdx * p + nx, y1 + sdy * p + ny);
-	}
-
-	if (p < d / scale) {
-		double w = d / scale - p;
-		gl_flow_color(0.);
-		glVertex2f(x1 + sdx * p + nx, y1 + sdy * p + ny);
-		glVertex2f(x1 + sdx * p - nx, y1 + sdy * p - ny);
-		gl_flow_color(w);
-		glVertex2f(x2 - nx, y2 - ny);
-		glVertex2f(x2 + nx, y2 + ny);
-	}
-
-	glEnd();
-}
-#endif
-
-void
-draw_flow_line_segment(
-	double x1l, double y1l, double x1r, double y1r, double phase1,
-	double x2l, double y2l, double x2r, double y2r, double phase2)
-{
-	gl_flow_color(phase1);
-	glVertex2f(x1l, y1l);
-	glVertex2f(x1r, y1r);
-	gl_flow_color(phase2);
-	glVertex2f(x2r, y2r);
-	glVertex2f(x2l, y2l);
-}
-
-void
-draw_flow_line(
-	double x1l, double y1l, double x1r, double y1r, double phase1,
-	double x2l, double y2l, double x2r, double y2r, double phase2)
-{
-	double sb = phase1;
-	double se = std::min(floor(phase1 + 1), phase2);
-	while (sb < phase2) {
-		double fb2 = (sb - phase1) / (phase2 - phase1);
-		double fb1 = 1 - fb2;
-		double xbl = x1l * fb1 + x2l * fb2;
-		double ybl = y1l * fb1 + y2l * fb2;
-		double xbr = x1r * fb1 + x2r * fb2;
-		double ybr = y1r * fb1 + y2r * fb2;
-
-		double fe2 = (se - phase1) / (phase2 - phase1);
-		double fe1 = 1 - fe2;
-		double xel = x1l * fe1 + x2l * fe2;
-		double yel = y1l * fe1 + y2l * fe2;
-		double xer = x1r * fe1 + x2r * fe2;
-		double yer = y1r * fe1 + y2r * fe2;
-
-		draw_flow_line_segment(xbl, ybl, xbr, ybr, sb - floor(sb), xel, yel, xer, yer, se - floor(sb));
-
-		sb = se;
-		se = std::min(se + 1, phase2);
-	}
-}
-
-namespace {
-
-std::pair<double, double>
-corner_offset(
-	double dx1, double dy1,
-	double dx2, double dy2,
-	double w)
-{
-	double det = dy2 * dx1 - dy1 * dx2;
-
-	if (det) {
-		return {w * (dx2 - dx1) / det, w * (dy2 - dy1) / det};
-	} else {
-		return {-w * dy1, w * dx1};
-	}
-}
-
-}
-
-void
-draw_flow(
-	const std::vector<std::pair<double, double>> & points,
-	double scale, double width, double phase)
-{
-	phase = floor(phase) - phase;
-	glBegin(GL_QUADS);
-	texture_generator::make_solid_tex_coord();
-
-	double dx1 = points[1].first - points[0].first;
-	double dy1 = points[1].second - points[0].second;
-	double d1 = sqrt(dx1 * dx1 + dy1 * dy1);
-	dx1 /= d1;
-	dy1 /= d1;
-
-	double cx1 = -dy1 * width;
-	double cy1 = dx1 * width;
-
-	for (std::size_t n = 1; n < points.size(); ++n) {
-		double dx2 = dx1, dy2 = dy1, d2 = 0, cx2, cy2;
-		if (n + 1 < points.size()) {
-			dx2 = points[n + 1].first - points[n + 0].first;
-			dy2 = points[n + 1].second - points[n + 0].second;
-			d2 = sqrt(dx2 * dx2 + dy2 * dy2);
-			dx2 /= d2;
-			dy2 /= d2;
-		}
-		std::tie(cx2, cy2) = corner_offset(dx1, dy1, dx2, dy2, width);
-
-		double x1 = points[n - 1].first;
-		double y1 = points[n - 1].second;
-		double x2 = points[n].first;
-		double y2 = points[n].second;
-
-		draw_flow_line(
-			x1 + cx1, y1 + cy1, x1 - cx1, y1 - cy1, phase,
-			x2 + cx2, y2 + cy2, x2 - cx2, y2 - cy2, phase + d1 / scale);
-
-		phase = phase + d1 / scale;
-
-		dx1 = dx2;
-		dy1 = dy2;
-		d1 = d2;
-		cx1 = cx2;
-		cy1 = cy2;
-	}
-
-	glEnd();
-}
-
-void
-draw_flow(
-	double x1, double y1,
-	double x2, double y2,
-	double scale,
-	double width,
-	double phase)
-{
-	draw_flow({{x1, y1}, {x2, y2}}, scale, width, phase);
-}
-
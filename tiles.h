@@ -13,6 +13,14 @@ struct tile_display_args_t {
 	std::size_t flow_scale = 20;
 };
 
+/* Color laid over a tile to mark it, e.g. with analysis
+ * results; fully transparent for none. Crossed tiles are
+ * dimmed and crossed out, e.g. as never executed. */
+struct tile_tint_t {
+	double r = 0., g = 0., b = 0., a = 0.;
+	bool crossed = false;
+};
+
 class command_tile;
 class command_tile_owner;
 class command_tile_drag;
@@ -84,6 +92,9 @@ public:
 
 	inline void set_repetitions_left(int repetitions_left) noexcept { repetitions_left_ = repetitions_left; }
 
+	inline const tile_tint_t & tint() const noexcept { return tint_; }
+	inline void set_tint(const tile_tint_t & tint) noexcept { tint_ = tint; }
+
 	int num_repetitions() const noexcept;
 
 	inline bool
@@ -139,6 +150,7 @@ private:
 	state_t state_ = state_t::normal;
 	int repetitions_left_;
 	double phase_;
+	tile_tint_t tint_;
 };
 
 class command_flow_point : public elastic_object {};
@@ -218,6 +230,10 @@ public:
 	inline size_type size() const noexcept { return elements.size(); }
 	inline bool empty() const noexcept { return elements.empty(); }
 
+	/* Number of tiles, including those in branches. */
+	size_type
+	num_tiles() const noexcept;
+
 	inline iterator begin() noexcept { return elements.begin(); }
 	inline iterator end() noexcept { return elements.end(); }
 	inline const_iterator begin() const noexcept { return elements.begin(); }
@@ -0,0 +1,40 @@
+#include "transposition_table.h"
+
+transposition_table::transposition_table(std::size_t log2_size)
+	: mask_((std::size_t(1) << log2_size) - 1)
+	, entries_(new entry[mask_ + 1])
+{
+	clear();
+}
+
+bool
+transposition_table::lookup(std::uint64_t key, std::uint64_t & value) const noexcept
+{
+	const entry & e = slot(key);
+	std::uint64_t check = e.check.load(std::memory_order_relaxed);
+	std::uint64_t v = e.value.load(std::memory_order_relaxed);
+	/* empty slots hold key 0 with value 0; key 0 is thus
+	 * indistinguishable from empty, which only costs a miss */
+	if ((check ^ v) != key || key == 0) {
+		return false;
+	}
+	value = v;
+	return true;
+}
+
+void
+transposition_table::store(std::uint64_t key, std::uint64_t value) noexcept
+{
+	entry & e = slot(key);
+	e.check.store(key ^ value, std::memory_order_relaxed);
+	e.value.store(value, std::memory_order_relaxed);
+}
+
+void
+transposition_table::clear() noexcept
+{
+	for (std::size_t n = 0; n <= mask_; ++n) {
+		entries_[n].check.store(0, std::memory_order_relaxed);
+		entries_[n].value.store(0, std::memory_order_relaxed);
+	}
+}
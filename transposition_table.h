@@ -0,0 +1,53 @@
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/* Bounded map from state hashes (see run_step_state::hash)
+ * to 64 bit values, for recognizing states that have been
+ * seen before. Fixed number of entries, a new entry
+ * replaces whatever was stored in its slot, so lookups may
+ * miss entries stored earlier.
+ *
+ * Entries can be read and written concurrently without
+ * locks: every slot stores the value alongside the key
+ * XORed with the value, so a slot torn by concurrent
+ * writers fails validation and reads as missing. */
+class transposition_table {
+public:
+	/* Table with 2^log2_size entries. */
+	explicit transposition_table(std::size_t log2_size);
+
+	transposition_table(const transposition_table &) = delete;
+	transposition_table & operator=(const transposition_table &) = delete;
+
+	inline std::size_t size() const noexcept { return mask_ + 1; }
+
+	/* Value stored for key, returns false if there is none. */
+	bool
+	lookup(std::uint64_t key, std::uint64_t & value) const noexcept;
+
+	void
+	store(std::uint64_t key, std::uint64_t value) noexcept;
+
+	/* Remove all entries, must not run concurrently with
+	 * other operations. */
+	void
+	clear() noexcept;
+
+private:
+	struct entry {
+		std::atomic<std::uint64_t> check;
+		std::atomic<std::uint64_t> value;
+	};
+
+	inline entry &
+	slot(std::uint64_t key) const noexcept { return entries_[key & mask_]; }
+
+	std::size_t mask_;
+	std::unique_ptr<entry[]> entries_;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+
+worker_pool::~worker_pool()
+{
+	{
+		std::unique_lock<std::mutex> guard(mutex_);
+		exit_ = true;
+	}
+	start_.notify_all();
+	for (auto & thread : threads_) {
+		thread.join();
+	}
+}
+
+worker_pool::worker_pool(std::size_t num_workers)
+{
+	if (!num_workers) {
+		num_workers = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for (std::size_t n = 1; n < num_workers; ++n) {
+		threads_.emplace_back([this, n](){ thread_function(n); });
+	}
+}
+
+void
+worker_pool::run(const std::function<void(std::size_t)> & fn)
+{
+	std::unique_lock<std::mutex> run_guard(run_mutex_);
+
+	{
+		std::unique_lock<std::mutex> guard(mutex_);
+		job_ = &fn;
+		pending_ = threads_.size();
+		++generation_;
+	}
+	start_.notify_all();
+
+	fn(0);
+
+	std::unique_lock<std::mutex> guard(mutex_);
+	done_.wait(guard, [this](){ return pending_ == 0; });
+	job_ = nullptr;
+}
+
+worker_pool &
+worker_pool::shared()
+{
+	static worker_pool pool;
+	return pool;
+}
+
+void
+worker_pool::thread_function(std::size_t index)
+{
+	std::uint64_t seen_generation = 0;
+	for (;;) {
+		const std::function<void(std::size_t)> * job;
+		{
+			std::unique_lock<std::mutex> guard(mutex_);
+			start_.wait(guard, [this, seen_generation](){ return exit_ || generation_ != seen_generation; });
+			if (exit_) {
+				return;
+			}
+			seen_generation = generation_;
+			job = job_;
+		}
+
+		(*job)(index);
+
+		std::unique_lock<std::mutex> guard(mutex_);
+		if (--pending_ == 0) {
+			done_.notify_one();
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Fixed set of threads that run one job at a time, all
+ * workers concurrently. The calling thread takes part
+ * in every job as worker 0, so a pool of size 1 does not
+ * spawn any thread at all. */
+class worker_pool {
+public:
+	~worker_pool();
+
+	/* Number of workers defaults to number of cores. */
+	explicit worker_pool(std::size_t num_workers = 0);
+
+	worker_pool(const worker_pool & other) = delete;
+	worker_pool & operator=(const worker_pool & other) = delete;
+
+	inline std::size_t size() const noexcept { return threads_.size() + 1; }
+
+	/* Runs fn(worker_index) on all workers, returns once
+	 * all have completed. Must not be called from within
+	 * a job; concurrent callers are serialized. */
+	void
+	run(const std::function<void(std::size_t)> & fn);
+
+	/* Pool shared by all simulation code. */
+	static worker_pool &
+	shared();
+
+private:
+	void
+	thread_function(std::size_t index);
+
+	std::vector<std::thread> threads_;
+
+	/* serializes calls to run */
+	std::mutex run_mutex_;
+
+	/* data shared between caller / worker threads */
+	std::mutex mutex_;
+	std::condition_variable start_;
+	std::condition_variable done_;
+	const std::function<void(std::size_t)> * job_ = nullptr;
+	std::uint64_t generation_ = 0;
+	std::size_t pending_ = 0;
+	bool exit_ = false;
+};
+
+#endif